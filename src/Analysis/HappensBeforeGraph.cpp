@@ -13,6 +13,8 @@ limitations under the License.
 
 #include <IR/IRImpls.h>
 
+#include <limits>
+
 /*
 Happens before depends on each event having an increasing ID per thread:
 
@@ -47,7 +49,8 @@ To check if an event A on T1 can reach an event B on T2
 - find the closest sync event after A on T1 (syncAfterA)
 - find the closest sync event before B on T2 (syncBeforeB)
 - check if syncAfterA can reach syncBeforeB
-  - normal graph traversal on the sync event edges
+  - normal graph traversal on the sync event edges (SyncClosure engine)
+  - or a lookup in the vector clock of syncBeforeB (VectorClock engine)
 
 This shrinks the graph that needs to be searched.
 */
@@ -154,7 +157,7 @@ const ThreadTrace *getJoinedThread(const JoinEvent *join, const ProgramTrace &pr
 
 }  // namespace
 
-HappensBeforeGraph::HappensBeforeGraph(const race::ProgramTrace &program) {
+HappensBeforeGraph::HappensBeforeGraph(const race::ProgramTrace &program, Reachability engine) : engine(engine) {
   // Barriers are handled by adding two edges between each barrier event
   // e.g.
   //   T1       T2
@@ -229,6 +232,52 @@ HappensBeforeGraph::HappensBeforeGraph(const race::ProgramTrace &program) {
     }
   }
 
+  switch (engine) {
+    case Reachability::SyncClosure:
+      computeSyncClosure();
+      break;
+    case Reachability::VectorClock:
+      computeVectorClocks();
+      break;
+  }
+
+  // after the sync nodes are numbered, the closest sync nodes of each event are recorded with its segment
+  computeSegments(program);
+  computeParallelThreads(program);
+}
+
+void HappensBeforeGraph::computeParallelThreads(const ProgramTrace &program) {
+  for (auto const &thread : program.getThreads()) {
+    numThreads = std::max(numThreads, thread->id + 1);
+  }
+  parallelThreads.resize(numThreads * numThreads);
+
+  // If the last event of one thread happens before the first event of the other, program order on both threads extends
+  // that edge to every pair of their events
+  auto const &threads = program.getThreads();
+  for (auto lhsIt = threads.begin(), end = threads.end(); lhsIt != end; ++lhsIt) {
+    auto const &lhsEvents = (*lhsIt)->getEvents();
+    // a thread with no events has nothing to run in parallel
+    if (lhsEvents.empty()) continue;
+
+    for (auto rhsIt = std::next(lhsIt); rhsIt != end; ++rhsIt) {
+      auto const &rhsEvents = (*rhsIt)->getEvents();
+      if (rhsEvents.empty()) continue;
+
+      if (canReach(lhsEvents.back().get(), rhsEvents.front().get()) ||
+          canReach(rhsEvents.back().get(), lhsEvents.front().get())) {
+        continue;
+      }
+
+      auto const lhs = (*lhsIt)->id;
+      auto const rhs = (*rhsIt)->id;
+      parallelThreads.set(lhs * numThreads + rhs);
+      parallelThreads.set(rhs * numThreads + lhs);
+    }
+  }
+}
+
+void HappensBeforeGraph::computeSyncClosure() {
   // we repeatedly need to check if one node is reachable from another
   // to optimise this, and since the connectivity of this graph is relatively low, we pre-search all reachable sync
   // events from each sync event and keep a cache for later since this graph is (effectively) unmodifiable
@@ -282,6 +331,180 @@ HappensBeforeGraph::HappensBeforeGraph(const race::ProgramTrace &program) {
   }
 }
 
+void HappensBeforeGraph::computeVectorClocks() {
+  // Number every sync event densely, thread by thread
+  for (auto const &[tid, syncs] : threadSyncs) {
+    auto const slot = static_cast<uint32_t>(threadSlots.size());
+    threadSlots.emplace(tid, slot);
+    syncOffsets.push_back(static_cast<SyncNode>(nodeSlot.size()));
+    for (uint32_t position = 0; position < syncs.size(); ++position) {
+      nodeSlot.push_back(slot);
+      nodePosition.push_back(position);
+    }
+  }
+  auto const numNodes = nodeSlot.size();
+  auto const numSlots = threadSlots.size();
+
+  // successors of each node: the next sync on the same thread and any cross-thread sync edges
+  std::vector<std::vector<SyncNode>> succs(numNodes);
+  for (SyncNode node = 0; node + 1 < numNodes; ++node) {
+    if (nodeSlot[node] == nodeSlot[node + 1]) {
+      succs[node].push_back(node + 1);
+    }
+  }
+  for (auto const &[src, dsts] : syncEdges) {
+    auto &srcSuccs = succs[getSyncNode(src)];
+    for (auto const &dst : dsts) {
+      srcSuccs.push_back(getSyncNode(dst));
+    }
+  }
+
+  // Collapse cycles (created by barriers) with an iterative Tarjan's algorithm.
+  // Tarjan completes components in reverse topological order: edges only go to components with a lower number.
+  constexpr auto unvisited = std::numeric_limits<uint32_t>::max();
+  std::vector<uint32_t> index(numNodes, unvisited);
+  std::vector<uint32_t> lowlink(numNodes, unvisited);
+  std::vector<bool> onStack(numNodes, false);
+  std::vector<SyncNode> stack;
+  // (node, next successor to visit) for each node on the DFS path
+  std::vector<std::pair<SyncNode, size_t>> dfsPath;
+  // members of each component, stored contiguously starting at sccStart[scc]
+  std::vector<SyncNode> sccMembers;
+  std::vector<size_t> sccStart;
+  uint32_t nextIndex = 0;
+  nodeSCC.assign(numNodes, unvisited);
+
+  auto const visit = [&](SyncNode node) {
+    index[node] = lowlink[node] = nextIndex++;
+    stack.push_back(node);
+    onStack[node] = true;
+    dfsPath.emplace_back(node, 0);
+  };
+
+  for (SyncNode root = 0; root < numNodes; ++root) {
+    if (index[root] != unvisited) continue;
+    visit(root);
+
+    while (!dfsPath.empty()) {
+      auto const node = dfsPath.back().first;
+      auto &nextSucc = dfsPath.back().second;
+      if (nextSucc < succs[node].size()) {
+        auto const succ = succs[node][nextSucc++];
+        if (index[succ] == unvisited) {
+          visit(succ);
+        } else if (onStack[succ]) {
+          lowlink[node] = std::min(lowlink[node], index[succ]);
+        }
+        continue;
+      }
+
+      // All successors of node have been visited
+      dfsPath.pop_back();
+      if (!dfsPath.empty()) {
+        auto const parent = dfsPath.back().first;
+        lowlink[parent] = std::min(lowlink[parent], lowlink[node]);
+      }
+
+      if (lowlink[node] == index[node]) {
+        auto const scc = static_cast<uint32_t>(sccStart.size());
+        sccStart.push_back(sccMembers.size());
+        SyncNode member;
+        do {
+          member = stack.back();
+          stack.pop_back();
+          onStack[member] = false;
+          nodeSCC[member] = scc;
+          sccMembers.push_back(member);
+        } while (member != node);
+      }
+    }
+  }
+  auto const numSCCs = sccStart.size();
+  sccStart.push_back(sccMembers.size());
+
+  // Each component's clock starts with the positions of its own members
+  clocks.assign(numSCCs * numSlots, 0);
+  for (SyncNode node = 0; node < numNodes; ++node) {
+    auto &clock = clocks[nodeSCC[node] * numSlots + nodeSlot[node]];
+    clock = std::max(clock, nodePosition[node] + 1);
+  }
+
+  // Visit components in topological order and join each clock into the clocks of its successors
+  for (auto scc = numSCCs; scc-- > 0;) {
+    auto const clock = clocks.begin() + scc * numSlots;
+    for (auto i = sccStart[scc]; i < sccStart[scc + 1]; ++i) {
+      for (auto const succ : succs[sccMembers[i]]) {
+        auto const succSCC = nodeSCC[succ];
+        if (succSCC == scc) continue;
+        auto const succClock = clocks.begin() + succSCC * numSlots;
+        std::transform(clock, clock + numSlots, succClock, succClock,
+                       [](uint32_t lhs, uint32_t rhs) { return std::max(lhs, rhs); });
+      }
+    }
+  }
+}
+
+void HappensBeforeGraph::computeSegments(const ProgramTrace &program) {
+  // A thread with n syncs has 2n+1 segments: the events before each sync, each sync, and the events after the last sync
+  SegmentID nextSegment = 0;
+  for (auto const &thread : program.getThreads()) {
+    if (eventSegments.size() <= thread->id) {
+      eventSegments.resize(thread->id + 1);
+    }
+    auto &segments = eventSegments[thread->id];
+    auto const &events = thread->getEvents();
+    segments.reserve(events.size());
+
+    static const std::vector<EventPID> noSyncs;
+    auto const it = threadSyncs.find(thread->id);
+    auto const &syncs = it != threadSyncs.end() ? it->second : noSyncs;
+
+    // the sync nodes of this thread, only numbered by the VectorClock engine
+    std::vector<EventSyncs> *syncNodes = nullptr;
+    SyncNode firstNode = 0;
+    if (engine == Reachability::VectorClock) {
+      if (eventSyncs.size() <= thread->id) {
+        eventSyncs.resize(thread->id + 1);
+      }
+      syncNodes = &eventSyncs[thread->id];
+      syncNodes->reserve(events.size());
+      if (!syncs.empty()) {
+        firstNode = syncOffsets[threadSlots.at(thread->id)];
+      }
+    }
+
+    size_t nextSync = 0;
+    for (auto const &event : events) {
+      auto const eid = event->getID();
+      while (nextSync < syncs.size() && syncs[nextSync].eid < eid) {
+        ++nextSync;
+      }
+      auto const isSync = nextSync < syncs.size() && syncs[nextSync].eid == eid;
+      segments.push_back(nextSegment + 2 * nextSync + (isSync ? 1 : 0));
+
+      if (syncNodes != nullptr) {
+        // a sync event is its own closest sync in both directions
+        auto const prev = isSync || nextSync > 0 ? firstNode + static_cast<SyncNode>(isSync ? nextSync : nextSync - 1)
+                                                  : noSync;
+        auto const next = nextSync < syncs.size() ? firstNode + static_cast<SyncNode>(nextSync) : noSync;
+        syncNodes->push_back({prev, next});
+      }
+    }
+    nextSegment += 2 * syncs.size() + 1;
+  }
+}
+
+HappensBeforeGraph::SegmentID HappensBeforeGraph::getSegmentID(const Event *event) const {
+  return eventSegments.at(event->getThread().id).at(event->getID());
+}
+
+HappensBeforeGraph::SyncNode HappensBeforeGraph::getSyncNode(EventPID sync) const {
+  auto const &syncs = threadSyncs.at(sync.tid);
+  auto const it = std::lower_bound(syncs.begin(), syncs.end(), sync);
+  assert(it != syncs.end() && *it == sync && "event is not a sync event");
+  return syncOffsets[threadSlots.at(sync.tid)] + static_cast<SyncNode>(std::distance(syncs.begin(), it));
+}
+
 void HappensBeforeGraph::addSync(const Event *syncEvent) {
   auto &syncs = threadSyncs[syncEvent->getThread().id];
   EventPID syncPID(syncEvent);
@@ -306,6 +529,15 @@ void HappensBeforeGraph::addSyncEdge(const Event *src, const Event *dst) {
 }
 
 bool HappensBeforeGraph::canReach(const Event *src, const Event *dst) const {
+  if (engine == Reachability::VectorClock) {
+    auto const srcNode = eventSyncs[src->getThread().id][src->getID()].next;
+    auto const dstNode = eventSyncs[dst->getThread().id][dst->getID()].prev;
+    if (srcNode == noSync || dstNode == noSync) {
+      return false;
+    }
+    return clocks[nodeSCC[dstNode] * threadSlots.size() + nodeSlot[srcNode]] > nodePosition[srcNode];
+  }
+
   auto srcSync = findNextSync(src);
   if (!srcSync.has_value()) {
     return false;
@@ -11,14 +11,26 @@ limitations under the License.
 
 #pragma once
 
+#include <llvm/ADT/BitVector.h>
+
+#include <limits>
+
 #include "Trace/ProgramTrace.h"
 
 namespace race {
 
 class HappensBeforeGraph {
  public:
+  // Algorithms used to answer reachability queries between sync events
+  enum class Reachability {
+    // Pre-search every sync event reachable from each sync event (quadratic time and memory in sync events)
+    SyncClosure,
+    // Give each sync event a per-thread vector clock (linear construction, constant time queries)
+    VectorClock
+  };
+
   // constructs an graph from the events currently stored in program
-  explicit HappensBeforeGraph(const ProgramTrace &program);
+  explicit HappensBeforeGraph(const ProgramTrace &program, Reachability engine = Reachability::VectorClock);
 
   // return true if there is a happens before edge from src to dst
   [[nodiscard]] bool canReach(const Event *src, const Event *dst) const;
@@ -28,6 +40,19 @@ class HappensBeforeGraph {
     return !canReach(lhs, rhs) && !canReach(rhs, lhs);
   }
 
+  // return false if every event on one thread happens before every event on the other, so that no events of the two
+  // threads can run in parallel. A thread never runs in parallel with itself.
+  [[nodiscard]] bool threadsMayRunInParallel(ThreadID lhs, ThreadID rhs) const {
+    return parallelThreads.test(lhs * numThreads + rhs);
+  }
+
+  // Events on a thread are split into segments by its sync events. Each sync event is a segment of its own, and the
+  // events strictly between two consecutive syncs share one. Every event in a segment has the same closest sync
+  // before and after it, so happens-before gives the same answer for any two events taken from the same two segments.
+  // IDs are unique across the whole program.
+  using SegmentID = uint32_t;
+  [[nodiscard]] SegmentID getSegmentID(const Event *event) const;
+
   void debugDump(llvm::raw_ostream &os) const;
 
  private:
@@ -49,8 +74,13 @@ class HappensBeforeGraph {
     bool operator<=(const EventPID &other) const { return *this < other || *this == other; }
   };
 
+  const Reachability engine;
+
   std::map<EventPID, std::set<EventPID>> syncEdges;
+
+  // Only filled by the SyncClosure engine
   std::map<EventPID, std::set<EventPID>> syncReachable;
+  void computeSyncClosure();
   // DFS on syncEdges to see if src can reach dst
   [[nodiscard]] bool isReachable(EventPID src, EventPID dst) const;
   [[nodiscard]] bool hasEdge(EventPID src, EventPID dst) const;
@@ -62,6 +92,15 @@ class HappensBeforeGraph {
 
   void addSyncEdge(const Event *src, const Event *dst);
 
+  // Thread-level may-happen-in-parallel matrix: bit lhs * numThreads + rhs is set if the two threads may run in parallel
+  size_t numThreads = 0;
+  llvm::BitVector parallelThreads;
+  void computeParallelThreads(const ProgramTrace &program);
+
+  // Segment of each event, indexed by thread ID then event ID
+  std::vector<std::vector<SegmentID>> eventSegments;
+  void computeSegments(const ProgramTrace &program);
+
   // Return next sync on the same thread, or this event if it is a sync
   [[nodiscard]] std::optional<EventPID> findNextSync(const Event *e) const;
   [[nodiscard]] std::optional<EventPID> findNextSync(EventPID node) const;
@@ -71,6 +110,34 @@ class HappensBeforeGraph {
 
   // Return previous sync on the same thread, or this event if it is a sync
   [[nodiscard]] std::optional<EventPID> findPrevSync(const Event *e) const;
+
+  // ==== VectorClock engine ====
+  // Sync events are numbered densely: the syncs of the thread in slot s are numbered consecutively from
+  // syncOffsets[s] in the same order as in threadSyncs
+  using SyncNode = uint32_t;
+  std::map<ThreadID, uint32_t> threadSlots;
+  std::vector<SyncNode> syncOffsets;
+  // thread slot and position within that thread's sync list of each sync node
+  std::vector<uint32_t> nodeSlot;
+  std::vector<uint32_t> nodePosition;
+  // Barriers add edges in both directions, so sync events can form cycles. Every node in a strongly connected
+  // component is reached by the same set of nodes, so the whole component shares one clock
+  std::vector<uint32_t> nodeSCC;
+  // clocks[scc * threadSlots.size() + slot] is one more than the position of the last sync on that thread
+  // that can reach the component, or 0 if no sync on that thread can reach it.
+  // Program order means every earlier sync on that thread can reach it as well.
+  std::vector<uint32_t> clocks;
+  // The closest sync node at or before (prev) and at or after (next) each event, indexed by thread ID then event ID,
+  // noSync if there is none. Filled by computeSegments, so a query does not search the sync lists.
+  static constexpr SyncNode noSync = std::numeric_limits<SyncNode>::max();
+  struct EventSyncs {
+    SyncNode prev;
+    SyncNode next;
+  };
+  std::vector<std::vector<EventSyncs>> eventSyncs;
+
+  void computeVectorClocks();
+  [[nodiscard]] SyncNode getSyncNode(EventPID sync) const;
 };
 
 }  // namespace race
@@ -11,80 +11,95 @@ limitations under the License.
 
 #include "LockSet.h"
 
-#include <set>
-
 using namespace race;
 
-std::multiset<const llvm::Value *> LockSet::heldLocks(const Event *targetEvent) {
-  // check if we have it cached
+LockSet::LockSet(const ProgramTrace &program) {
+  // the empty lockset always has ID NoLocks
+  intern({});
+
+  for (auto const &thread : program.getThreads()) {
+    computeLockSets(*thread);
+  }
+}
+
+LockSet::LockSetID LockSet::intern(const std::vector<const llvm::Value *> &heldLocks) {
   // cppcheck-suppress stlIfFind
-  if (auto it = cache.find(targetEvent); it != cache.end()) {
+  if (auto it = lockSetIDs.find(heldLocks); it != lockSetIDs.end()) {
     return it->second;
   }
-  std::multiset<const llvm::Value *> locks;
+
+  llvm::BitVector bits;
+  for (auto const lock : heldLocks) {
+    auto const index = lockIndices.emplace(lock, lockIndices.size()).first->second;
+    if (index >= bits.size()) bits.resize(index + 1);
+    bits.set(index);
+  }
+
+  auto const id = static_cast<LockSetID>(lockSets.size());
+  lockSets.push_back(std::move(bits));
+  lockSetIDs.emplace(heldLocks, id);
+  return id;
+}
+
+void LockSet::computeLockSets(const ThreadTrace &thread) {
+  if (eventLockSets.size() <= thread.id) {
+    eventLockSets.resize(thread.id + 1);
+  }
+  auto &threadLockSets = eventLockSets[thread.id];
+  auto const &events = thread.getEvents();
+  threadLockSets.reserve(events.size());
+
   if (DEBUG_PTA) {
     llvm::outs() << "--------------------------\n";
   }
-  auto const &thread = targetEvent->getThread();
-  for (auto const &event : thread.getEvents()) {
-    if (event->getID() == targetEvent->getID()) {
-      break;
-    }
+
+  // sorted list of the locks held at the current point in the thread
+  std::vector<const llvm::Value *> heldLocks;
+  LockSetID current = NoLocks;
+  for (auto const &event : events) {
+    // an event is guarded by the locks acquired *before* it
+    threadLockSets.push_back(current);
+
     switch (event->type) {
       case Event::Type::Lock: {
         auto lockEvent = llvm::cast<LockEvent>(event.get());
-        locks.insert(lockEvent->getIRInst()->getLockValue());
-        if (DEBUG_PTA) {
-          llvm::outs() << "After lock: {";
-          auto it = locks.begin();
-          for (; it != locks.end(); it++) llvm::outs() << *it << " ";
-          llvm::outs() << "}\n";
-        }
+        auto const lock = lockEvent->getIRInst()->getLockValue();
+        heldLocks.insert(std::upper_bound(heldLocks.begin(), heldLocks.end(), lock), lock);
+        current = intern(heldLocks);
         break;
       }
       case Event::Type::Unlock: {
         auto unlockEvent = llvm::cast<UnlockEvent>(event.get());
-        const llvm::Value *ele = unlockEvent->getIRInst()->getLockValue();
-        const auto &first = locks.find(ele);
-        if (first != locks.end()) {  // only remove the first element
-          locks.erase(first);
-        }
-        if (DEBUG_PTA) {
-          llvm::outs() << "After unlock: {";
-          auto it = locks.begin();
-          for (; it != locks.end(); it++) llvm::outs() << *it << " ";
-          llvm::outs() << "}\n";
+        auto const lock = unlockEvent->getIRInst()->getLockValue();
+        auto const it = std::lower_bound(heldLocks.begin(), heldLocks.end(), lock);
+        if (it != heldLocks.end() && *it == lock) {  // only remove one held instance of the lock
+          heldLocks.erase(it);
         }
+        current = intern(heldLocks);
         break;
       }
       default:
         // Do Nothing
-        break;
+        continue;
     }
-  }
 
-  cache.emplace(targetEvent, locks);
-  return locks;
+    if (DEBUG_PTA) {
+      llvm::outs() << "After " << (event->type == Event::Type::Lock ? "lock" : "unlock") << ": {";
+      for (auto const lock : heldLocks) llvm::outs() << lock << " ";
+      llvm::outs() << "}\n";
+    }
+  }
 }
 
-LockSet::LockSet(const ProgramTrace & /* program */) : cache({}) {}
-
-bool LockSet::sharesLock(const MemAccessEvent *lhs, const MemAccessEvent *rhs) {
-  auto const lhsLocks = heldLocks(lhs);
-  auto const rhsLocks = heldLocks(rhs);
-
-  auto lhsIter = lhsLocks.begin();
-  auto rhsIter = rhsLocks.begin();
+LockSet::LockSetID LockSet::getLockSetID(const Event *event) const {
+  return eventLockSets.at(event->getThread().id).at(event->getID());
+}
 
-  while (lhsIter != lhsLocks.end() && rhsIter != rhsLocks.end()) {
-    if (rhsIter == rhsLocks.end() || *lhsIter < *rhsIter) {
-      lhsIter++;
-    } else if (lhsIter == lhsLocks.end() || *lhsIter > *rhsIter) {
-      rhsIter++;
-    } else {
-      return true;
-    }
-  }
+bool LockSet::sharesLock(const MemAccessEvent *lhs, const MemAccessEvent *rhs) const {
+  auto const lhsID = getLockSetID(lhs);
+  auto const rhsID = getLockSetID(rhs);
+  if (lhsID == NoLocks || rhsID == NoLocks) return false;
+  if (lhsID == rhsID) return true;
 
-  return false;
+  return lockSets[lhsID].anyCommon(lockSets[rhsID]);
 }
@@ -11,19 +11,42 @@ limitations under the License.
 
 #pragma once
 
+#include <llvm/ADT/BitVector.h>
+
 #include "LanguageModel/RaceModel.h"
 #include "Trace/ProgramTrace.h"
 
 namespace race {
 
 class LockSet {
+ public:
+  // Each distinct set of held locks is interned to a small integer ID
+  using LockSetID = uint32_t;
+  // ID of the empty lockset
+  static constexpr LockSetID NoLocks = 0;
+
  private:
-  std::map<const Event *, std::multiset<const llvm::Value *>> cache;
-  std::multiset<const llvm::Value *> heldLocks(const Event *targetEvent);
+  // Lockset held by each event, indexed by thread ID then event ID
+  std::vector<std::vector<LockSetID>> eventLockSets;
+
+  // Interned locksets indexed by LockSetID. Bit i is set if the i-th lock value seen is held.
+  std::vector<llvm::BitVector> lockSets;
+
+  // Interning table from the sorted list of held locks (duplicates kept for re-entrant locks) to its ID
+  std::map<std::vector<const llvm::Value *>, LockSetID> lockSetIDs;
+  // Index of each lock value in the lockSets bitvectors
+  std::map<const llvm::Value *, unsigned> lockIndices;
+
+  // Compute the lockset of every event on thread in a single forward pass
+  void computeLockSets(const ThreadTrace &thread);
+  LockSetID intern(const std::vector<const llvm::Value *> &heldLocks);
 
  public:
   explicit LockSet(const ProgramTrace &program);
 
-  [[nodiscard]] bool sharesLock(const MemAccessEvent *lhs, const MemAccessEvent *rhs);
+  // Get the ID of the set of locks held by event
+  [[nodiscard]] LockSetID getLockSetID(const Event *event) const;
+
+  [[nodiscard]] bool sharesLock(const MemAccessEvent *lhs, const MemAccessEvent *rhs) const;
 };
 }  // namespace race
@@ -154,6 +154,8 @@ auto const _inSameSingleBlock = inSame<IR::Type::OpenMPSingleStart, IR::Type::Op
 }  // namespace
 
 const std::vector<OpenMPAnalysis::LoopRegion> &OpenMPAnalysis::getOmpForLoops(const ThreadTrace &thread) {
+  std::lock_guard<std::mutex> lock(ompForLoopsMutex);
+
   // Check if result is already computed
   auto it = ompForLoops.find(thread.id);
   if (it != ompForLoops.end()) {
@@ -265,6 +267,9 @@ std::vector<const llvm::BasicBlock *> &ReduceAnalysis::computeGuardedBlocks(Redu
 }
 
 const std::vector<const llvm::BasicBlock *> &ReduceAnalysis::getReduceBlocks(ReduceInst reduce) const {
+  // std::map never invalidates references, so the returned blocks stay valid after the lock is released
+  std::lock_guard<std::mutex> lock(reduceBlocksMutex);
+
   // Check cache first
   // cppcheck-suppress stlIfFind
   if (auto it = reduceBlocks.find(reduce); it != reduceBlocks.end()) {
@@ -13,6 +13,8 @@ limitations under the License.
 
 #include <llvm/Passes/PassBuilder.h>
 
+#include <mutex>
+
 #include "Analysis/SimpleArrayAnalysis.h"
 #include "Trace/Event.h"
 #include "Trace/ThreadTrace.h"
@@ -42,6 +44,8 @@ class ReduceAnalysis {
 
   // cached map of reduce instructions to the blocks that make up the reduction code
   mutable std::map<ReduceInst, std::vector<const llvm::BasicBlock*>> reduceBlocks;
+  // guards reduceBlocks so that reduceContains can be called from multiple threads
+  mutable std::mutex reduceBlocksMutex;
 
   // Compute list of blocks, insert into reduceBlocks cache, and return
   std::vector<const llvm::BasicBlock*>& computeGuardedBlocks(ReduceInst reduce) const;
@@ -108,6 +112,8 @@ class OpenMPAnalysis {
 
   // per-thread map of omp for loop regions
   std::map<ThreadID, std::vector<LoopRegion>> ompForLoops;
+  // guards ompForLoops so that the cache can be filled from multiple threads
+  std::mutex ompForLoopsMutex;
 
   // get cached list of loop regions, else create them
   const std::vector<LoopRegion>& getOmpForLoops(const ThreadTrace& trace);
@@ -10,25 +10,125 @@ limitations under the License.
 ==============================================================================*/
 
 #include "Analysis/SharedMemory.h"
+
+#include <algorithm>
+#include <limits>
+
 using namespace race;
 
+namespace {
+constexpr ThreadID NoThread = std::numeric_limits<ThreadID>::max();
+
+// Per-object totals gathered in the counting pass
+struct AccessCounts {
+  std::vector<size_t> accesses;
+  std::vector<size_t> threads;
+  std::vector<ThreadID> lastThread;
+
+  void grow(size_t size) {
+    if (accesses.size() >= size) return;
+    accesses.resize(size, 0);
+    threads.resize(size, 0);
+    lastThread.resize(size, NoThread);
+  }
+
+  void count(size_t obj, ThreadID tid) {
+    ++accesses[obj];
+    if (lastThread[obj] != tid) {
+      lastThread[obj] = tid;
+      ++threads[obj];
+    }
+  }
+};
+
+void printAccess(const char *kind, const MemAccessEvent *event) {
+  llvm::outs() << kind << ": ID " << event->getID();
+  event->getIRInst()->getInst()->print(llvm::outs());
+  if (event->getAccessedMemory().empty()) {
+    llvm::outs() << ", empty pts, "
+                 << "\n";
+    return;
+  }
+  llvm::outs() << ", pts: ";
+  for (auto obj : event->getAccessedMemory()) {
+    llvm::outs() << obj->getValue() << " " << obj->getObjectID() << ", ";
+  }
+  llvm::outs() << "\n";
+}
+}  // namespace
+
+// The index is built with two linear passes over the trace. The first pass counts accesses and distinct threads per
+// object, which sizes every array exactly. The second pass writes each access into its final slot. Threads are visited
+// in ID order, so the accesses of an object come out grouped and sorted by thread without any sorting.
 SharedMemory::SharedMemory(const ProgramTrace &program) {
-  auto const getObjId = [&](const pta::ObjTy *obj) {
-    // cppcheck-suppress stlIfFind
-    if (auto it = objIDs.find(obj); it != objIDs.end()) {
-      return it->second;
+  auto threads = program.getThreads();
+  std::sort(threads.begin(), threads.end(), [](auto lhs, auto rhs) { return lhs->id < rhs->id; });
+
+  // Pass 1: count
+  AccessCounts readCounts;
+  AccessCounts writeCounts;
+  for (auto const thread : threads) {
+    for (auto const &event : thread->getEvents()) {
+      if (event->type != Event::Type::Read && event->type != Event::Type::Write) continue;
+
+      auto const isRead = event->type == Event::Type::Read;
+      auto &counts = isRead ? readCounts : writeCounts;
+      forEachObject(llvm::cast<MemAccessEvent>(event.get())->getAccessedMemory(), [&](const pta::ObjTy *obj) {
+        auto const id = obj->getObjectID();
+        if (id >= objects.size()) {
+          objects.resize(id + 1, nullptr);
+        }
+        objects[id] = obj;
+        counts.grow(objects.size());
+        counts.count(id, thread->id);
+      });
     }
+  }
+  readCounts.grow(objects.size());
+  writeCounts.grow(objects.size());
 
-    auto id = objIDs.size();
-    objIDs[obj] = id;
-    return id;
+  // Prefix sums give the start of every object's slice
+  auto const layout = [this](auto &index, AccessCounts &counts, std::vector<size_t> &nextEvent) {
+    index.objOffsets.assign(objects.size() + 1, 0);
+    nextEvent.assign(objects.size(), 0);
+    size_t totalEvents = 0;
+    for (ObjID obj = 0; obj < objects.size(); ++obj) {
+      index.objOffsets[obj + 1] = index.objOffsets[obj] + counts.threads[obj];
+      nextEvent[obj] = totalEvents;
+      totalEvents += counts.accesses[obj];
+      counts.lastThread[obj] = NoThread;
+    }
+    index.events.assign(totalEvents, nullptr);
+    index.threads.resize(index.objOffsets.back());
   };
+  std::vector<size_t> nextRead;
+  std::vector<size_t> nextWrite;
+  layout(reads, readCounts, nextRead);
+  layout(writes, writeCounts, nextWrite);
+
+  // Per-object cursor into the threads array, starting at the beginning of each object's slice
+  std::vector<size_t> nextReadThread(reads.objOffsets.begin(), reads.objOffsets.end() - 1);
+  std::vector<size_t> nextWriteThread(writes.objOffsets.begin(), writes.objOffsets.end() - 1);
 
+  auto const place = [](auto &index, AccessCounts &counts, std::vector<size_t> &nextEvent,
+                        std::vector<size_t> &nextThread, ObjID obj, ThreadID tid, auto event) {
+    auto const slot = nextEvent[obj]++;
+    index.events[slot] = event;
+    if (counts.lastThread[obj] != tid) {
+      counts.lastThread[obj] = tid;
+      index.threads[nextThread[obj]++] = {tid, llvm::makeArrayRef(index.events.data() + slot, 1)};
+      return;
+    }
+    auto &group = index.threads[nextThread[obj] - 1];
+    group.events = llvm::makeArrayRef(group.events.data(), group.events.size() + 1);
+  };
+
+  // Pass 2: place
   if (DEBUG_PTA) {
     llvm::outs() << "** SharedMemory **"
                  << "\n";
   }
-  for (auto const &thread : program.getThreads()) {
+  for (auto const thread : threads) {
     auto const tid = thread->id;
     if (DEBUG_PTA) {
       llvm::outs() << "------- tid: " << tid << "\n";
@@ -38,60 +138,20 @@ SharedMemory::SharedMemory(const ProgramTrace &program) {
       switch (event->type) {
         case Event::Type::Read: {
           auto readEvent = llvm::cast<ReadEvent>(event.get());
-          auto const ptsTo = readEvent->getAccessedMemory();
-          if (DEBUG_PTA) {
-            if (ptsTo.empty()) {
-              llvm::outs() << "Read: ID " << readEvent->getID();
-              readEvent->getIRInst()->getInst()->print(llvm::outs());
-              llvm::outs() << ", empty pts, "
-                           << "\n";
-              break;
-            } else {
-              llvm::outs() << "Read: ID " << readEvent->getID();
-              readEvent->getIRInst()->getInst()->print(llvm::outs());
-              llvm::outs() << ", pts: ";
-            }
-          }
+          if (DEBUG_PTA) printAccess("Read", readEvent);
           // TODO: filter?
-          for (auto obj : ptsTo) {
-            auto &reads = objReads[getObjId(obj)][tid];
-            reads.push_back(readEvent);
-            if (DEBUG_PTA) {
-              llvm::outs() << obj->getValue() << " " << obj->getObjectID() << " " << getObjId(obj) << ", ";
-            }
-          }
-          if (DEBUG_PTA) {
-            llvm::outs() << "\n";
-          }
+          forEachObject(readEvent->getAccessedMemory(), [&](const pta::ObjTy *obj) {
+            place(reads, readCounts, nextRead, nextReadThread, obj->getObjectID(), tid, readEvent);
+          });
           break;
         }
         case Event::Type::Write: {
           auto writeEvent = llvm::cast<WriteEvent>(event.get());
-          auto const ptsTo = writeEvent->getAccessedMemory();
-          if (DEBUG_PTA) {
-            if (ptsTo.empty()) {
-              llvm::outs() << "Write: ID " << writeEvent->getID();
-              writeEvent->getIRInst()->getInst()->print(llvm::outs());
-              llvm::outs() << ", empty pts, "
-                           << "\n";
-              break;
-            } else {
-              llvm::outs() << "Write: ID " << writeEvent->getID();
-              writeEvent->getIRInst()->getInst()->print(llvm::outs());
-              llvm::outs() << ", pts: ";
-            }
-          }
+          if (DEBUG_PTA) printAccess("Write", writeEvent);
           // TODO: filter?
-          for (auto obj : ptsTo) {
-            auto &writes = objWrites[getObjId(obj)][tid];
-            writes.push_back(writeEvent);
-            if (DEBUG_PTA) {
-              llvm::outs() << obj->getValue() << " " << obj->getObjectID() << " " << getObjId(obj) << ", ";
-            }
-          }
-          if (DEBUG_PTA) {
-            llvm::outs() << "\n";
-          }
+          forEachObject(writeEvent->getAccessedMemory(), [&](const pta::ObjTy *obj) {
+            place(writes, writeCounts, nextWrite, nextWriteThread, obj->getObjectID(), tid, writeEvent);
+          });
           break;
         }
         default:
@@ -101,53 +161,47 @@ SharedMemory::SharedMemory(const ProgramTrace &program) {
     }
   }
 }
+
+bool race::isPairOwner(const pta::ObjTy *obj, const MemAccessEvent *lhs, const MemAccessEvent *rhs,
+                 const llvm::DenseSet<const pta::ObjTy *> &sharedObjects) {
+  auto const &lhsPts = lhs->getAccessedMemory();
+  auto const &rhsPts = rhs->getAccessedMemory();
+  // Both accesses touch obj, so it is the only object they can have in common
+  if (lhsPts.size() == 1 || rhsPts.size() == 1) return true;
+
+  // Both sets are sorted the same way, so the first common object is found by a merge walk
+  auto lhsIt = lhsPts.begin();
+  auto rhsIt = rhsPts.begin();
+  while (lhsIt != lhsPts.end() && rhsIt != rhsPts.end()) {
+    if (*lhsIt < *rhsIt) {
+      ++lhsIt;
+    } else if (*rhsIt < *lhsIt) {
+      ++rhsIt;
+    } else {
+      if (sharedObjects.count(*lhsIt) > 0) return *lhsIt == obj;
+      ++lhsIt;
+      ++rhsIt;
+    }
+  }
+  return true;
+}
+
 std::vector<const pta::ObjTy *> SharedMemory::getSharedObjects() const {
   std::vector<const pta::ObjTy *> sharedObjects;
-  for (auto const &[obj, objID] : objIDs) {
+  for (ObjID objID = 0; objID < objects.size(); ++objID) {
+    if (objects[objID] == nullptr) continue;
+
     auto const nWriters = numThreadsWrite(objID);
     auto const nReaders = numThreadsRead(objID);
 
     // Common case: If > 1 writer or 1 writer and 2 reader, guaranteed shared across threads
     if (nWriters > 1 || (nWriters == 1 && nReaders > 1)) {
-      sharedObjects.push_back(obj);
+      sharedObjects.push_back(objects[objID]);
     }
     // When 1 writer and 1 reader, obj is shared if they are not the same thread
-    else if (nWriters == 1 && nReaders == 1 &&
-             objWrites.at(objID).begin()->first != objReads.at(objID).begin()->first) {
-      sharedObjects.push_back(obj);
+    else if (nWriters == 1 && nReaders == 1 && writes.get(objID).front().tid != reads.get(objID).front().tid) {
+      sharedObjects.push_back(objects[objID]);
     }
   }
   return sharedObjects;
 }
-size_t SharedMemory::numThreadsWrite(ObjID id) const {
-  auto it = objWrites.find(id);
-  if (it == objWrites.end()) return 0;
-  return it->second.size();
-}
-size_t SharedMemory::numThreadsRead(SharedMemory::ObjID id) const {
-  auto it = objReads.find(id);
-  if (it == objReads.end()) return 0;
-  return it->second.size();
-}
-std::map<ThreadID, std::vector<const ReadEvent *>> SharedMemory::getThreadedReads(const pta::ObjTy *obj) const {
-  auto id = objIDs.find(obj);
-  if (id == objIDs.end()) return {};
-
-  // cppcheck-suppress stlIfFind
-  if (auto it = objReads.find(id->second); it != objReads.end()) {
-    return it->second;
-  }
-
-  return {};
-}
-std::map<ThreadID, std::vector<const WriteEvent *>> SharedMemory::getThreadedWrites(const pta::ObjTy *obj) const {
-  auto id = objIDs.find(obj);
-  if (id == objIDs.end()) return {};
-
-  // cppcheck-suppress stlIfFind
-  if (auto it = objWrites.find(id->second); it != objWrites.end()) {
-    return it->second;
-  }
-
-  return {};
-}
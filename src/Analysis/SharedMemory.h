@@ -11,37 +11,83 @@ limitations under the License.
 
 #pragma once
 
-#include <map>
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/DenseSet.h>
+
+#include <set>
 
 #include "LanguageModel/RaceModel.h"
 #include "Trace/ProgramTrace.h"
 
 namespace race {
 
-struct SharedMemory {
+// All accesses to one object made by a single thread, in trace order
+template <typename EventTy>
+struct ThreadAccesses {
+  ThreadID tid;
+  llvm::ArrayRef<const EventTy *> events;
+};
+
+// Per-thread accesses to one object, sorted by thread ID
+using ThreadedReads = llvm::ArrayRef<ThreadAccesses<ReadEvent>>;
+using ThreadedWrites = llvm::ArrayRef<ThreadAccesses<WriteEvent>>;
+
+// Points-to sets are multisets, but an access is only recorded once per distinct object it touches
+template <typename Fn>
+void forEachObject(const std::multiset<const pta::ObjTy *> &pts, Fn fn) {
+  for (auto it = pts.begin(); it != pts.end(); it = pts.upper_bound(*it)) {
+    fn(*it);
+  }
+}
+
+// An access whose points-to set holds several shared objects is checked once for every shared object it has in
+// common with the other access. Return true if obj owns the pair: the first shared object, in points-to set order,
+// that both accesses touch.
+bool isPairOwner(const pta::ObjTy *obj, const MemAccessEvent *lhs, const MemAccessEvent *rhs,
+                 const llvm::DenseSet<const pta::ObjTy *> &sharedObjects);
+
+class SharedMemory {
+ public:
+  // Objects are stored in array slots indexed by their pta object ID
   using ObjID = size_t;
-  std::map<const pta::ObjTy *, ObjID> objIDs;
 
-  struct Accesses {
-    std::vector<const ReadEvent *> reads;
-    std::vector<const WriteEvent *> writes;
+ private:
+  // Dense CSR index of every access of one kind (read or write)
+  template <typename EventTy>
+  struct AccessIndex {
+    // every access, grouped by object and then by thread
+    std::vector<const EventTy *> events;
+    // one entry per (object, thread) pair, each viewing a contiguous slice of events
+    std::vector<ThreadAccesses<EventTy>> threads;
+    // threads[objOffsets[obj], objOffsets[obj+1]) are the per-thread accesses to obj
+    std::vector<size_t> objOffsets;
+
+    [[nodiscard]] llvm::ArrayRef<ThreadAccesses<EventTy>> get(ObjID obj) const {
+      if (obj + 1 >= objOffsets.size()) return {};
+      return llvm::makeArrayRef(threads).slice(objOffsets[obj], objOffsets[obj + 1] - objOffsets[obj]);
+    }
   };
 
-  std::map<ObjID, std::map<ThreadID, Accesses>> objAccesses;
+  // pta object for each slot, or nullptr if the object is never accessed
+  std::vector<const pta::ObjTy *> objects;
 
-  std::map<ObjID, std::map<ThreadID, std::vector<const ReadEvent *>>> objReads;
-  std::map<ObjID, std::map<ThreadID, std::vector<const WriteEvent *>>> objWrites;
+  AccessIndex<ReadEvent> reads;
+  AccessIndex<WriteEvent> writes;
 
-  [[nodiscard]] size_t numThreadsWrite(ObjID id) const;
-  [[nodiscard]] size_t numThreadsRead(ObjID id) const;
+  [[nodiscard]] size_t numThreadsWrite(ObjID id) const { return writes.get(id).size(); }
+  [[nodiscard]] size_t numThreadsRead(ObjID id) const { return reads.get(id).size(); }
 
  public:
   explicit SharedMemory(const ProgramTrace &);
 
   [[nodiscard]] std::vector<const pta::ObjTy *> getSharedObjects() const;
 
-  // TODO: wrap this in option?? Make a copy?? Iterator??
-  [[nodiscard]] std::map<ThreadID, std::vector<const ReadEvent *>> getThreadedReads(const pta::ObjTy *obj) const;
-  [[nodiscard]] std::map<ThreadID, std::vector<const WriteEvent *>> getThreadedWrites(const pta::ObjTy *obj) const;
+  // The returned views point into SharedMemory and are valid as long as it is alive
+  [[nodiscard]] ThreadedReads getThreadedReads(const pta::ObjTy *obj) const {
+    return reads.get(obj->getObjectID());
+  }
+  [[nodiscard]] ThreadedWrites getThreadedWrites(const pta::ObjTy *obj) const {
+    return writes.get(obj->getObjectID());
+  }
 };
-}  // namespace race
\ No newline at end of file
+}  // namespace race
@@ -802,6 +802,8 @@ bool race::SimpleArrayAnalysis::canIndexOverlap(const race::MemAccessEvent *even
     return false;
   }
 
+  std::lock_guard<std::mutex> lock(FAMMutex);
+
   // TODO: get rid of const cast?
   auto &targetFun = *const_cast<llvm::Function *>(gep1->getFunction());
   auto &scev = FAM.getResult<ScalarEvolutionAnalysis>(targetFun);
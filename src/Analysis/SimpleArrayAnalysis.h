@@ -14,11 +14,16 @@ limitations under the License.
 #include <Trace/Event.h>
 #include <llvm/Passes/PassBuilder.h>
 
+#include <mutex>
+
 namespace race {
 
 class SimpleArrayAnalysis {
   llvm::PassBuilder PB;
   llvm::FunctionAnalysisManager FAM;
+  // FAM lazily computes and caches analyses, and ScalarEvolution creates new constants in the LLVMContext,
+  // so any query that touches FAM must hold this lock
+  std::mutex FAMMutex;
 
  public:
   SimpleArrayAnalysis();
@@ -20,6 +20,7 @@ limitations under the License.
 
 namespace pta {
 using originCtx = KOrigin<3>;
+// the call-site depth can be lowered per call site with CT::setPolicy, see CtxPolicy
 using ctx = HybridCtx<originCtx, KCallSite<1>>;
 using MemModel = cpp::CppMemModel<ctx>;
 using CallGraphNodeTy = CallGraphNode<ctx>;
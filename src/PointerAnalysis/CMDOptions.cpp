@@ -43,4 +43,32 @@ cl::opt<unsigned> ANON_REC_LIMIT(
 cl::opt<unsigned> ANON_REC_DEPTH_LIMIT(
     "ANON_REC_DEPTH_LIMIT",
     cl::desc("the upperbound of the depth of types considered for a recursively-created anonymous object in a program"),
-    cl::init(10));
\ No newline at end of file
+    cl::init(10));
+cl::opt<unsigned> PTA_DEMAND_BUDGET(
+    "PTA_DEMAND_BUDGET",
+    cl::desc("Compute points-to sets on demand, solving the whole program once a query visits more constraint nodes "
+             "than this (0 solves the whole program up front)"),
+    cl::init(0));
+cl::opt<bool> PTA_SELECTIVE_CTX(
+    "PTA_SELECTIVE_CTX",
+    cl::desc("Pick the context depth of every function from a context-insensitive pre-analysis, so that the functions "
+             "that cause most contexts are not cloned"),
+    cl::init(false));
+
+cl::opt<std::string> PTA_RESULTS_CACHE(
+    "PTA_RESULTS_CACHE",
+    cl::desc("Directory to save the pointer analysis results in, a later run on the same module loads them instead of "
+             "solving it again (empty to disable)"),
+    cl::init(""));
+
+cl::opt<bool> PTA_INCREMENTAL(
+    "PTA_INCREMENTAL",
+    cl::desc("Start from the results of another revision of the module in PTA_RESULTS_CACHE when there are none for the "
+             "module, only solving again what depends on the changed functions"),
+    cl::init(true));
+
+cl::opt<unsigned> PTA_JOBS(
+    "PTA_JOBS",
+    cl::desc("Number of worker threads used to solve the pointer analysis, the points-to results are the same for every "
+             "number"),
+    cl::init(1));
@@ -0,0 +1,111 @@
+/* Copyright 2021 Coderrect Inc. All Rights Reserved.
+Licensed under the GNU Affero General Public License, version 3 or later (“AGPL”), as published by the Free Software
+Foundation. You may not use this file except in compliance with the License. You may obtain a copy of the License at
+https://www.gnu.org/licenses/agpl-3.0.en.html
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an “AS IS” BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <llvm/ADT/DenseMap.h>
+
+#include <deque>
+#include <functional>
+#include <unordered_set>
+#include <utility>
+
+#include "CtxTrait.h"
+
+namespace llvm {
+class Instruction;
+}
+
+namespace pta {
+
+template <typename CtxT>
+class CtxInterner;
+
+// Base of the contexts kept by a CtxInterner, which gives them their id and caches their hash
+class InternedCtx {
+  CtxID id;
+  size_t hash = 0;
+
+  template <typename CtxT>
+  friend class CtxInterner;
+
+ protected:
+  explicit InternedCtx(CtxID id) noexcept : id(id) {}
+
+ public:
+  [[nodiscard]] CtxID getID() const { return id; }
+  [[nodiscard]] size_t getHash() const { return hash; }
+};
+
+// Stores every distinct context of one kind once and numbers them densely from FIRST_INTERNED_CTX_ID.
+// The results of evolve are cached by (id of the previous context, call site), so evolving along a call edge that
+// was seen before is a single lookup instead of building, hashing and comparing a new context.
+template <typename CtxT>
+class CtxInterner {
+  struct CtxHash {
+    size_t operator()(const CtxT *context) const { return context->getHash(); }
+  };
+  struct CtxEqual {
+    bool operator()(const CtxT *lhs, const CtxT *rhs) const { return lhs->getHash() == rhs->getHash() && *lhs == *rhs; }
+  };
+
+  // contexts[id - FIRST_INTERNED_CTX_ID], a deque keeps them at a stable address
+  std::deque<CtxT> contexts;
+  std::unordered_set<const CtxT *, CtxHash, CtxEqual> index;
+  llvm::DenseMap<std::pair<CtxID, const llvm::Instruction *>, const CtxT *> evolveCache;
+
+ public:
+  // the context built by CtxT(args...), interned if it has not been seen before
+  template <typename... Args>
+  const CtxT *intern(Args &&...args) {
+    CtxT &candidate = contexts.emplace_back(std::forward<Args>(args)...);
+    candidate.hash = std::hash<CtxT>()(candidate);
+    auto it = index.find(&candidate);
+    if (it != index.end()) {
+      contexts.pop_back();
+      return *it;
+    }
+    candidate.id = static_cast<CtxID>(FIRST_INTERNED_CTX_ID + contexts.size() - 1);
+    index.insert(&candidate);
+    return &candidate;
+  }
+
+  // the context prevCtx evolves into at call site I, evolveFn(prevCtx, I) computes it on a cache miss
+  template <typename EvolveFn>
+  const CtxT *evolve(const CtxT *prevCtx, const llvm::Instruction *I, EvolveFn evolveFn) {
+    auto [it, inserted] = evolveCache.try_emplace(std::make_pair(prevCtx->getID(), I), nullptr);
+    if (inserted) {
+      // evolveFn might intern, which does not touch the cache, so the iterator stays valid
+      it->second = evolveFn(prevCtx, I);
+    }
+    return it->second;
+  }
+
+  const CtxT *evolve(const CtxT *prevCtx, const llvm::Instruction *I) {
+    return evolve(prevCtx, I, [this](const CtxT *prev, const llvm::Instruction *inst) { return intern(prev, inst); });
+  }
+
+  // the interned context with the given id
+  [[nodiscard]] const CtxT *getContext(CtxID id) const { return &contexts[id - FIRST_INTERNED_CTX_ID]; }
+
+  [[nodiscard]] size_t size() const { return contexts.size(); }
+
+  // forget the cached evolutions, e.g., when the rules deciding them change
+  void clearEvolveCache() { evolveCache.clear(); }
+
+  void clear() {
+    evolveCache.clear();
+    index.clear();
+    contexts.clear();
+  }
+};
+
+}  // namespace pta
@@ -0,0 +1,119 @@
+/* Copyright 2021 Coderrect Inc. All Rights Reserved.
+Licensed under the GNU Affero General Public License, version 3 or later (“AGPL”), as published by the Free Software
+Foundation. You may not use this file except in compliance with the License. You may obtain a copy of the License at
+https://www.gnu.org/licenses/agpl-3.0.en.html
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an “AS IS” BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/Instruction.h>
+
+#include <algorithm>
+#include <set>
+#include <type_traits>
+#include <utility>
+
+#include "CtxTrait.h"
+
+namespace pta {
+
+// The call-site depth of the contexts created at each call site.
+// A call site that is not listed keeps the full depth of the context kind, a depth of 0 does not clone the callee
+// for the call site at all.
+class CtxPolicy {
+  llvm::DenseMap<const llvm::Instruction *, uint32_t> depths;
+
+ public:
+  // a call site might call several functions, it gets the lowest depth of them
+  void setDepth(const llvm::Instruction *callsite, uint32_t depth) {
+    auto [it, inserted] = depths.try_emplace(callsite, depth);
+    if (!inserted) {
+      it->second = std::min(it->second, depth);
+    }
+  }
+
+  [[nodiscard]] uint32_t getDepth(const llvm::Instruction *callsite, uint32_t maxDepth) const {
+    auto it = depths.find(callsite);
+    if (it == depths.end()) return maxDepth;
+    return std::min(it->second, maxDepth);
+  }
+
+  [[nodiscard]] bool empty() const { return depths.empty(); }
+  [[nodiscard]] size_t size() const { return depths.size(); }
+};
+
+// true if the context kind T takes a CtxPolicy
+template <typename T, typename = void>
+struct hasCtxPolicy : std::false_type {};
+
+template <typename T>
+struct hasCtxPolicy<T, std::void_t<decltype(CtxTrait<T>::setPolicy(std::declval<CtxPolicy>()))>> : std::true_type {};
+
+// Thresholds of buildCtxPolicy
+struct CtxPolicyOptions {
+  // functions called from fewer call sites are always cloned
+  size_t minFanIn = 4;
+  // a function is not cloned if (number of call sites) x (points-to volume of its pointers) reaches this
+  size_t maxCost = 50000;
+};
+
+// Pick the context depth of every function from a context-insensitive run of the pointer analysis (pta).
+// Cloning a function for every call site costs about its points-to volume per call site, so the functions whose cost
+// reaches the limit are not cloned, and every other function keeps the full depth of the context.
+// These are typically allocation wrappers, getters and container internals, which are called from everywhere.
+template <typename PTA>
+CtxPolicy buildCtxPolicy(const PTA &pta, const CtxPolicyOptions &options = {}) {
+  struct FunctionInfo {
+    std::set<const llvm::Instruction *> callsites;
+    size_t volume = 0;
+  };
+  llvm::DenseMap<const llvm::Function *, FunctionInfo> infos;
+
+  auto const addVolume = [&](const typename PTA::ctx *context, const llvm::Value *value, FunctionInfo &info) {
+    if (!value->getType()->isPointerTy()) return;
+    std::multiset<const typename PTA::ObjTy *> objects;
+    pta.getPointsTo(context, value, objects);
+    info.volume += objects.size();
+  };
+
+  for (auto node : *pta.getCallGraph()) {
+    if (node->isIndirectCall()) continue;
+    auto const function = node->getTargetFun()->getFunction();
+    auto const context = node->getContext();
+    auto &info = infos[function];
+
+    for (auto it = node->pred_edge_begin(), ie = node->pred_edge_end(); it != ie; it++) {
+      if (auto callsite = it->first.getCallInstruction()) {
+        info.callsites.insert(callsite);
+      }
+    }
+
+    // a function has a node per context, their volumes add up
+    for (auto const &arg : function->args()) {
+      addVolume(context, &arg, info);
+    }
+    for (auto const &inst : llvm::instructions(function)) {
+      addVolume(context, &inst, info);
+    }
+  }
+
+  CtxPolicy policy;
+  for (auto const &[function, info] : infos) {
+    size_t fanIn = info.callsites.size();
+    if (fanIn < options.minFanIn || fanIn * info.volume < options.maxCost) continue;
+    for (auto callsite : info.callsites) {
+      policy.setDepth(callsite, 0);
+    }
+  }
+  return policy;
+}
+
+}  // namespace pta
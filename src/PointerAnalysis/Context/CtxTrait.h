@@ -11,8 +11,34 @@ limitations under the License.
 
 #pragma once
 
+#include <llvm/ADT/Hashing.h>
+
+#include <cstdint>
+#include <utility>
+
 namespace pta {
 
+// Every context of an analysis has a dense id, so tables indexed by a context and a program value can key on
+// (id, value). The initial and the global contexts have fixed ids, the interned ones are numbered after them.
+using CtxID = uint32_t;
+constexpr CtxID INITIAL_CTX_ID = 0;
+constexpr CtxID GLOBAL_CTX_ID = 1;
+constexpr CtxID FIRST_INTERNED_CTX_ID = 2;
+
+// key of the tables indexed by a context and a program value
+template <typename T>
+using CtxKey = std::pair<CtxID, const T *>;
+
+// hash of a CtxKey for the std containers, llvm::DenseMap already handles pairs
+struct CtxKeyHash {
+  template <typename T>
+  size_t operator()(const CtxKey<T> &key) const {
+    return static_cast<size_t>(llvm::hash_combine(key.first, key.second));
+  }
+};
+
+// Every context kind provides a Storage holding the contexts interned by one analysis, and a Scope that makes a
+// Storage the one used on the calling thread, see ScopedInstance.
 template <typename ctx>
 class CtxTrait {
   using unknownTypeError = typename ctx::unknownTypeErrorType;
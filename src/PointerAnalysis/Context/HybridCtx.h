@@ -15,8 +15,10 @@ limitations under the License.
 #include <llvm/IR/Instruction.h>
 
 #include <tuple>
-#include <unordered_set>
+#include <type_traits>
 
+#include "CtxInterner.h"
+#include "CtxPolicy.h"
 #include "CtxTrait.h"
 #include "KOrigin.h"
 
@@ -24,7 +26,7 @@ namespace pta {
 // although we only have two context (origin, callsite)
 // we make it va_args in case of future extension
 template <typename... Args>
-class HybridCtx {
+class HybridCtx : public InternedCtx {
   std::tuple<const Args *...> ctx;
 
  private:
@@ -35,10 +37,12 @@ class HybridCtx {
   }
 
  public:
-  explicit HybridCtx(const Args *...args) : ctx{args...} {}
+  explicit HybridCtx(CtxID id, const Args *...args) : InternedCtx(id), ctx{args...} {}
 
   HybridCtx(const HybridCtx<Args...> *prevCtx, const llvm::Instruction *I)
-      : ctx(evolveInnerContext(prevCtx, I, std::index_sequence_for<Args...>{})) {}
+      : InternedCtx(INITIAL_CTX_ID), ctx(evolveInnerContext(prevCtx, I, std::index_sequence_for<Args...>{})) {}
+
+  explicit HybridCtx(const std::tuple<const Args *...> &ctx) : InternedCtx(INITIAL_CTX_ID), ctx(ctx) {}
 
   const std::tuple<const Args *...> &getContext() const { return ctx; }
 
@@ -77,12 +81,49 @@ struct CtxTrait<HybridCtx<Args...>> {
  private:
   static const HybridCtx<Args...> initCtx;
   static const HybridCtx<Args...> globCtx;
-  static std::unordered_set<HybridCtx<Args...>> ctxSet;
+
+  template <typename Kind, typename Fn>
+  static void forEachInnerCallSite(const Kind *inner, Fn &fn) {
+    CtxTrait<Kind>::forEachCallSite(inner, fn);
+  }
 
  public:
+  struct Storage {
+    CtxInterner<HybridCtx<Args...>> contexts;
+    bool insensitive = false;
+    // the contexts of every kind in the hybrid
+    std::tuple<typename CtxTrait<Args>::Storage...> inner;
+  };
+
+  class Scope {
+    typename ScopedInstance<Storage>::Scope scope;
+    std::tuple<typename CtxTrait<Args>::Scope...> innerScopes;
+
+    template <size_t... N>
+    Scope(Storage &storage, std::index_sequence<N...>) : scope(storage), innerScopes(std::get<N>(storage.inner)...) {}
+
+   public:
+    explicit Scope(Storage &storage) : Scope(storage, std::index_sequence_for<Args...>{}) {}
+  };
+
   static const HybridCtx<Args...> *contextEvolve(const HybridCtx<Args...> *prevCtx, const llvm::Instruction *I) {
-    auto result = ctxSet.emplace(prevCtx, I);
-    return &*result.first;
+    auto &storage = ScopedInstance<Storage>::get();
+    if (storage.insensitive) return prevCtx;
+    return storage.contexts.evolve(
+        prevCtx, I, [&](const HybridCtx<Args...> *prev, const llvm::Instruction *inst) -> const HybridCtx<Args...> * {
+          auto inner = HybridCtx<Args...>::evolveInnerContext(prev, inst, std::index_sequence_for<Args...>{});
+          // with a CtxPolicy every kind might stay at the initial context
+          if (inner == initCtx.ctx) return &initCtx;
+          return storage.contexts.intern(inner);
+        });
+  }
+
+  static CtxID getID(const HybridCtx<Args...> *context) { return context->getID(); }
+
+  // call fn with the slots of every kind of context in the hybrid, in order
+  template <typename Fn>
+  static void forEachCallSite(const HybridCtx<Args...> *context, Fn &&fn) {
+    std::apply([&](auto const *...inner) { (forEachInnerCallSite(inner, fn), ...); }, context->ctx);
   }
 
   static const HybridCtx<Args...> *getInitialCtx() { return &initCtx; }
@@ -95,17 +136,32 @@ struct CtxTrait<HybridCtx<Args...>> {
     return context->toString(detailed);
   }
 
-  static void release() { ctxSet.clear(); }
+  static void release() { ScopedInstance<Storage>::get().contexts.clear(); }
+
+  // When set, contexts never evolve and the analysis becomes context insensitive.
+  // Used as a cheaper fallback when the context sensitive analysis is over budget.
+  static void setContextInsensitive(bool value) { ScopedInstance<Storage>::get().insensitive = value; }
+  static bool isContextInsensitive() { return ScopedInstance<Storage>::get().insensitive; }
+
+  // Hand the policy to the kinds of context that take one, e.g., KCallSite, see CtxPolicy
+  static void setPolicy(const CtxPolicy &policy) {
+    auto const setInnerPolicy = [&policy](auto *kind) {
+      using Kind = std::remove_pointer_t<decltype(kind)>;
+      if constexpr (hasCtxPolicy<Kind>::value) {
+        CtxTrait<Kind>::setPolicy(policy);
+      }
+    };
+    (setInnerPolicy(static_cast<Args *>(nullptr)), ...);
+    // the cached evolutions were decided by the old policy
+    ScopedInstance<Storage>::get().contexts.clearEvolveCache();
+  }
 };
 
 template <typename... Args>
-const HybridCtx<Args...> CtxTrait<HybridCtx<Args...>>::initCtx{CtxTrait<Args>::getInitialCtx()...};
-
-template <typename... Args>
-const HybridCtx<Args...> CtxTrait<HybridCtx<Args...>>::globCtx{CtxTrait<Args>::getGlobalCtx()...};
+const HybridCtx<Args...> CtxTrait<HybridCtx<Args...>>::initCtx{INITIAL_CTX_ID, CtxTrait<Args>::getInitialCtx()...};
 
 template <typename... Args>
-std::unordered_set<HybridCtx<Args...>> CtxTrait<HybridCtx<Args...>>::ctxSet{};
+const HybridCtx<Args...> CtxTrait<HybridCtx<Args...>>::globCtx{GLOBAL_CTX_ID, CtxTrait<Args>::getGlobalCtx()...};
 
 }  // namespace pta
 
@@ -116,7 +172,7 @@ template <typename... Args>
 struct hash<pta::HybridCtx<Args...>> {
   template <size_t... N>
   size_t hash_tuple(const pta::HybridCtx<Args...> &wrapper, std::index_sequence<N...> sequence) const {
-    llvm::hash_code code = llvm::hash_combine(static_cast<const void *>(std::get<N>(wrapper.ctx))...);
+    llvm::hash_code code = llvm::hash_combine(pta::CtxTrait<Args>::getID(std::get<N>(wrapper.ctx))...);
     return hash_value(code);
   }
 
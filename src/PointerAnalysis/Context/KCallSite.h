@@ -14,15 +14,21 @@ limitations under the License.
 #include <llvm/ADT/Hashing.h>
 #include <llvm/Support/raw_ostream.h>
 
+#include <algorithm>
+#include <vector>
+
+#include "CtxInterner.h"
+#include "CtxPolicy.h"
 #include "CtxTrait.h"
 #include "PointerAnalysis/Program/CallSite.h"
+#include "PointerAnalysis/Util/ScopedInstance.h"
 #include "PointerAnalysis/Util/SingleInstanceOwner.h"
 #include "PtrRingBuffer.h"
 
 namespace pta {
 
 template <uint32_t K>
-class KCallSite {
+class KCallSite : public InternedCtx {
  private:
   using self = KCallSite<K>;
   PtrRingBuffer<const llvm::Instruction, K> ctxBuffer;
@@ -30,13 +36,30 @@ class KCallSite {
  public:
   using iterator = typename PtrRingBuffer<const llvm::Instruction, K>::iterator;
 
-  KCallSite() noexcept : ctxBuffer() {}
+  explicit KCallSite(CtxID id = INITIAL_CTX_ID) noexcept : InternedCtx(id), ctxBuffer() {}
 
-  KCallSite(const self *prevCtx, const llvm::Instruction *I) : ctxBuffer(prevCtx->ctxBuffer) {
+  KCallSite(const self *prevCtx, const llvm::Instruction *I)
+      : InternedCtx(INITIAL_CTX_ID), ctxBuffer(prevCtx->ctxBuffer) {
     assert(pta::CallSite(I).isCallOrInvoke());
     ctxBuffer.push(I);
   }
 
+  // only keep the last depth call sites, 0 < depth <= K
+  KCallSite(const self *prevCtx, const llvm::Instruction *I, uint32_t depth)
+      : InternedCtx(INITIAL_CTX_ID), ctxBuffer() {
+    assert(pta::CallSite(I).isCallOrInvoke());
+    assert(depth > 0 && depth <= K);
+    std::vector<const llvm::Instruction *> sites;
+    for (const llvm::Instruction *site : prevCtx->ctxBuffer) {
+      if (site != nullptr) sites.push_back(site);
+    }
+    size_t kept = std::min<size_t>(sites.size(), depth - 1);
+    for (size_t i = sites.size() - kept; i < sites.size(); i++) {
+      ctxBuffer.push(sites[i]);
+    }
+    ctxBuffer.push(I);
+  }
+
   KCallSite(const self &) = delete;
   KCallSite(self &&) = delete;
   KCallSite &operator=(const self &) = delete;
@@ -101,12 +124,43 @@ struct CtxTrait<KCallSite<K>> {
  private:
   static const KCallSite<K> initCtx;
   static const KCallSite<K> globCtx;
-  static std::unordered_set<KCallSite<K>> ctxSet;
 
  public:
+  struct Storage {
+    CtxInterner<KCallSite<K>> contexts;
+    CtxPolicy policy;
+  };
+  using Scope = typename ScopedInstance<Storage>::Scope;
+
   static const KCallSite<K> *contextEvolve(const KCallSite<K> *prevCtx, const llvm::Instruction *I) {
-    auto result = ctxSet.emplace(prevCtx, I);
-    return &*result.first;
+    auto &storage = ScopedInstance<Storage>::get();
+    if (storage.policy.empty()) return storage.contexts.evolve(prevCtx, I);
+
+    return storage.contexts.evolve(
+        prevCtx, I, [&](const KCallSite<K> *prev, const llvm::Instruction *inst) -> const KCallSite<K> * {
+          uint32_t depth = storage.policy.getDepth(inst, K);
+          if (depth == 0) return &initCtx;
+          if (depth == K) return storage.contexts.intern(prev, inst);
+          return storage.contexts.intern(prev, inst, depth);
+        });
+  }
+
+  // Limit the depth of the contexts created at the call sites of the policy, see CtxPolicy
+  static void setPolicy(CtxPolicy policy) {
+    auto &storage = ScopedInstance<Storage>::get();
+    storage.policy = std::move(policy);
+    // the cached evolutions were decided by the old policy
+    storage.contexts.clearEvolveCache();
+  }
+
+  static CtxID getID(const KCallSite<K> *context) { return context->getID(); }
+
+  // call fn with every slot of the context, oldest first, an empty slot is nullptr
+  template <typename Fn>
+  static void forEachCallSite(const KCallSite<K> *context, Fn &&fn) {
+    for (const llvm::Instruction *I : *context) {
+      fn(I);
+    }
   }
 
   static const KCallSite<K> *getInitialCtx() { return &initCtx; }
@@ -119,17 +173,14 @@ struct CtxTrait<KCallSite<K>> {
     return context->toString(detailed);
   }
 
-  static void release() { ctxSet.clear(); }
+  static void release() { ScopedInstance<Storage>::get().contexts.clear(); }
 };
 
 template <uint32_t K>
-const KCallSite<K> CtxTrait<KCallSite<K>>::initCtx{};
-
-template <uint32_t K>
-const KCallSite<K> CtxTrait<KCallSite<K>>::globCtx{};
+const KCallSite<K> CtxTrait<KCallSite<K>>::initCtx{INITIAL_CTX_ID};
 
 template <uint32_t K>
-std::unordered_set<KCallSite<K>> CtxTrait<KCallSite<K>>::ctxSet{};
+const KCallSite<K> CtxTrait<KCallSite<K>>::globCtx{GLOBAL_CTX_ID};
 
 }  // namespace pta
 
@@ -33,13 +33,17 @@ class KOrigin : public KCallSite<K * L> {
   using self = KOrigin<K, L>;
   using super = KCallSite<K * L>;
 
-  static std::function<bool(const self *, const llvm::Instruction *)> callback;
-
  public:
-  KOrigin() noexcept : super() {}
+  explicit KOrigin(CtxID id = INITIAL_CTX_ID) noexcept : super(id) {}
   KOrigin(const self *prevCtx, const llvm::Instruction *I) : super(prevCtx, I) {}
 
-  static void setOriginRules(std::function<bool(const self *, const llvm::Instruction *)> cb) { callback = cb; }
+  // the rules are kept by the analysis in scope
+  static void setOriginRules(std::function<bool(const self *, const llvm::Instruction *)> cb) {
+    auto &storage = ScopedInstance<typename CtxTrait<self>::Storage>::get();
+    storage.callback = std::move(cb);
+    // the cached evolutions were decided by the old rules
+    storage.contexts.clearEvolveCache();
+  }
 
   KOrigin(const self &) = delete;
   KOrigin(self &&) = delete;
@@ -55,22 +59,40 @@ struct CtxTrait<KOrigin<K, L>> {
  private:
   static const KOrigin<K, L> initCtx;
   static const KOrigin<K, L> globCtx;
-  static std::unordered_set<KOrigin<K, L>> ctxSet;
 
  public:
+  struct Storage {
+    CtxInterner<KOrigin<K, L>> contexts;
+    std::function<bool(const KOrigin<K, L> *, const llvm::Instruction *)> callback =
+        [](const KOrigin<K, L> *, const llvm::Instruction *) {
+          // by default no function is origin
+          return false;
+        };
+  };
+  using Scope = typename ScopedInstance<Storage>::Scope;
+
   static const KOrigin<K, L> *contextEvolve(const KOrigin<K, L> *prevCtx, const llvm::Instruction *I) {
     if constexpr (L == 1) {
-      if (KOrigin<K, L>::callback(prevCtx, I)) {
-        auto result = ctxSet.emplace(prevCtx, I);
-        return &*result.first;
-      }
-      return prevCtx;
+      auto &storage = ScopedInstance<Storage>::get();
+      return storage.contexts.evolve(prevCtx, I, [&](const KOrigin<K, L> *prev, const llvm::Instruction *inst) {
+        return storage.callback(prev, inst) ? storage.contexts.intern(prev, inst) : prev;
+      });
     } else {
       llvm_unreachable("No support yet");
     }
   }
 
-  inline static size_t getNumCtx() { return ctxSet.size(); }
+  inline static size_t getNumCtx() { return ScopedInstance<Storage>::get().contexts.size(); }
+
+  static CtxID getID(const KOrigin<K, L> *context) { return context->getID(); }
+
+  // call fn with every slot of the context, oldest first, an empty slot is nullptr
+  template <typename Fn>
+  static void forEachCallSite(const KOrigin<K, L> *context, Fn &&fn) {
+    for (const llvm::Instruction *I : *context) {
+      fn(I);
+    }
+  }
 
   static const KOrigin<K, L> *getInitialCtx() { return &initCtx; }
 
@@ -83,24 +105,14 @@ struct CtxTrait<KOrigin<K, L>> {
     return context->toString(detailed);
   }
 
-  static void release() { ctxSet.clear(); }
+  static void release() { ScopedInstance<Storage>::get().contexts.clear(); }
 };
 
 template <uint32_t K, uint32_t L>
-const KOrigin<K, L> CtxTrait<KOrigin<K, L>>::initCtx{};
-
-template <uint32_t K, uint32_t L>
-const KOrigin<K, L> CtxTrait<KOrigin<K, L>>::globCtx{};
-
-template <uint32_t K, uint32_t L>
-std::unordered_set<KOrigin<K, L>> CtxTrait<KOrigin<K, L>>::ctxSet{};
+const KOrigin<K, L> CtxTrait<KOrigin<K, L>>::initCtx{INITIAL_CTX_ID};
 
 template <uint32_t K, uint32_t L>
-std::function<bool(const KOrigin<K, L> *, const llvm::Instruction *)> KOrigin<K, L>::callback =
-    [](const KOrigin<K, L> *, const llvm::Instruction *) {
-      // by default no function is origin
-      return false;
-    };
+const KOrigin<K, L> CtxTrait<KOrigin<K, L>>::globCtx{GLOBAL_CTX_ID};
 
 }  // namespace pta
 
@@ -27,10 +27,18 @@ using NoCtx = std::nullptr_t;
 
 template <>
 struct CtxTrait<NoCtx> {
+  struct Storage {};
+  struct Scope {
+    explicit Scope(Storage&) {}
+  };
+
   // No runtime overhead when
   constexpr static const NoCtx* contextEvolve(const NoCtx*, const llvm::Instruction*) { return nullptr; }
   constexpr static const NoCtx* getInitialCtx() { return nullptr; }
   constexpr static const NoCtx* getGlobalCtx() { return nullptr; }
+  constexpr static CtxID getID(const NoCtx*) { return INITIAL_CTX_ID; }
+  template <typename Fn>
+  static void forEachCallSite(const NoCtx*, Fn&&) {}
 
   inline static std::string toString(const NoCtx*, bool /* detailed */ = false) { return "<Empty>"; }
   inline static void release(){};
@@ -82,7 +82,6 @@ class CGNodeBase {
   const NodeID id;
   GraphTy *graph;
 
-  Self *superNode;  // the super node
   llvm::SparseBitVector<> childNodes;
   // whether the node is immutable (the points-to set should not be updated)
   bool isImmutable;
@@ -105,7 +104,7 @@ class CGNodeBase {
   IndirectNodeSet indirectNodes;
 
   inline CGNodeBase(NodeID id, CGNodeKind type)
-      : type(type), id(id), superNode(nullptr), childNodes{}, isImmutable(false), indirectNodes{} {}
+      : type(type), id(id), childNodes{}, isImmutable(false), indirectNodes{} {}
 
  private:
   inline bool insertConstraint(Self *node, Constraints edgeKind) {
@@ -166,18 +165,23 @@ class CGNodeBase {
   // after setting the flag, no edges shall be added into the node
   inline void setImmutable() { this->isImmutable = true; }
 
-  inline bool isSuperNode() const { return !childNodes.empty(); }
-
-  inline void setSuperNode(Self *node) { this->superNode = node; }
+  [[nodiscard]] inline bool isImmutableNode() const { return this->isImmutable; }
 
-  inline Self *getSuperNode() {
-    Self *node = this;
-    while (node->superNode != nullptr) {
-      node = node->superNode;
-    }
-    return node;
+  // whether there is this --edgeKind--> node
+  [[nodiscard]] inline bool hasConstraint(const Self *node, Constraints edgeKind) const {
+    auto index = static_cast<std::underlying_type<Constraints>::type>(edgeKind);
+#ifdef USE_NODE_ID_FOR_CONSTRAINTS
+    return succCons[index].test(node->getNodeID());
+#else
+    return succCons[index].count(const_cast<Self *>(node)) != 0;
+#endif
   }
 
+  inline bool isSuperNode() const { return !childNodes.empty(); }
+
+  // the super node is tracked by the union-find of the constraint graph
+  inline Self *getSuperNode() { return this->getGraph()->getCGNode(this->getGraph()->findSuperNodeID(id)); }
+
   // remove all the edges
   inline void clearConstraints() {
 #ifdef USE_NODE_ID_FOR_CONSTRAINTS
@@ -231,7 +235,9 @@ class CGNodeBase {
 
   [[nodiscard]] inline CGNodeKind getType() const { return type; }
 
-  [[nodiscard]] inline bool hasSuperNode() const { return superNode != nullptr; }
+  [[nodiscard]] inline bool hasSuperNode() const {
+    return static_cast<const ConstraintGraph<ctx> *>(this->graph)->hasSuperNode(id);
+  }
 
   inline void setIndirectCallNode(CallGraphNode<ctx> *callNode) {
     // assert(callNode->isIndirectCall() && this->indirectNode == nullptr);
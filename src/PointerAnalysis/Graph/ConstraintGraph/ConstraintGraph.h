@@ -13,6 +13,9 @@ limitations under the License.
 
 #include <llvm/Support/CommandLine.h>
 
+#include <algorithm>
+#include <vector>
+
 #include "CGObjNode.h"
 #include "CGPtrNode.h"
 #include "PointerAnalysis/Graph/GraphBase/GraphBase.h"
@@ -40,15 +43,94 @@ class ConstraintGraph : public GraphBase<CGNodeBase<ctx>, Constraints> {
     virtual void onNewConstraint(CGNodeTy *src, CGNodeTy *dst, Constraints constraint) = 0;
   };
 
+  // an edge as it was inserted, src --constraint--> dst
+  struct Edge {
+    NodeID src;
+    NodeID dst;
+    Constraints constraint;
+  };
+
  private:
   OnNewConstraintCallBack *callBack;
   std::vector<CGNodeTy *> objVec;
 
+  // union-find of the super nodes indexed by node id, a node is its own parent until it is collapsed
+  std::vector<NodeID> superParents;
+  std::vector<uint8_t> superRanks;
+
+  // the edges inserted while logging is on, apart from those inserted by a callback, see setEdgeLogging
+  std::vector<Edge> edgeLog;
+  bool logEdges = false;
+
+  inline void onEdgeInserted(CGNodeTy *src, CGNodeTy *dst, Constraints constraint) {
+    if (logEdges) {
+      edgeLog.push_back({src->getNodeID(), dst->getNodeID(), constraint});
+    }
+  }
+
+  inline void notifyCallBack(CGNodeTy *src, CGNodeTy *dst, Constraints constraint) {
+    // the constraints added by the callback are its own, not part of the change being logged
+    bool logging = logEdges;
+    logEdges = false;
+    callBack->onNewConstraint(src, dst, constraint);
+    logEdges = logging;
+  }
+
  public:
+  // find the id of the super node of id (id itself if it has none), compressing the path to it
+  inline NodeID findSuperNodeID(NodeID id) {
+    NodeID root = id;
+    while (superParents[root] != root) {
+      root = superParents[root];
+    }
+    while (superParents[id] != root) {
+      NodeID next = superParents[id];
+      superParents[id] = root;
+      id = next;
+    }
+    return root;
+  }
+
+  // same as findSuperNodeID, but never writes to the graph, so it can be called from multiple threads
+  [[nodiscard]] inline NodeID peekSuperNodeID(NodeID id) const {
+    while (superParents[id] != id) {
+      id = superParents[id];
+    }
+    return id;
+  }
+
+  [[nodiscard]] inline bool hasSuperNode(NodeID id) const { return superParents[id] != id; }
+
+  // the parent of id in the super node forest, which is its super node once the forest is flattened
+  [[nodiscard]] inline NodeID getSuperParentID(NodeID id) const { return superParents[id]; }
+
+  // point every node directly to its super node, after which lookups no longer write to the graph
+  void flattenSuperNodes() {
+    for (NodeID id = 0; id < superParents.size(); id++) {
+      findSuperNodeID(id);
+    }
+  }
+
+  // the node of the scc with the highest rank, collapsing the scc into it keeps the union-find shallow
+  [[nodiscard]] CGNodeTy *selectSuperNode(const std::vector<CGNodeTy *> &scc) const {
+    CGNodeTy *superNode = scc.front();
+    for (CGNodeTy *node : scc) {
+      if (superRanks[node->getNodeID()] > superRanks[superNode->getNodeID()]) {
+        superNode = node;
+      }
+    }
+    return superNode;
+  }
+
   inline void registerCallBack(OnNewConstraintCallBack *cb) { callBack = cb; }
 
   inline void unregisterCallBack() { callBack = nullptr; }
 
+  // Log the edges inserted from now on, until disabled
+  inline void setEdgeLogging(bool enable) { logEdges = enable; }
+  [[nodiscard]] inline bool isEdgeLogging() const { return logEdges; }
+  [[nodiscard]] inline const std::vector<Edge> &getEdgeLog() const { return edgeLog; }
+
   //    inline CGNodeTy *operator[](NodeID id) const {
   //        return this->getNode(id);
   //    }
@@ -60,6 +142,8 @@ class ConstraintGraph : public GraphBase<CGNodeBase<ctx>, Constraints> {
 
   inline CGNodeTy *getCGNode(NodeID id) const { return this->getNode(id); }
 
+  [[nodiscard]] inline size_t getObjectNum() const { return objVec.size(); }
+
   inline bool addConstraints(CGNodeTy *src, CGNodeTy *dst, Constraints constraint) {
     if (DEBUG_PTA) {
       std::string type = "";  // copy
@@ -105,18 +189,22 @@ class ConstraintGraph : public GraphBase<CGNodeBase<ctx>, Constraints> {
       assert(llvm::cast<CGPtrNode<ctx>>(anonNode)->isAnonNode());
 
       if (anonNode->insertConstraint(dst, Constraints::copy)) {
+        onEdgeInserted(anonNode, dst, Constraints::copy);
         if (callBack) {
           // the edge is actually adding to the super node
-          callBack->onNewConstraint(anonNode, dst->getSuperNode(), Constraints::copy);
+          notifyCallBack(anonNode, dst->getSuperNode(), Constraints::copy);
         }
         return true;
       }
       return false;
     } else {
       bool newEdge = src->insertConstraint(dst, constraint);
+      if (newEdge) {
+        onEdgeInserted(src, dst, constraint);
+      }
       if (callBack && newEdge) {
         // the edge is actually adding to the super node
-        callBack->onNewConstraint(src->getSuperNode(), dst->getSuperNode(), constraint);
+        notifyCallBack(src->getSuperNode(), dst->getSuperNode(), constraint);
       }
       return newEdge;
     }
@@ -132,6 +220,7 @@ class ConstraintGraph : public GraphBase<CGNodeBase<ctx>, Constraints> {
       assert(!node->hasSuperNode());
     }
 
+    uint8_t &rank = superRanks[superNode->getNodeID()];
     for (CGNodeTy *node : scc) {
       if (node == superNode) {
         continue;
@@ -162,7 +251,9 @@ class ConstraintGraph : public GraphBase<CGNodeBase<ctx>, Constraints> {
       node->childNodes.clear();  // release the memory
       node->clearConstraints();
 
-      node->setSuperNode(superNode);  // set the supernode
+      // set the supernode, union by rank
+      superParents[node->getNodeID()] = superNode->getNodeID();
+      rank = std::max(rank, static_cast<uint8_t>(superRanks[node->getNodeID()] + 1));
     }
   }
 
@@ -171,6 +262,8 @@ class ConstraintGraph : public GraphBase<CGNodeBase<ctx>, Constraints> {
   template <typename Node, typename PT, typename... Args>
   inline Node *addCGNode(Args &&...args) {
     auto node = this->template addNewNode<Node>(std::forward<Args>(args)...);
+    superParents.push_back(node->getNodeID());
+    superRanks.push_back(0);
     PT::onNewNodeCreation(node->getNodeID());
 
     if (node->getType() == CGNodeKind::ObjNode) {
@@ -178,6 +271,7 @@ class ConstraintGraph : public GraphBase<CGNodeBase<ctx>, Constraints> {
       // Convention! objnode_id + 1 = anonomyous node
       CGPtrNode<ctx> *anonNode = addCGNode<CGPtrNode<ctx>, PT>();
       node->insertConstraint(anonNode, Constraints::addr_of);
+      onEdgeInserted(node, anonNode, Constraints::addr_of);
       // Anonmyous Node can points to the object
       // PT::insert(anonNode->getNodeID(), node->getNodeID());
       if constexpr (!std::is_same<Node, CGPtrNode<ctx>>::value) {
@@ -190,7 +284,8 @@ class ConstraintGraph : public GraphBase<CGNodeBase<ctx>, Constraints> {
     return node;
   }
 
-  ConstraintGraph() : GraphBase<CGNodeBase<ctx>, Constraints>(), callBack(nullptr), objVec(){};
+  ConstraintGraph()
+      : GraphBase<CGNodeBase<ctx>, Constraints>(), callBack(nullptr), objVec(), superParents(), superRanks(){};
 };
 
 }  // namespace pta
@@ -11,9 +11,8 @@ limitations under the License.
 
 #pragma once
 
-#include <llvm/ADT/BitVector.h>
-
 #include <utility>
+#include <vector>
 
 #include "ConstraintGraph.h"
 
@@ -56,8 +55,9 @@ class SCCIterator : public llvm::iterator_facade_base<SCCIterator<ctx, cons, rev
   unsigned visitNum{};
 
   /// the number indicates when the node is access in DFS
-  /// nodeVisitNumbers are per-node visit numbers, also used as DFS flags.
-  llvm::DenseMap<NodeRef, unsigned> nodeVisitNumbers;
+  /// nodeVisitNumbers are per-node visit numbers indexed by node id, also used as DFS flags.
+  /// 0 means the node has not been seen yet.
+  std::vector<unsigned> nodeVisitNumbers;
 
   /// Stack holding nodes of the SCC.
   std::vector<NodeRef> SCCNodeStack;
@@ -65,13 +65,15 @@ class SCCIterator : public llvm::iterator_facade_base<SCCIterator<ctx, cons, rev
   /// The current SCC, retrieved using operator*().
   SccTy CurrentSCC;
 
-  /// BitVector that tracks the node that haven't been visited
+  /// Roots of the DFS, every node of the graph when empty,
   /// since contraint graph are not always connected.
-  llvm::BitVector visitedNode;
-  llvm::BitVector trueVisitedNode;
+  std::vector<NodeID> roots;
+
+  /// the next root to try
+  size_t nextRoot{};
 
-  /// last Root we visited
-  unsigned int lastRoot{};
+  /// number of roots
+  size_t numRoots{};
 
   /// DFS stack, Used to maintain the ordering.  The top contains the current
   /// node, the next child to visit, and the minimum uplink value of all child
@@ -88,23 +90,17 @@ class SCCIterator : public llvm::iterator_facade_base<SCCIterator<ctx, cons, rev
 
   const GraphT *consG;
 
-  explicit SCCIterator(const GraphT &G)
-      : visitNum(0), visitedNode(G.getNodeNum()), trueVisitedNode(G.getNodeNum()), lastRoot(0), consG(&G) {
-    NodeRef entryN = G[0];
-    DFSVisitOne(entryN);
-    GetNextSCC();
+  explicit SCCIterator(const GraphT &G) : nodeVisitNumbers(G.getNodeNum(), 0), numRoots(G.getNodeNum()), consG(&G) {
+    nextSubGraph();
   }
 
-  explicit SCCIterator(const GraphT &G, llvm::BitVector workList)
-      : visitNum(0), visitedNode(std::move(workList)), trueVisitedNode(G.getNodeNum()), lastRoot(0), consG(&G) {
-    int _first = visitedNode.find_first_unset();
-    if (_first < 0) {
-      return;
-    }
-    unsigned int first = static_cast<unsigned int>(_first);
-    NodeRef entryN = G.getCGNode(first);
-    DFSVisitOne(entryN);
-    GetNextSCC();
+  // only DFS from the roots, nodes that can not be reached from them are skipped.
+  // visitNumbers are reused from a previous traversal (see releaseVisitNumbers), they must be all 0.
+  explicit SCCIterator(const GraphT &G, std::vector<NodeID> rootNodes, std::vector<unsigned> visitNumbers)
+      : nodeVisitNumbers(std::move(visitNumbers)), roots(std::move(rootNodes)), consG(&G) {
+    nodeVisitNumbers.resize(G.getNodeNum(), 0);
+    numRoots = roots.size();
+    nextSubGraph();
   }
 
   /// End is when the DFS stack is empty.
@@ -149,13 +145,16 @@ class SCCIterator : public llvm::iterator_facade_base<SCCIterator<ctx, cons, rev
  public:
   static SCCIterator<ctx, cons, reverse> begin(const GraphT &G) { return SCCIterator<ctx, cons, reverse>(G); }
 
-  static SCCIterator<ctx, cons, reverse> begin(const GraphT &G, const llvm::BitVector &workList) {
-    return SCCIterator<ctx, cons, reverse>(G, workList);
+  static SCCIterator<ctx, cons, reverse> begin(const GraphT &G, std::vector<NodeID> roots,
+                                               std::vector<unsigned> visitNumbers) {
+    return SCCIterator<ctx, cons, reverse>(G, std::move(roots), std::move(visitNumbers));
   }
 
   static SCCIterator<ctx, cons, reverse> end(const GraphT &) { return SCCIterator<ctx, cons, reverse>(); }
 
-  [[nodiscard]] size_t visitedNodeNum() const { return this->visitedNode.size(); }
+  // hand the visit numbers back so that the next traversal can reuse them,
+  // the caller resets the nodes visited by this traversal to 0 first.
+  std::vector<unsigned> releaseVisitNumbers() { return std::move(nodeVisitNumbers); }
 
   bool operator==(const SCCIterator &x) const { return VisitStack == x.VisitStack && CurrentSCC == x.CurrentSCC; }
 
@@ -165,21 +164,15 @@ class SCCIterator : public llvm::iterator_facade_base<SCCIterator<ctx, cons, rev
     // the current sub graph
     assert(CurrentSCC.empty());
 
-    // we need to check the next
-    int _lastRoot = visitedNode.find_next_unset(lastRoot);
-
-    while (_lastRoot > 0) {
-      lastRoot = static_cast<unsigned int>(_lastRoot);
-      // there are extra node we need to traverse
-      NodeRef root = consG->getNode(lastRoot);
-
-      if (!root->hasSuperNode()) {
-        DFSVisitOne(consG->getNode(lastRoot));
+    while (nextRoot < numRoots) {
+      NodeID id = roots.empty() ? static_cast<NodeID>(nextRoot) : roots[nextRoot];
+      nextRoot++;
+      // skip node that has been visited or has super nodes.
+      NodeRef root = consG->getNode(id);
+      if (nodeVisitNumbers[id] == 0 && !root->hasSuperNode()) {
+        DFSVisitOne(root);
         GetNextSCC();
         return true;
-      } else {
-        // skip node that has super nodes.
-        _lastRoot = visitedNode.find_next_unset(lastRoot);
       }
     }
     // here we finished traverse the graph
@@ -212,15 +205,11 @@ class SCCIterator : public llvm::iterator_facade_base<SCCIterator<ctx, cons, rev
 template <typename ctx, Constraints cons, bool reverse>
 void SCCIterator<ctx, cons, reverse>::DFSVisitOne(NodeRef N) {
   ++visitNum;
-  nodeVisitNumbers[N] = visitNum;
+  nodeVisitNumbers[N->getNodeID()] = visitNum;
   SCCNodeStack.push_back(N);
 
   // only detect scc that connected by copy edges
   VisitStack.push_back(StackElement(N, child_begin(N) /*N->pred_copy_begin()*/, visitNum));
-  // this should be the first time to visit the node.
-  // assert(!visitedNode.test(N->getNodeID()));
-  visitedNode.set(N->getNodeID());
-  trueVisitedNode.set(N->getNodeID());
 
 #ifdef DEBUG_OUTPUT  // Enable if needed when debugging.
   llvm::dbgs() << "TarjanSCC: Node " << N->getNodeID() << " : visitNum = " << visitNum << "\n";
@@ -233,15 +222,14 @@ void SCCIterator<ctx, cons, reverse>::DFSVisitChildren() {
   while (VisitStack.back().NextChild != child_end(VisitStack.back().Node) /*VisitStack.back().Node->pred_copy_end()*/) {
     // TOS has at least one more child so continue DFS
     NodeRef childN = *VisitStack.back().NextChild++;
-    auto Visited = nodeVisitNumbers.find(childN);
+    unsigned childNum = nodeVisitNumbers[childN->getNodeID()];
 
-    if (Visited == nodeVisitNumbers.end()) {
+    if (childNum == 0) {
       // this node has never been seen.
       DFSVisitOne(childN);
       continue;
     }
     // node has been visited, update the min value
-    unsigned childNum = Visited->second;
     if (VisitStack.back().MinVisited > childNum) VisitStack.back().MinVisited = childNum;
   }
 }
@@ -265,10 +253,10 @@ void SCCIterator<ctx, cons, reverse>::GetNextSCC() {
 
 #ifdef DEBUG_OUTPUT  // Enable if needed when debugging.
     llvm::dbgs() << "TarjanSCC: Popped node " << visitingN->getNodeID() << " : minVisitNum = " << minVisitNum
-                 << "; Node visit num = " << nodeVisitNumbers[visitingN] << "\n";
+                 << "; Node visit num = " << nodeVisitNumbers[visitingN->getNodeID()] << "\n";
 #endif
 
-    if (minVisitNum != nodeVisitNumbers[visitingN]) continue;
+    if (minVisitNum != nodeVisitNumbers[visitingN->getNodeID()]) continue;
 
     // A full SCC is on the SCCNodeStack!  It includes all nodes below
     // visitingN on the stack.  Copy those nodes to CurrentSCC,
@@ -278,7 +266,7 @@ void SCCIterator<ctx, cons, reverse>::GetNextSCC() {
       CurrentSCC.push_back(SCCNodeStack.back());
       SCCNodeStack.pop_back();
       // reset the visit numbers
-      nodeVisitNumbers[CurrentSCC.back()] = ~0U;
+      nodeVisitNumbers[CurrentSCC.back()->getNodeID()] = ~0U;
     } while (CurrentSCC.back() != visitingN);
     return;
   }
@@ -301,8 +289,9 @@ SCCIterator<ctx, cons, reverse> scc_begin(const ConstraintGraph<ctx> &G) {
 
 /// Construct the begin iterator for a deduced graph type T.
 template <typename ctx, Constraints cons, bool reverse = true>
-SCCIterator<ctx, cons, reverse> scc_begin(const ConstraintGraph<ctx> &G, const llvm::BitVector &workList) {
-  return SCCIterator<ctx, cons, reverse>::begin(G, workList);
+SCCIterator<ctx, cons, reverse> scc_begin(const ConstraintGraph<ctx> &G, std::vector<NodeID> roots,
+                                          std::vector<unsigned> visitNumbers = {}) {
+  return SCCIterator<ctx, cons, reverse>::begin(G, std::move(roots), std::move(visitNumbers));
 }
 
 /// Construct the end iterator for a deduced graph type T.
@@ -311,10 +300,4 @@ SCCIterator<ctx, cons, reverse> scc_end(const ConstraintGraph<ctx> &G) {
   return SCCIterator<ctx, cons, reverse>::end(G);
 }
 
-/// Construct the end iterator for a deduced graph type T.
-template <typename ctx, Constraints cons, bool reverse = true>
-SCCIterator<ctx, cons, reverse> scc_end(const ConstraintGraph<ctx> &G, const llvm::BitVector & /*workList*/) {
-  return SCCIterator<ctx, cons, reverse>::end(G);
-}
-
 }  // namespace pta
@@ -17,6 +17,7 @@ limitations under the License.
 #include <llvm/IR/Module.h>
 
 #include <unordered_map>
+#include <vector>
 
 #include "Logging/Log.h"
 #include "PointerAnalysis/Graph/ConstraintGraph/ConstraintGraph.h"
@@ -43,6 +44,19 @@ enum class IndirectResolveOption {
                // limit has been exceeded.
 };
 
+// A change made to the graph while solving that adds nodes to it.
+// Replaying the events of a run in order on a freshly constructed graph gives the same nodes and objects,
+// with the same ids, as the run had after solving.
+struct SolveEvent {
+  enum class Kind : uint32_t {
+    IndexObject,  // object id indexed by the GEP instruction value
+    ResolveCall,  // indirect call graph node id resolved to the function value
+  };
+  Kind kind;
+  NodeID id;
+  const llvm::Value *value;
+};
+
 // bool isCompatibleCall(const llvm::Instruction *indirectCall, const
 // llvm::Function *target);
 
@@ -228,6 +242,9 @@ class ConsGraphBuilder : public llvm::CtxInstVisitor<ctx, SubClass>, public PtrN
               bool newTarget = indirectNode->getTargetFunPtr()->resolvedTo(target, applyLimit);
 
               if (newTarget) {
+                if (logSolve) {
+                  solveLog.push_back({SolveEvent::Kind::ResolveCall, indirectNode->getNodeID(), target});
+                }
                 module->resolveCallTo(indirectNode, target, beforeNewNode, onNewDirect, onNewInDirect, onNewEdge);
 
                 LOG_TRACE("Resolved Indirect Call. In={}, from={}, to={}",
@@ -379,7 +396,39 @@ class ConsGraphBuilder : public llvm::CtxInstVisitor<ctx, SubClass>, public PtrN
 
   inline CGNodeTy *indexObject(ObjNode *objNode, const llvm::Instruction *idx) {
     auto object = objNode->getObject();
-    return MMT::template indexObject<PT>(getMemModel(), object, idx);
+    size_t nodeNum = consGraph->getNodeNum();
+    CGNodeTy *fieldObj = MMT::template indexObject<PT>(getMemModel(), object, idx);
+    if (logSolve && consGraph->getNodeNum() != nodeNum) {
+      solveLog.push_back({SolveEvent::Kind::IndexObject, objNode->getObjectID(), idx});
+    }
+    return fieldObj;
+  }
+
+  // the events logged while logSolve is set
+  std::vector<SolveEvent> solveLog;
+  bool logSolve = false;
+
+  // redo an event logged by another run, returns false if it does not apply to this graph
+  bool replaySolveEvent(const SolveEvent &event) {
+    if (event.kind == SolveEvent::Kind::IndexObject) {
+      auto idx = llvm::dyn_cast_or_null<llvm::Instruction>(event.value);
+      if (idx == nullptr || event.id >= consGraph->getObjectNum()) return false;
+      indexObject(llvm::cast<ObjNode>(consGraph->getObjectNode(event.id)), idx);
+      return true;
+    }
+
+    auto target = llvm::dyn_cast_or_null<llvm::Function>(event.value);
+    auto callGraph = module->getCallGraph();
+    if (target == nullptr || event.id >= callGraph->getNodeNum()) return false;
+    CallNodeTy *indirectNode = callGraph->getNode(event.id);
+    if (!indirectNode->isIndirectCall()) return false;
+    if (indirectNode->getTargetFunPtr()->resolvedTo(target, false)) {
+      if (logSolve) {
+        solveLog.push_back(event);
+      }
+      module->resolveCallTo(indirectNode, target, beforeNewNode, onNewDirect, onNewInDirect, onNewEdge);
+    }
+    return true;
   }
 
   void addLocals() {
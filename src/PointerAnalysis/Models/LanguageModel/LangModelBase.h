@@ -174,6 +174,16 @@ struct LangModelTrait<LangModelBase<ctx, MemModel, PtsTy, SubClass>> {
 
   static inline void constructConsGraph(LangModelTy *model) { model->constructConsGraph(); }
 
+  // log the changes that add nodes to the graph while solving, see SolveEvent
+  static inline void setSolveLogging(LangModelTy *model, bool enable) { model->logSolve = enable; }
+
+  static inline const std::vector<SolveEvent> &getSolveLog(const LangModelTy *model) { return model->solveLog; }
+
+  // returns false if the event does not apply to the graph of the model
+  static inline bool replaySolveEvent(LangModelTy *model, const SolveEvent &event) {
+    return model->replaySolveEvent(event);
+  }
+
   static inline CGNodeTy *indexObject(LangModelTy *model, ObjNodeTy *objNode, const llvm::Instruction *idx) {
     return model->indexObject(objNode, idx);
   }
@@ -242,6 +252,8 @@ struct LangModelTrait<LangModelBase<ctx, MemModel, PtsTy, SubClass>> {
     return model->getPtrNode(C, V);
   }
 
+  static inline bool isRetNode(const LangModelTy *model, const PtrNode *node) { return model->isRetNode(node); }
+
   static inline bool isHeapAllocAPI(LangModelTy *model, const llvm::Function *fun) {
     return model->isHeapAllocAPI(fun);
   }
@@ -54,7 +54,7 @@ class PtrNodeManager : public SingleInstanceOwner<Pointer<ctx>> {
  public:
   // return map does not managed by singleinstanceowner as it may conflict
   // with function pointers (when initialCtx and globalCtx are the same)
-  std::unordered_map<std::pair<const ctx *, const llvm::Function *>, Pointer<ctx>> retPtrMap;
+  std::unordered_map<CtxKey<llvm::Function>, Pointer<ctx>, CtxKeyHash> retPtrMap;
   //    an anonoymous pointer but can be indexed
   //    std::unordered_map<std::pair<const ctx *, const void *>, PtrNode *>
   //    taggedAnonPtrMap;
@@ -64,9 +64,9 @@ class PtrNodeManager : public SingleInstanceOwner<Pointer<ctx>> {
 
   template <typename PT>
   inline PtrNode *createRetNode(const CtxFunction<ctx> *fun) {
-    auto result =
-        retPtrMap.emplace(std::piecewise_construct, std::forward_as_tuple(fun->getContext(), fun->getFunction()),
-                          std::forward_as_tuple(fun->getContext(), fun->getFunction()));
+    auto result = retPtrMap.emplace(std::piecewise_construct,
+                                    std::forward_as_tuple(CT::getID(fun->getContext()), fun->getFunction()),
+                                    std::forward_as_tuple(fun->getContext(), fun->getFunction()));
 
     assert(result.second);
     auto retPtr = &result.first->second;
@@ -78,11 +78,21 @@ class PtrNodeManager : public SingleInstanceOwner<Pointer<ctx>> {
   }
 
   inline PtrNode *getRetNode(const ctx *C, const llvm::Function *F) {
-    auto it = retPtrMap.find(std::make_pair(C, F));
+    auto it = retPtrMap.find(std::make_pair(CT::getID(C), F));
     assert(it != retPtrMap.end());
     return it->second.getPtrNode();
   }
 
+  // the return node of a function holds the function as its value, just like the pointer to the function
+  inline bool isRetNode(const PtrNode *node) const {
+    auto F = llvm::dyn_cast<llvm::Function>(node->getPointer()->getValue());
+    if (F == nullptr) {
+      return false;
+    }
+    auto it = retPtrMap.find(std::make_pair(CT::getID(node->getContext()), F));
+    return it != retPtrMap.end() && &it->second == node->getPointer();
+  }
+
   // anonoyous ptr node should never be indexed, just a place holder
   // logically exist, but no corresponding llvm::Value
   template <typename PT>
@@ -57,9 +57,7 @@ class CppMemModel : public FSMemModel<ctx> {
   using Canonicalizer = FSCanonicalizer;
 
   explicit CppMemModel(ConsGraphTy &consGraph, PtrManager &owner, llvm::Module &M)
-      : Super(consGraph, owner, M, Super::MemModelKind::CPP) {
-    TypeMDinit(&M);
-  }
+      : Super(consGraph, owner, M, Super::MemModelKind::CPP) {}
 
  private:
   PtrNode *getPtrNode(const ctx *C, const llvm::Value *V) {
@@ -18,16 +18,10 @@ using namespace llvm;
 namespace pta {
 
 bool isVTablePtrType(const llvm::Type *type) {
-  static Type *vtableType = nullptr;
-
-  if (vtableType == nullptr) {
-    // vtable type i32 (...)**
-    auto &C = type->getContext();
-    auto elemTy = FunctionType::get(IntegerType::get(C, 32), true);
-    vtableType = PointerType::get(PointerType::get(elemTy, 0), 0);
-  }
-
-  return type == vtableType;
+  // vtable type i32 (...)**, types are uniqued per LLVMContext so it can not be cached across modules
+  auto &C = type->getContext();
+  auto elemTy = FunctionType::get(IntegerType::get(C, 32), true);
+  return type == PointerType::get(PointerType::get(elemTy, 0), 0);
 }
 
 }  // namespace pta
\ No newline at end of file
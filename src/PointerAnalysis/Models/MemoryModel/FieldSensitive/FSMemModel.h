@@ -21,6 +21,7 @@ limitations under the License.
 #include "PointerAnalysis/Models/MemoryModel/FieldSensitive/FSObject.h"
 #include "PointerAnalysis/Models/MemoryModel/FieldSensitive/Layout/MemLayoutManager.h"
 #include "PointerAnalysis/Models/MemoryModel/FieldSensitive/MemBlock.h"
+#include "PointerAnalysis/Util/TypeMetaData.h"
 #include "PointerAnalysis/Util/Util.h"
 
 extern cl::opt<bool> CONFIG_USE_FI_MODE;
@@ -47,7 +48,7 @@ class FSMemModel {
   using ConsGraphTy = ConstraintGraph<ctx>;
   using PtrManager = PtrNodeManager<ctx>;
   using MemBlockAllocator = llvm::BumpPtrAllocator;
-  using CtxAllocPair = std::pair<const ctx *, const llvm::Value *>;
+  using CtxAllocPair = CtxKey<llvm::Value>;
 
   enum class MemModelKind {
     FS,   // normal field sensitive
@@ -83,7 +84,7 @@ class FSMemModel {
     if (llvm::isa<llvm::GlobalVariable>(v)) {
       c = CT::getGlobalCtx();
     }
-    auto it = memBlockMap.find(std::make_pair(c, v));
+    auto it = memBlockMap.find(std::make_pair(CT::getID(c), v));
     assert(it != memBlockMap.end() && "can not find the memory block");
     return it->second;
   }
@@ -94,7 +95,7 @@ class FSMemModel {
     MemBlock<ctx> *block = new (Allocator) BlockT(c, v, std::forward<Args>(args)...);
     // we do not to put anonymous object into the map
     if (block->getAllocSite().getAllocType() != AllocKind::Anonymous) {
-      std::tie(std::ignore, result) = this->memBlockMap.insert(std::make_pair(std::make_pair(c, v), block));
+      std::tie(std::ignore, result) = this->memBlockMap.insert(std::make_pair(std::make_pair(CT::getID(c), v), block));
       // must be adding a new memory block
       assert(result && "allocating a existing memory block");
     }
@@ -186,7 +187,9 @@ class FSMemModel {
   using Canonicalizer = FSCanonicalizer;
 
   FSMemModel(ConsGraphTy &consGraph, PtrManager &owner, llvm::Module &M, MemModelKind kind = MemModelKind::FS)
-      : kind(kind), ptrManager(owner), consGraph(consGraph), module(M) {}
+      : kind(kind), ptrManager(owner), consGraph(consGraph), module(M) {
+    TypeMDinit(&M);
+  }
 
  protected:
   template <typename PT>
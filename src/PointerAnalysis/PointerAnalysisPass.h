@@ -31,8 +31,6 @@ class PointerAnalysisPass : public llvm::ImmutablePass {
         return;
       }
     }
-    // release previous context
-    Solver::CT::release();
     solver.reset(new Solver());
     // auto start = std::chrono::steady_clock::now();
     solver->analyze(M, entry);
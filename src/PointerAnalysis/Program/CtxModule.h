@@ -26,10 +26,12 @@ class CtxModule {
   using CallGraphTy = CallGraph<ctx>;
   using CallNodeTy = CallGraphNode<ctx>;
 
-  using KeyType = std::pair<const ctx *, const llvm::Value *>;
+  using KeyType = CtxKey<llvm::Value>;
   llvm::DenseMap<KeyType, const CtxFunction<ctx> *> ctxFunMap;
   llvm::DenseMap<KeyType, const InDirectCallSite<ctx> *> ctxFunPtrMap;  // indirect call sites
 
+  static inline KeyType getKey(const ctx *C, const llvm::Value *V) { return std::make_pair(CT::getID(C), V); }
+
   // call callgraph is needed to determine the context for the function
   std::unique_ptr<CallGraphTy> callGraph;
 
@@ -75,7 +77,7 @@ class CtxModule {
       // new node are inserted
       CallNodeTy *callNode = callGraph->createCallNode(curCtx, F, I);
       auto result = ctxFunMap
-                        .insert(std::make_pair(std::make_pair(curCtx, F),  // ctx + llvm::Function
+                        .insert(std::make_pair(getKey(curCtx, F),  // ctx + llvm::Function
                                                callNode->getTargetFun()))
                         .second;  // CtxFunction
       assert(result);
@@ -102,7 +104,7 @@ class CtxModule {
       // redirect to a function
       F = llvm::dyn_cast<llvm::Function>(interceptResult.redirectTo);
 
-      auto it = ctxFunMap.find(std::make_pair(curCtx, F));
+      auto it = ctxFunMap.find(getKey(curCtx, F));
       if (it != ctxFunMap.end()) {
         // already in the call graph, do not need to traverse
         return std::make_pair(it->second->getCallNode(), false);
@@ -110,7 +112,7 @@ class CtxModule {
 
       // new node are inserted
       CallNodeTy *callNode = callGraph->createCallNode(curCtx, F, I);
-      auto result = ctxFunMap.insert(std::make_pair(std::make_pair(curCtx, F), callNode->getTargetFun())).second;
+      auto result = ctxFunMap.insert(std::make_pair(getKey(curCtx, F), callNode->getTargetFun())).second;
       assert(result);
 
       auto fun = const_cast<CtxFunction<ctx> *>(callNode->getTargetFun());
@@ -144,13 +146,13 @@ class CtxModule {
     // static_assert(std::is_invocable<OnNewInDirectNode, CallNodeTy *>::value,
     // "");
 
-    auto it = ctxFunPtrMap.find(std::make_pair(C, I));
+    auto it = ctxFunPtrMap.find(getKey(C, I));
     if (it != ctxFunPtrMap.end()) {
       return std::make_pair(it->second->getCallNode(), false);
     }
     // new node
     CallNodeTy *callNode = callGraph->createIndCallNode(C, target, I);
-    auto result = ctxFunPtrMap.insert(std::make_pair(std::make_pair(C, I), callNode->getTargetFunPtr())).second;
+    auto result = ctxFunPtrMap.insert(std::make_pair(getKey(C, I), callNode->getTargetFunPtr())).second;
     assert(result);
 
     callBack(callNode);
@@ -343,14 +345,14 @@ class CtxModule {
   [[nodiscard]] inline const CallGraphTy *getCallGraph() { return callGraph.get(); }
 
   [[nodiscard]] inline const CallGraphNode<ctx> *getDirectNode(const ctx *C, const llvm::Function *F) {
-    auto it = ctxFunMap.find(std::make_pair(C, F));
+    auto it = ctxFunMap.find(getKey(C, F));
     assert(it != ctxFunMap.end());
 
     return it->second->getCallNode();
   }
 
   [[nodiscard]] inline const CallGraphNode<ctx> *getDirectNodeOrNull(const ctx *C, const llvm::Function *F) {
-    auto it = ctxFunMap.find(std::make_pair(C, F));
+    auto it = ctxFunMap.find(getKey(C, F));
     if (it == ctxFunMap.end()) {
       return nullptr;
     }
@@ -359,7 +361,7 @@ class CtxModule {
   }
 
   [[nodiscard]] inline const CallGraphNode<ctx> *getInDirectNode(const ctx *C, const llvm::Instruction *I) {
-    auto it = ctxFunPtrMap.find(std::make_pair(C, I));
+    auto it = ctxFunPtrMap.find(getKey(C, I));
     // JEFF: this fails on GraphBLAS openmp_demo
     // assert(it != ctxFunPtrMap.end());
     if (it == ctxFunPtrMap.end()) return nullptr;  // JEFF
@@ -12,6 +12,7 @@ limitations under the License.
 #pragma once
 
 #include "PointerAnalysis/Graph/NodeID.def"
+#include "PointerAnalysis/Util/ScopedInstance.h"
 
 namespace pta {
 
@@ -21,19 +22,23 @@ class CGObjNode;
 
 using ObjID = NodeID;
 
+// the next object id of an analysis, made current through ScopedInstance<ObjectIDCounter>
+struct ObjectIDCounter {
+  ObjID next = 0;
+};
+
 template <typename ctx, typename SubClass>
 class Object {
  protected:
   using ObjNode = CGObjNode<ctx, SubClass>;
 
   bool isImmutable;
-  static ObjID CurID;
   // static std::vector<Object<MemModel>*> ObjVec;
 
   ObjNode* objNode = nullptr;
   ObjID objID;
 
-  Object() : isImmutable(false), objID(CurID++) {}
+  Object() : isImmutable(false), objID(ScopedInstance<ObjectIDCounter>::get().next++) {}
 
   // this can only be called internally
   inline void setObjNode(ObjNode* node) {
@@ -61,12 +66,9 @@ class Object {
     }
   }
 
-  static void resetObjectID() { CurID = 0; }
+  static void resetObjectID() { ScopedInstance<ObjectIDCounter>::get().next = 0; }
 
   friend CGObjNode<ctx, SubClass>;
 };
 
-template <typename ctx, typename SubClass>
-ObjID Object<ctx, SubClass>::CurID = 0;
-
 }  // namespace pta
@@ -11,6 +11,7 @@ limitations under the License.
 
 #pragma once
 
+#include "PointerAnalysis/Context/CtxTrait.h"
 #include "PointerAnalysis/Util/Util.h"
 
 // represent pointers in programs
@@ -70,7 +71,7 @@ namespace std {
 template <typename ctx>
 struct hash<pta::Pointer<ctx>> {
   size_t operator()(const pta::Pointer<ctx> &ptr) const {
-    llvm::hash_code seed = llvm::hash_value(ptr.getContext());
+    llvm::hash_code seed = llvm::hash_value(pta::CtxTrait<ctx>::getID(ptr.getContext()));
     llvm::hash_code hash = llvm::hash_combine(ptr.getValue(), seed);
     return hash_value(hash);
   }
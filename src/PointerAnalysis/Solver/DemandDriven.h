@@ -0,0 +1,490 @@
+/* Copyright 2021 Coderrect Inc. All Rights Reserved.
+Licensed under the GNU Affero General Public License, version 3 or later (“AGPL”), as published by the Free Software
+Foundation. You may not use this file except in compliance with the License. You may obtain a copy of the License at
+https://www.gnu.org/licenses/agpl-3.0.en.html
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an “AS IS” BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <llvm/ADT/BitVector.h>
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/ADT/SparseBitVector.h>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "PointerAnalysis/Graph/ConstraintGraph/ConstraintGraph.h"
+#include "PointerAnalysis/Models/LanguageModel/LangModelTrait.h"
+#include "PointerAnalysis/Models/MemoryModel/MemModelTrait.h"
+#include "PointerAnalysis/Solver/PointsTo/PTSTrait.h"
+
+namespace pta {
+
+// Answers points-to queries on demand over the constraint graph, without solving the whole program.
+//
+// A query on node n solves only the backward slice of n:
+//   copy    p --> n         p is in the slice, pts(n) |= pts(p)
+//   load    n = *p          p and every object o in pts(p) are in the slice, pts(n) |= pts(o)
+//   offset  n = gep p       p is in the slice, pts(n) gets the field of every object in pts(p)
+//   store   *q = p          once an object o of the slice might be in pts(q), so is q, and p if o is in pts(q)
+// The slice grows with the points-to sets until it reaches a fixed point, which is the same one the whole-program
+// solver reaches for the nodes of the slice. The points-to sets are written in place, so they are always a subset of
+// the final ones, and the nodes of a finished slice are cached as resolved for the later queries.
+//
+// Only the stores that can write an object of the slice are visited:
+//  - the address of an allocation that is never stored, nor copied into an object, stays in the nodes reachable from
+//    its anonymous nodes by copy and offset constraints, so only the stores through these nodes can write it.
+//  - any other object can be written by the stores whose dst is not resolved yet, and by the resolved ones whose
+//    final pts has the object, which are indexed by object once their dst is resolved.
+//
+// The constraint graph must have every constraint apart from the loads and stores, i.e. the indirect calls and the
+// special constraints are resolved (see DemandDrivenMode::start), and must not get new constraints between queries
+// without calling invalidate(). A query fails if its slice grows over the budget; the caller then has to solve the
+// whole program.
+template <typename LangModel>
+class DemandQueryEngine {
+  using LMT = LangModelTrait<LangModel>;
+  using ctx = typename LMT::CtxTy;
+  using MMT = MemModelTrait<typename LMT::MemModelTy>;
+  using ObjTy = typename MMT::ObjectTy;
+  using PT = PTSTrait<typename LMT::PointsToTy>;
+  using PtsTy = typename PT::PtsTy;
+  using ConsGraphTy = ConstraintGraph<ctx>;
+  using CGNodeTy = CGNodeBase<ctx>;
+  using PtrNodeTy = CGPtrNode<ctx>;
+  using ObjNodeTy = CGObjNode<ctx, ObjTy>;
+  using Store = std::pair<NodeID, NodeID>;  // (src, dst) of *dst = src
+
+  // the objects of the same allocation site and context, they can only be written by stores if escaped is set
+  struct Allocation {
+    bool analyzed = false;
+    bool escaped = false;
+    std::vector<NodeID> objects;
+    // the stores through the nodes that can point to the allocation, if not escaped
+    std::vector<Store> stores;
+  };
+
+  LangModel *langModel;
+  ConsGraphTy *consGraph;
+  // max number of unresolved nodes in the slice of a query, and of nodes holding the address of an allocation
+  size_t budget;
+
+  // nodes whose points-to sets are final for the current constraint graph
+  llvm::BitVector resolved;
+
+  // stores whose dst is not resolved, and the stores of the resolved dst by the objects in their pts
+  std::vector<Store> pendingStores;
+  std::vector<std::vector<Store>> storesByObject;
+  bool storesCollected = false;
+
+  // the allocation of every object, allocations[0] holds the objects that can not be told apart
+  std::map<std::pair<const ctx *, const llvm::Value *>, size_t> allocationIndex;
+  std::vector<Allocation> allocations;
+  std::vector<size_t> allocationOf;
+
+  // the slice of the running query and the stores it visits
+  std::vector<NodeID> slice;
+  llvm::BitVector inSlice;
+  std::vector<Store> activeStores;
+  llvm::DenseSet<Store> isActive;
+  bool pendingActive = false;
+  bool failed = false;
+
+  size_t numQueries = 0;
+  size_t numFailedQueries = 0;
+
+  // a query only creates field objects, so a new constraint means the graph was not complete
+  struct OnNewConstraint : public ConsGraphTy::OnNewConstraintCallBack {
+    bool &failed;
+    explicit OnNewConstraint(bool &failed) : failed(failed) {}
+    void onNewConstraint(CGNodeTy *, CGNodeTy *, Constraints) override { failed = true; }
+  };
+
+  [[nodiscard]] inline bool isResolved(NodeID id) const { return id < resolved.size() && resolved.test(id); }
+
+  void collectStores() {
+    if (storesCollected) return;
+    pendingStores.clear();
+    for (auto it = consGraph->begin(), ie = consGraph->end(); it != ie; it++) {
+      CGNodeTy *node = *it;
+      for (auto sit = node->pred_store_begin(), sie = node->pred_store_end(); sit != sie; sit++) {
+        pendingStores.emplace_back((*sit)->getNodeID(), node->getNodeID());
+      }
+    }
+    storesCollected = true;
+  }
+
+  const Allocation &getAllocation(NodeID objID) {
+    for (NodeID id = allocationOf.size(); id < consGraph->getObjectNum(); id++) {
+      auto objNode = static_cast<ObjNodeTy *>(consGraph->getObjectNode(id));
+      auto object = objNode->getObject();
+      if (objNode->isSpecialNode() || object->getValue() == nullptr) {
+        allocationOf.push_back(0);
+        continue;
+      }
+      auto result = allocationIndex.try_emplace(std::make_pair(object->getContext(), object->getValue()),
+                                                allocations.size());
+      if (result.second) {
+        allocations.emplace_back();
+      }
+      allocationOf.push_back(result.first->second);
+      allocations[result.first->second].objects.push_back(id);
+    }
+
+    size_t index = allocationOf[objID];
+    if (!allocations[index].analyzed) {
+      analyzeEscape(index);
+    }
+    return allocations[index];
+  }
+
+  // collect the nodes that can point to the objects of the allocation, and the stores through them
+  void analyzeEscape(size_t index) {
+    Allocation &alloc = allocations[index];
+    alloc.analyzed = true;
+
+    std::vector<NodeID> worklist;
+    llvm::DenseSet<NodeID> reached;
+    for (NodeID id : alloc.objects) {
+      // Convention! objnode_id + 1 = anonomyous node
+      NodeID anon = consGraph->getObjectNode(id)->getNodeID() + 1;
+      reached.insert(anon);
+      worklist.push_back(anon);
+    }
+
+    while (!worklist.empty()) {
+      CGNodeTy *node = consGraph->getCGNode(worklist.back());
+      worklist.pop_back();
+      // the address is stored to memory, or copied into an object
+      if (node->succ_store_begin() != node->succ_store_end() || llvm::isa<ObjNodeTy>(node) ||
+          reached.size() > budget) {
+        alloc.escaped = true;
+        alloc.stores.clear();
+        return;
+      }
+      for (auto it = node->pred_store_begin(), ie = node->pred_store_end(); it != ie; it++) {
+        alloc.stores.emplace_back((*it)->getNodeID(), node->getNodeID());
+      }
+      for (auto it = node->succ_copy_begin(), ie = node->succ_copy_end(); it != ie; it++) {
+        if (reached.insert((*it)->getNodeID()).second) worklist.push_back((*it)->getNodeID());
+      }
+      for (auto it = node->succ_offset_begin(), ie = node->succ_offset_end(); it != ie; it++) {
+        if (reached.insert((*it)->getNodeID()).second) worklist.push_back((*it)->getNodeID());
+      }
+    }
+  }
+
+  void activate(const Store &store) {
+    if (isActive.insert(store).second) {
+      activeStores.push_back(store);
+    }
+  }
+
+  // visit the stores that can write the object
+  void activateStoresOf(NodeID objID) {
+    const Allocation &alloc = getAllocation(objID);
+    if (!alloc.escaped) {
+      for (const Store &store : alloc.stores) {
+        activate(store);
+      }
+      return;
+    }
+
+    if (!pendingActive) {
+      pendingActive = true;
+      for (const Store &store : pendingStores) {
+        if (!isResolved(store.second)) activate(store);
+      }
+    }
+    if (objID < storesByObject.size()) {
+      for (const Store &store : storesByObject[objID]) {
+        activate(store);
+      }
+    }
+  }
+
+  void addToSlice(NodeID id) {
+    if (isResolved(id)) return;
+    if (id >= inSlice.size()) {
+      inSlice.resize(consGraph->getNodeNum());
+    }
+    if (inSlice.test(id)) return;
+    if (slice.size() >= budget) {
+      failed = true;
+      return;
+    }
+    inSlice.set(id);
+    slice.push_back(id);
+
+    if (auto objNode = llvm::dyn_cast<ObjNodeTy>(consGraph->getCGNode(id))) {
+      activateStoresOf(objNode->getObjectID());
+    }
+  }
+
+  // pull the incoming copy, load and offset constraints of the node, return true if its pts changed
+  bool visit(NodeID id) {
+    CGNodeTy *node = consGraph->getCGNode(id);
+    assert(!node->hasSuperNode());
+    bool changed = false;
+
+    for (auto it = node->pred_copy_begin(), ie = node->pred_copy_end(); it != ie; it++) {
+      NodeID src = (*it)->getNodeID();
+      addToSlice(src);
+      changed |= PT::unionWith(id, src);
+    }
+
+    for (auto it = node->pred_load_begin(), ie = node->pred_load_end(); it != ie; it++) {
+      NodeID src = (*it)->getNodeID();
+      addToSlice(src);
+      // copy, id might be src
+      PtsTy objects = PT::getPointsTo(src);
+      for (auto oit = objects.begin(), oie = objects.end(); oit != oie; oit++) {
+        NodeID objNode = consGraph->getObjectNode(*oit)->getNodeID();
+        addToSlice(objNode);
+        changed |= PT::unionWith(id, objNode);
+      }
+    }
+
+    if (node->pred_offset_begin() != node->pred_offset_end()) {
+      // see SolverBase::processOffset
+      auto idx = llvm::cast<const llvm::Instruction>(static_cast<PtrNodeTy *>(node)->getPointer()->getValue());
+      for (auto it = node->pred_offset_begin(), ie = node->pred_offset_end(); it != ie; it++) {
+        NodeID src = (*it)->getNodeID();
+        addToSlice(src);
+        // indexing might create new objects and modify the points-to sets
+        PtsTy objects = PT::getPointsTo(src);
+        for (auto oit = objects.begin(), oie = objects.end(); oit != oie; oit++) {
+          auto objNode = static_cast<ObjNodeTy *>(consGraph->getObjectNode(*oit));
+          auto *fieldObj = llvm::cast_or_null<ObjNodeTy>(LMT::indexObject(langModel, objNode, idx));
+          if (fieldObj != nullptr) {
+            changed |= PT::insert(id, fieldObj->getObjectID());
+          }
+        }
+      }
+    }
+
+    return changed;
+  }
+
+  // apply the visited stores to the objects of the slice, return true if any pts changed
+  bool visitStores() {
+    bool changed = false;
+    // the stores grow while they are visited
+    for (size_t i = 0; i < activeStores.size() && !failed; i++) {
+      auto [src, dst] = activeStores[i];
+      addToSlice(dst);
+      PtsTy objects = PT::getPointsTo(dst);
+      for (auto oit = objects.begin(), oie = objects.end(); oit != oie; oit++) {
+        NodeID objNode = consGraph->getObjectNode(*oit)->getNodeID();
+        if (isResolved(objNode) || objNode >= inSlice.size() || !inSlice.test(objNode)) continue;
+        addToSlice(src);
+        changed |= PT::unionWith(objNode, src);
+      }
+    }
+    return changed;
+  }
+
+  // index the stores of the newly resolved nodes by the objects in their final pts
+  void indexStores() {
+    bool indexed = false;
+    for (NodeID id : slice) {
+      CGNodeTy *node = consGraph->getCGNode(id);
+      if (node->pred_store_begin() == node->pred_store_end()) continue;
+      indexed = true;
+      PtsTy objects = PT::getPointsTo(id);
+      for (auto oit = objects.begin(), oie = objects.end(); oit != oie; oit++) {
+        if (*oit >= storesByObject.size()) {
+          storesByObject.resize(consGraph->getObjectNum());
+        }
+        for (auto it = node->pred_store_begin(), ie = node->pred_store_end(); it != ie; it++) {
+          storesByObject[*oit].emplace_back((*it)->getNodeID(), id);
+        }
+      }
+    }
+    if (indexed) {
+      pendingStores.erase(std::remove_if(pendingStores.begin(), pendingStores.end(),
+                                         [&](const Store &store) { return isResolved(store.second); }),
+                          pendingStores.end());
+    }
+  }
+
+ public:
+  DemandQueryEngine(LangModel *langModel, size_t budget)
+      : langModel(langModel), consGraph(LMT::getConsGraph(langModel)), budget(budget) {
+    invalidate();
+  }
+
+  // make pts(id) final, returns false if the query failed, pts(id) is then only a subset of the final one
+  bool query(NodeID id) {
+    numQueries++;
+    if (isResolved(id)) return true;
+    collectStores();
+
+    for (NodeID node : slice) {
+      inSlice.reset(node);
+    }
+    slice.clear();
+    activeStores.clear();
+    isActive.clear();
+    pendingActive = false;
+    failed = false;
+
+    OnNewConstraint cb(failed);
+    consGraph->registerCallBack(&cb);
+    addToSlice(id);
+    bool changed;
+    do {
+      size_t sliceSize = slice.size();
+      changed = false;
+      // the slice grows while it is visited
+      for (size_t i = 0; i < slice.size() && !failed; i++) {
+        changed |= visit(slice[i]);
+      }
+      changed |= visitStores();
+      // the nodes added by the stores are not visited yet
+      changed |= slice.size() != sliceSize;
+    } while (changed && !failed);
+    consGraph->unregisterCallBack();
+
+    if (failed) {
+      numFailedQueries++;
+      return false;
+    }
+    resolved.resize(consGraph->getNodeNum());
+    for (NodeID node : slice) {
+      resolved.set(node);
+    }
+    indexStores();
+    return true;
+  }
+
+  // the constraint graph got new constraints, the cached results might be incomplete
+  void invalidate() {
+    resolved.reset();
+    storesCollected = false;
+    storesByObject.clear();
+    allocationIndex.clear();
+    allocations.clear();
+    allocationOf.clear();
+    allocations.push_back({true, true, {}, {}});
+  }
+
+  [[nodiscard]] size_t getNumQueries() const { return numQueries; }
+  [[nodiscard]] size_t getNumFailedQueries() const { return numFailedQueries; }
+};
+
+// Demand-driven mode of a solver, see SolverBase::setDemandDriven.
+// While it is active the points-to sets are computed by the queries, which are serialized by lock(). A failed query
+// leaves it through the fallback hook of the solver, which has to solve the whole program and call stop().
+template <typename LangModel>
+class DemandDrivenMode {
+  using LMT = LangModelTrait<LangModel>;
+  using ctx = typename LMT::CtxTy;
+  using PT = PTSTrait<typename LMT::PointsToTy>;
+  using ConsGraphTy = ConstraintGraph<ctx>;
+  using CGNodeTy = CGNodeBase<ctx>;
+
+  size_t budget = 0;
+  std::unique_ptr<DemandQueryEngine<LangModel>> engine;
+  std::atomic<bool> active{false};
+  std::mutex mutex;
+  std::function<void()> fallback;
+
+ public:
+  // max number of nodes a query may visit, 0 disables the mode
+  void setBudget(size_t queryBudget) { budget = queryBudget; }
+  [[nodiscard]] bool isEnabled() const { return budget != 0; }
+  [[nodiscard]] bool isActive() const { return active.load(std::memory_order_acquire); }
+
+  // Start answering the queries on demand. The indirect calls and the special constraints are resolved by querying
+  // their nodes first, so that the constraint graph has every constraint the whole-program solve would add to it apart
+  // from the loads and stores. Returns false if a query failed, the solver then has to solve the whole program.
+  bool start(LangModel *langModel, const std::function<bool(CGNodeTy *, CGNodeTy *)> &processSpecial,
+             const std::function<bool()> &checkBudget) {
+    struct OnNewConstraint : public ConsGraphTy::OnNewConstraintCallBack {
+      bool changed = false;
+      void onNewConstraint(CGNodeTy *, CGNodeTy *, Constraints) override { changed = true; }
+    };
+
+    ConsGraphTy *consGraph = LMT::getConsGraph(langModel);
+    engine = std::make_unique<DemandQueryEngine<LangModel>>(langModel, budget);
+    active.store(true, std::memory_order_release);
+    while (true) {
+      llvm::SparseBitVector<> funPtrs;
+      std::vector<NodeID> specials;
+      for (NodeID id = 0; id < consGraph->getNodeNum(); id++) {
+        CGNodeTy *node = consGraph->getCGNode(id);
+        bool hasSpecial = node->succ_special_begin() != node->succ_special_end();
+        if (!node->isFunctionPtr() && !hasSpecial) continue;
+        if (!engine->query(id)) return false;
+        if (node->isFunctionPtr() && !PT::isEmpty(id)) funPtrs.set(id);
+        if (hasSpecial) specials.push_back(id);
+      }
+
+      OnNewConstraint cb;
+      consGraph->registerCallBack(&cb);
+      bool changed = LMT::updateFunPtrs(langModel, funPtrs);
+      consGraph->unregisterCallBack();
+      changed |= cb.changed;
+      for (NodeID id : specials) {
+        CGNodeTy *src = consGraph->getCGNode(id);
+        for (auto it = src->succ_special_begin(), ie = src->succ_special_end(); it != ie; it++) {
+          changed |= processSpecial(src, *it);
+        }
+      }
+      if (!changed) return true;
+
+      engine->invalidate();
+      if (checkBudget()) return true;
+    }
+  }
+
+  // the hook a failed query calls to solve the whole program
+  void setFallback(std::function<void()> hook) { fallback = std::move(hook); }
+
+  // the whole program is solved
+  void stop() {
+    engine.reset();
+    active.store(false, std::memory_order_release);
+  }
+
+  void reset() {
+    stop();
+    fallback = nullptr;
+  }
+
+  // the lock a query holds while it reads the points-to sets, only locked while active
+  [[nodiscard]] std::unique_lock<std::mutex> lock() {
+    std::unique_lock<std::mutex> guard(mutex, std::defer_lock);
+    if (isActive()) {
+      guard.lock();
+    }
+    return guard;
+  }
+
+  // make the pts of the nodes final before a query reads them, must hold the lock.
+  // If the whole program has to be solved instead, the ids are updated to their super nodes.
+  template <typename... IDs>
+  void query(const ConsGraphTy *consGraph, IDs &...ids) {
+    if (!active.load(std::memory_order_relaxed)) return;
+    if ((engine->query(ids) && ...)) return;
+    fallback();
+    ((ids = consGraph->peekSuperNodeID(ids)), ...);
+  }
+
+  [[nodiscard]] size_t getNumQueries() const { return engine ? engine->getNumQueries() : 0; }
+  [[nodiscard]] size_t getNumFailedQueries() const { return engine ? engine->getNumFailedQueries() : 0; }
+};
+
+}  // namespace pta
@@ -0,0 +1,89 @@
+/* Copyright 2021 Coderrect Inc. All Rights Reserved.
+Licensed under the GNU Affero General Public License, version 3 or later (“AGPL”), as published by the Free Software
+Foundation. You may not use this file except in compliance with the License. You may obtain a copy of the License at
+https://www.gnu.org/licenses/agpl-3.0.en.html
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an “AS IS” BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <llvm/ADT/DenseMap.h>
+
+#include <limits>
+
+#include "OfflineGraph.h"
+#include "PointerAnalysis/Graph/ConstraintGraph/ConstraintGraph.h"
+
+namespace pta {
+
+// Offline part of hybrid cycle detection (Hardekopf & Lin, CGO'07).
+//
+// Builds a graph with a node for every pointer p and a "ref" node for *p:
+//   copy  p --> q   gives  p  --> q
+//   load  q = *p    gives  *p --> q
+//   store *q = p    gives  p  --> *q
+// If *p is in a cycle with a pointer q, every object p points to ends up in a copy cycle with q once the loads and
+// stores through p are resolved. The solver can then merge those objects with q as soon as they show up in pts(p),
+// without waiting for the copy edges of the cycle to be added and found.
+// Only cycles through a single ref node are used: a cycle through another ref node *r only exists once pts(r) is
+// non-empty, so merging on it could lose precision.
+//
+// Returns p -> q for every such ref node *p.
+template <typename ctx>
+llvm::DenseMap<NodeID, NodeID> computeHCDTargets(const ConstraintGraph<ctx> &consGraph) {
+  using CGNodeTy = CGNodeBase<ctx>;
+
+  // pointers are [0, n), ref nodes are [n, 2n)
+  auto const n = static_cast<uint32_t>(consGraph.getNodeNum());
+  auto const refOf = [n](NodeID id) { return n + id; };
+
+  OfflineGraph graph;
+  graph.offsets.resize(2 * static_cast<size_t>(n) + 1, 0);
+  for (uint32_t id = 0; id < n; id++) {
+    graph.offsets[id] = static_cast<uint32_t>(graph.succs.size());
+    CGNodeTy *node = consGraph.getCGNode(id);
+    if (node->hasSuperNode()) continue;
+    for (auto it = node->succ_copy_begin(), ie = node->succ_copy_end(); it != ie; it++) {
+      graph.succs.push_back((*it)->getNodeID());
+    }
+    for (auto it = node->succ_store_begin(), ie = node->succ_store_end(); it != ie; it++) {
+      graph.succs.push_back(refOf((*it)->getNodeID()));
+    }
+  }
+  for (uint32_t id = 0; id < n; id++) {
+    graph.offsets[refOf(id)] = static_cast<uint32_t>(graph.succs.size());
+    CGNodeTy *node = consGraph.getCGNode(id);
+    if (node->hasSuperNode()) continue;
+    for (auto it = node->succ_load_begin(), ie = node->succ_load_end(); it != ie; it++) {
+      graph.succs.push_back((*it)->getNodeID());
+    }
+  }
+  graph.offsets[2 * static_cast<size_t>(n)] = static_cast<uint32_t>(graph.succs.size());
+
+  llvm::DenseMap<NodeID, NodeID> targets;
+  forEachOfflineSCC(graph, [&](llvm::ArrayRef<uint32_t> scc) {
+    constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+    uint32_t pointer = NONE;
+    uint32_t ref = NONE;
+    size_t numRefs = 0;
+    for (auto const node : scc) {
+      if (node >= n) {
+        ref = node;
+        numRefs++;
+      } else if (pointer == NONE || node < pointer) {
+        pointer = node;
+      }
+    }
+    if (numRefs == 1 && pointer != NONE) {
+      targets[ref - n] = pointer;
+    }
+  });
+
+  return targets;
+}
+
+}  // namespace pta
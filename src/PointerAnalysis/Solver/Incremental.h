@@ -0,0 +1,518 @@
+/* Copyright 2021 Coderrect Inc. All Rights Reserved.
+Licensed under the GNU Affero General Public License, version 3 or later (“AGPL”), as published by the Free Software
+Foundation. You may not use this file except in compliance with the License. You may obtain a copy of the License at
+https://www.gnu.org/licenses/agpl-3.0.en.html
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an “AS IS” BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Reusing the results of a previous revision of a module, see ResultsCache::solveFromBaseResults.
+//
+// Every node of the constraint graph gets a key built from the program values and contexts it stands for.
+// The keys of the values in a function include the structural hash of the function, so the nodes of an unchanged
+// function match their nodes in the previous run, and those of a changed function match nothing.
+// The constraints of both graphs are then compared by the keys of their nodes, apart from the constraints between
+// the nodes of unchanged functions, which are the same in both. A previous pts is kept if it only depends on nodes
+// and constraints that are still in the graph, see DirtyNodes, the rest is solved again.
+
+#pragma once
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/BitVector.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/InlineAsm.h>
+#include <llvm/IR/InstrTypes.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Operator.h>
+#include <llvm/Support/Endian.h>
+#include <llvm/Support/xxhash.h>
+
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "PointerAnalysis/Graph/ConstraintGraph/CGNodeBase.h"
+#include "PointerAnalysis/Solver/PersistedResults.h"
+
+namespace pta {
+
+// Builds a hash that is the same in every run, unlike llvm::hash_code
+class StableHash {
+  llvm::SmallString<64> data;
+
+ public:
+  StableHash &add(uint64_t value) {
+    char bytes[sizeof(uint64_t)];
+    llvm::support::endian::write64le(bytes, value);
+    data.append(bytes, bytes + sizeof(uint64_t));
+    return *this;
+  }
+
+  StableHash &add(llvm::StringRef str) {
+    add(str.size());
+    data.append(str.begin(), str.end());
+    return *this;
+  }
+
+  // never 0, which stands for no key, nor one of the keys llvm::DenseMap reserves
+  [[nodiscard]] uint64_t get() const {
+    uint64_t hash = llvm::xxHash64(data.str());
+    return std::clamp<uint64_t>(hash, 1, std::numeric_limits<uint64_t>::max() - 2);
+  }
+};
+
+// the position of an object in its allocation, for the memory models that have fields
+template <typename Object, typename = void>
+struct ObjectPosition {
+  static uint64_t get(const Object & /* object */) { return 0; }
+};
+
+template <typename Object>
+struct ObjectPosition<Object, std::void_t<decltype(std::declval<const Object &>().getPOffset())>> {
+  static uint64_t get(const Object &object) { return object.getPOffset() * 2 + object.isSpecialObject(); }
+};
+
+// Structural hashes of the IR, the same in every run on the same IR. Values are hashed by what they are instead of
+// their printed text, locals by their position in the function and globals by their name, so nothing is printed or
+// numbered module-wide. Metadata is left out, debug info changes whenever another part of the module does.
+class IRHasher {
+  llvm::DenseMap<const llvm::Type *, uint64_t> types;
+  llvm::DenseMap<const llvm::Value *, uint64_t> constants;
+  // the globals without a name are referred to by their position, like their printed @0, @1, ...
+  llvm::DenseMap<const llvm::GlobalValue *, uint64_t> unnamedGlobals;
+
+  static void addAPInt(StableHash &hash, const llvm::APInt &value) {
+    hash.add(value.getBitWidth());
+    for (unsigned i = 0; i < value.getNumWords(); i++) {
+      hash.add(value.getRawData()[i]);
+    }
+  }
+
+  // an operand of an instruction, locals are numbered in the order they are defined
+  void addOperand(StableHash &hash, const llvm::Value *operand,
+                  const llvm::DenseMap<const llvm::Value *, uint64_t> &locals) {
+    auto it = locals.find(operand);
+    if (it != locals.end()) {
+      hash.add(1).add(it->second);
+    } else {
+      hash.add(2).add(hashValue(operand));
+    }
+  }
+
+ public:
+  explicit IRHasher(const llvm::Module &module) {
+    for (auto const &global : module.global_values()) {
+      if (!global.hasName()) {
+        unnamedGlobals.try_emplace(&global, unnamedGlobals.size());
+      }
+    }
+  }
+
+  // named structs by their name, they can be recursive, see StructuralKeys::getLayoutHash
+  uint64_t hashType(const llvm::Type *type) {
+    auto it = types.find(type);
+    if (it != types.end()) {
+      return it->second;
+    }
+
+    StableHash hash;
+    hash.add(type->getTypeID()).add(type->getPrimitiveSizeInBits().getKnownMinSize());
+    auto structType = llvm::dyn_cast<llvm::StructType>(type);
+    if (structType != nullptr && structType->hasName()) {
+      hash.add(structType->getName());
+    } else {
+      if (structType != nullptr) {
+        hash.add(structType->isPacked());
+      } else if (auto pointerType = llvm::dyn_cast<llvm::PointerType>(type)) {
+        hash.add(pointerType->getAddressSpace());
+      } else if (auto arrayType = llvm::dyn_cast<llvm::ArrayType>(type)) {
+        hash.add(arrayType->getNumElements());
+      } else if (auto functionType = llvm::dyn_cast<llvm::FunctionType>(type)) {
+        hash.add(functionType->isVarArg());
+      }
+      for (auto subtype : type->subtypes()) {
+        hash.add(hashType(subtype));
+      }
+    }
+    return types[type] = hash.get();
+  }
+
+  // a value outside of any function body, globals by their name
+  uint64_t hashValue(const llvm::Value *value) {
+    if (auto global = llvm::dyn_cast<llvm::GlobalValue>(value)) {
+      return StableHash().add("@").add(global->getName()).add(unnamedGlobals.lookup(global)).get();
+    }
+    auto it = constants.find(value);
+    if (it != constants.end()) {
+      return it->second;
+    }
+
+    StableHash hash;
+    hash.add(value->getValueID()).add(hashType(value->getType()));
+    if (auto integer = llvm::dyn_cast<llvm::ConstantInt>(value)) {
+      addAPInt(hash, integer->getValue());
+    } else if (auto fp = llvm::dyn_cast<llvm::ConstantFP>(value)) {
+      addAPInt(hash, fp->getValueAPF().bitcastToAPInt());
+    } else if (auto data = llvm::dyn_cast<llvm::ConstantDataSequential>(value)) {
+      hash.add(data->getRawDataValues());
+    } else if (auto inlineAsm = llvm::dyn_cast<llvm::InlineAsm>(value)) {
+      hash.add(inlineAsm->getAsmString()).add(inlineAsm->getConstraintString());
+    } else if (auto expr = llvm::dyn_cast<llvm::ConstantExpr>(value)) {
+      hash.add(expr->getOpcode());
+      if (expr->isCompare()) {
+        hash.add(expr->getPredicate());
+      }
+      if (auto gep = llvm::dyn_cast<llvm::GEPOperator>(expr)) {
+        hash.add(hashType(gep->getSourceElementType())).add(gep->isInBounds());
+      }
+      if (expr->hasIndices()) {
+        for (unsigned idx : expr->getIndices()) {
+          hash.add(idx);
+        }
+      }
+    }
+    if (auto user = llvm::dyn_cast<llvm::Constant>(value)) {
+      for (auto const &operand : user->operands()) {
+        // the block of a blockaddress is hashed with its function
+        hash.add(llvm::isa<llvm::Constant>(operand) ? hashValue(operand) : 0);
+      }
+    }
+    return constants[value] = hash.get();
+  }
+
+  // the definition of a global variable, alias or ifunc
+  uint64_t hashGlobal(const llvm::GlobalValue &global) {
+    StableHash hash;
+    hash.add(hashValue(&global)).add(hashType(global.getValueType())).add(global.getLinkage());
+    if (auto variable = llvm::dyn_cast<llvm::GlobalVariable>(&global)) {
+      hash.add(variable->isConstant());
+    }
+    // the initializer, aliasee or resolver
+    for (auto const &operand : global.operands()) {
+      hash.add(hashValue(operand));
+    }
+    return hash.get();
+  }
+
+  uint64_t hashFunction(const llvm::Function &function) {
+    llvm::DenseMap<const llvm::Value *, uint64_t> locals;
+    for (auto const &arg : function.args()) {
+      locals.try_emplace(&arg, locals.size());
+    }
+    for (auto const &block : function) {
+      locals.try_emplace(&block, locals.size());
+      for (auto const &inst : block) {
+        locals.try_emplace(&inst, locals.size());
+      }
+    }
+
+    StableHash hash;
+    hash.add(hashValue(&function)).add(hashType(function.getFunctionType())).add(function.getLinkage());
+    for (auto const &arg : function.args()) {
+      hash.add(arg.hasReturnedAttr());
+    }
+    for (auto const &block : function) {
+      hash.add(block.size());
+      for (auto const &inst : block) {
+        hash.add(inst.getOpcode()).add(hashType(inst.getType())).add(inst.getNumOperands());
+        for (auto const &operand : inst.operands()) {
+          addOperand(hash, operand, locals);
+        }
+        if (auto cmp = llvm::dyn_cast<llvm::CmpInst>(&inst)) {
+          hash.add(cmp->getPredicate());
+        } else if (auto alloca = llvm::dyn_cast<llvm::AllocaInst>(&inst)) {
+          hash.add(hashType(alloca->getAllocatedType()));
+        } else if (auto gep = llvm::dyn_cast<llvm::GetElementPtrInst>(&inst)) {
+          hash.add(hashType(gep->getSourceElementType())).add(gep->isInBounds());
+        } else if (auto call = llvm::dyn_cast<llvm::CallBase>(&inst)) {
+          hash.add(hashType(call->getFunctionType()));
+        } else if (auto phi = llvm::dyn_cast<llvm::PHINode>(&inst)) {
+          for (auto incoming : phi->blocks()) {
+            addOperand(hash, incoming, locals);
+          }
+        } else if (auto extract = llvm::dyn_cast<llvm::ExtractValueInst>(&inst)) {
+          for (unsigned idx : extract->indices()) {
+            hash.add(idx);
+          }
+        } else if (auto insert = llvm::dyn_cast<llvm::InsertValueInst>(&inst)) {
+          for (unsigned idx : insert->indices()) {
+            hash.add(idx);
+          }
+        }
+      }
+    }
+    return hash.get();
+  }
+};
+
+// Keys of the values of a module that stay the same across revisions of the module.
+// Instructions, arguments and functions are keyed by the function and its structural hash, so they keep their key
+// as long as the function is unchanged. Globals are keyed by their definition, other constants by what they are.
+// A call site in a context is keyed by its callee and its position among the calls to that callee, so the contexts
+// through a changed function still match while the calls in it do not change.
+class StructuralKeys {
+  IRHasher hasher;
+  llvm::DenseMap<const llvm::Value *, uint64_t> keys;
+  llvm::DenseMap<const llvm::Instruction *, uint64_t> callSiteKeys;
+  // the instructions and functions by their key, the keys that are not unique map to nullptr
+  llvm::DenseMap<uint64_t, const llvm::Value *> values;
+  uint64_t layoutHash = 0;
+  uint64_t moduleHash = 0;
+
+  void addKey(const llvm::Value *value, uint64_t key) {
+    keys[value] = key;
+    auto [it, inserted] = values.try_emplace(key, value);
+    if (!inserted) {
+      it->second = nullptr;
+    }
+  }
+
+  void addFunction(const llvm::Function &function, uint64_t hash) {
+    auto const key = [&](char kind, uint64_t index) {
+      return StableHash().add(llvm::StringRef(&kind, 1)).add(function.getName()).add(hash).add(index).get();
+    };
+
+    addKey(&function, key('f', 0));
+    for (auto const &arg : function.args()) {
+      keys[&arg] = key('a', arg.getArgNo());
+    }
+    uint64_t index = 0;
+    llvm::DenseMap<const llvm::Value *, uint64_t> numCalls;
+    for (auto const &block : function) {
+      for (auto const &inst : block) {
+        addKey(&inst, key('i', index++));
+        if (auto call = llvm::dyn_cast<llvm::CallBase>(&inst)) {
+          auto callee = call->getCalledOperand()->stripPointerCasts();
+          llvm::StringRef calleeName = llvm::isa<llvm::Function>(callee) ? callee->getName() : "";
+          callSiteKeys[&inst] =
+              StableHash().add("s").add(function.getName()).add(calleeName).add(numCalls[callee]++).get();
+        }
+      }
+    }
+  }
+
+ public:
+  StructuralKeys(const llvm::Module &module, llvm::StringRef entry) : hasher(module) {
+    // the types and the data layout decide the memory layout of every object
+    std::vector<std::pair<llvm::StringRef, uint64_t>> types;
+    for (auto type : module.getIdentifiedStructTypes()) {
+      StableHash hash;
+      hash.add(type->isPacked()).add(type->isOpaque());
+      for (auto element : type->elements()) {
+        hash.add(hasher.hashType(element));
+      }
+      types.emplace_back(type->getName(), hash.get());
+    }
+    std::sort(types.begin(), types.end());
+    StableHash layout;
+    layout.add(entry).add(module.getDataLayoutStr()).add(module.getTargetTriple());
+    for (auto const &[name, hash] : types) {
+      layout.add(name).add(hash);
+    }
+    layoutHash = layout.get();
+
+    StableHash whole;
+    whole.add(layoutHash);
+    for (auto const &global : module.global_values()) {
+      if (auto function = llvm::dyn_cast<llvm::Function>(&global)) {
+        uint64_t hash = hasher.hashFunction(*function);
+        addFunction(*function, hash);
+        whole.add(hash);
+      } else {
+        uint64_t hash = hasher.hashGlobal(global);
+        addKey(&global, StableHash().add("g").add(hash).get());
+        whole.add(hash);
+      }
+    }
+    moduleHash = whole.get();
+  }
+
+  // hash of what every object in the module looks like in memory, the keys are only comparable if it is the same
+  [[nodiscard]] uint64_t getLayoutHash() const { return layoutHash; }
+
+  // hash of everything the analysis sees of the module, the results of the same module can be loaded as they are
+  [[nodiscard]] uint64_t getModuleHash() const { return moduleHash; }
+
+  [[nodiscard]] uint64_t getKey(const llvm::Value *value) {
+    auto [it, inserted] = keys.try_emplace(value, 0);
+    if (inserted) {
+      // a constant expression or another value without a function
+      it->second = StableHash().add("c").add(hasher.hashValue(value)).get();
+    }
+    return it->second;
+  }
+
+  [[nodiscard]] uint64_t getCallSiteKey(const llvm::Instruction *callsite) const {
+    return callsite == nullptr ? 0 : callSiteKeys.lookup(callsite);
+  }
+
+  // the instruction or function with the key, null if there is none or the key is not unique
+  [[nodiscard]] const llvm::Value *getValue(uint64_t key) const { return values.lookup(key); }
+};
+
+// The nodes of a previous run whose pts might not hold on the changed module.
+// The pts of a node is derived from the pts of the nodes with edges into it, so once something is gone from the graph,
+// everything reachable from it in the previous graph is dirty. A node is tracked by its super node, which shares
+// its pts with every node collapsed into it. The edges the solver derived from a pts are not in the results, so they
+// are followed through the pts: a load p --> x depends on the objects in pts(p), a store v --> p changes them.
+class DirtyNodes {
+  using EdgeEntry = PersistedResults::EdgeEntry;
+
+  // compressed adjacency lists
+  struct Lists {
+    std::vector<uint32_t> begin;
+    std::vector<uint32_t> items;
+
+    [[nodiscard]] llvm::ArrayRef<uint32_t> get(uint32_t key) const {
+      return llvm::makeArrayRef(items.data() + begin[key], items.data() + begin[key + 1]);
+    }
+
+    // forEach(add) calls add(key, item) for every item, it is called twice
+    template <typename ForEach>
+    void build(size_t numKeys, ForEach forEach) {
+      begin.assign(numKeys + 2, 0);
+      forEach([&](uint32_t key, uint32_t) { begin[key + 2]++; });
+      for (size_t i = 2; i < begin.size(); i++) {
+        begin[i] += begin[i - 1];
+      }
+      items.resize(begin.back());
+      forEach([&](uint32_t key, uint32_t item) { items[begin[key + 1]++] = item; });
+      begin.pop_back();
+    }
+  };
+
+  const PersistedResults &results;
+  llvm::BitVector dirty;
+  std::vector<NodeID> worklist;
+
+  Lists succEdges;     // super node -> the edges out of it
+  Lists storeEdges;    // super node -> the stores into the objects it points to
+  Lists derivedEdges;  // super node -> the copies its special constraints added
+  Lists objects;       // super node -> the objects collapsed into it
+  Lists pointedBy;     // object -> the super nodes pointing to it
+
+  [[nodiscard]] NodeID getSuperNode(NodeID id) const { return results.getSuperNode(id); }
+
+  void markObjects(NodeID pointer) {
+    for (NodeID obj : results.getPointsTo(pointer)) {
+      mark(results.getObjects()[obj].nodeID);
+    }
+  }
+
+  void markDerived(NodeID superNode) {
+    for (uint32_t edge : derivedEdges.get(superNode)) {
+      mark(results.getEdges()[edge].dst);
+    }
+  }
+
+  // a constraint that changed or is gone
+  void markEdge(const EdgeEntry &edge) {
+    switch (static_cast<Constraints>(static_cast<uint32_t>(edge.constraint))) {
+      case Constraints::store:
+        markObjects(edge.dst);
+        break;
+      case Constraints::special:
+        mark(edge.dst);
+        markDerived(getSuperNode(edge.src));
+        break;
+      default:
+        mark(edge.dst);
+        break;
+    }
+  }
+
+  void propagate(NodeID superNode) {
+    for (uint32_t edge : succEdges.get(superNode)) {
+      markEdge(results.getEdges()[edge]);
+    }
+    if (!storeEdges.get(superNode).empty()) {
+      markObjects(superNode);
+    }
+    // the loads and special constraints on the pointers to a dirty object copy from it
+    for (uint32_t obj : objects.get(superNode)) {
+      for (uint32_t pointer : pointedBy.get(obj)) {
+        for (uint32_t edge : succEdges.get(pointer)) {
+          auto const &entry = results.getEdges()[edge];
+          auto constraint = static_cast<Constraints>(static_cast<uint32_t>(entry.constraint));
+          if (constraint == Constraints::load || constraint == Constraints::special) {
+            mark(entry.dst);
+            markDerived(pointer);
+          }
+        }
+      }
+    }
+  }
+
+ public:
+  explicit DirtyNodes(const PersistedResults &results) : results(results), dirty(results.getNumNodes()) {
+    auto const numNodes = results.getNumNodes();
+    auto const edges = results.getEdges();
+    succEdges.build(numNodes, [&](auto add) {
+      for (uint32_t i = 0; i < edges.size(); i++) {
+        add(getSuperNode(edges[i].src), i);
+      }
+    });
+    storeEdges.build(numNodes, [&](auto add) {
+      for (uint32_t i = 0; i < edges.size(); i++) {
+        if (edges[i].constraint == static_cast<uint32_t>(Constraints::store)) {
+          add(getSuperNode(edges[i].dst), i);
+        }
+      }
+    });
+    derivedEdges.build(numNodes, [&](auto add) {
+      for (uint32_t i = 0; i < edges.size(); i++) {
+        if (edges[i].via != PersistedResults::NONE) {
+          add(getSuperNode(edges[i].via), i);
+        }
+      }
+    });
+    objects.build(numNodes, [&](auto add) {
+      for (uint32_t obj = 0; obj < results.getObjects().size(); obj++) {
+        add(getSuperNode(results.getObjects()[obj].nodeID), obj);
+      }
+    });
+    pointedBy.build(results.getObjects().size(), [&](auto add) {
+      for (NodeID id = 0; id < numNodes; id++) {
+        if (getSuperNode(id) != id) continue;
+        for (NodeID obj : results.getPointsTo(id)) {
+          add(obj, id);
+        }
+      }
+    });
+  }
+
+  // the node or something in its pts changed
+  void mark(NodeID id) {
+    NodeID superNode = getSuperNode(id);
+    if (!dirty.test(superNode)) {
+      dirty.set(superNode);
+      worklist.push_back(superNode);
+    }
+  }
+
+  // the constraint is not in the new graph
+  void retract(const EdgeEntry &edge) { markEdge(edge); }
+
+  // mark everything that depends on a dirty node
+  void propagate() {
+    while (!worklist.empty()) {
+      NodeID superNode = worklist.back();
+      worklist.pop_back();
+      propagate(superNode);
+    }
+  }
+
+  [[nodiscard]] bool isDirty(NodeID id) const { return dirty.test(getSuperNode(id)); }
+};
+
+}  // namespace pta
@@ -0,0 +1,86 @@
+/* Copyright 2021 Coderrect Inc. All Rights Reserved.
+Licensed under the GNU Affero General Public License, version 3 or later (“AGPL”), as published by the Free Software
+Foundation. You may not use this file except in compliance with the License. You may obtain a copy of the License at
+https://www.gnu.org/licenses/agpl-3.0.en.html
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an “AS IS” BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <llvm/ADT/ArrayRef.h>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace pta {
+
+// A graph built from the constraint graph before solving, in CSR form: the successors of node i are
+// succs[offsets[i]] .. succs[offsets[i + 1] - 1].
+struct OfflineGraph {
+  std::vector<uint32_t> offsets;
+  std::vector<uint32_t> succs;
+
+  [[nodiscard]] inline uint32_t getNodeNum() const { return static_cast<uint32_t>(offsets.size() - 1); }
+};
+
+// Iterative Tarjan over an offline graph, calls onSCC with the members of each SCC in reverse topological order.
+template <typename OnSCC>
+void forEachOfflineSCC(const OfflineGraph &graph, OnSCC onSCC) {
+  constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+  auto const n = graph.getNodeNum();
+
+  std::vector<uint32_t> index(n, NONE);
+  std::vector<uint32_t> lowLink(n, 0);
+  std::vector<bool> onStack(n, false);
+  std::vector<uint32_t> sccStack;
+  std::vector<std::pair<uint32_t, uint32_t>> visitStack;  // (node, next successor)
+  uint32_t nextIndex = 0;
+
+  for (uint32_t root = 0; root < n; root++) {
+    if (index[root] != NONE) continue;
+    visitStack.emplace_back(root, graph.offsets[root]);
+    index[root] = lowLink[root] = nextIndex++;
+    sccStack.push_back(root);
+    onStack[root] = true;
+
+    while (!visitStack.empty()) {
+      auto &[node, next] = visitStack.back();
+      if (next < graph.offsets[node + 1]) {
+        auto const succ = graph.succs[next++];
+        if (index[succ] == NONE) {
+          index[succ] = lowLink[succ] = nextIndex++;
+          sccStack.push_back(succ);
+          onStack[succ] = true;
+          visitStack.emplace_back(succ, graph.offsets[succ]);
+        } else if (onStack[succ]) {
+          lowLink[node] = std::min(lowLink[node], index[succ]);
+        }
+        continue;
+      }
+
+      auto const done = node;
+      visitStack.pop_back();
+      if (!visitStack.empty()) {
+        auto const parent = visitStack.back().first;
+        lowLink[parent] = std::min(lowLink[parent], lowLink[done]);
+      }
+      if (lowLink[done] != index[done]) continue;
+
+      // the scc is everything above done on the stack
+      auto first = sccStack.size();
+      do {
+        first--;
+        onStack[sccStack[first]] = false;
+      } while (sccStack[first] != done);
+      onSCC(llvm::ArrayRef<uint32_t>(sccStack.data() + first, sccStack.size() - first));
+      sccStack.resize(first);
+    }
+  }
+}
+
+}  // namespace pta
@@ -11,13 +11,19 @@ limitations under the License.
 
 #pragma once
 
-#include <stack>
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/Support/ThreadPool.h>
 
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <thread>
+
+#include "HybridCycleDetection.h"
 #include "PointerAnalysis/Graph/ConstraintGraph/SCCIterator.h"
+#include "PointerEquivalence.h"
 #include "SolverBase.h"
-
-//#define HASH_EDGE_LIMIT 6700417 // a large enough prime number
-#define HASH_EDGE_LIMIT 1000032953
+#include "WorkList.h"
 
 namespace pta {
 // just experimental feature for now.
@@ -96,38 +102,57 @@ class PartialUpdateSolver : public SolverBase<LangModel, PartialUpdateSolver<Lan
 
   inline void recordCopyEdge(CGNodeTy *src, CGNodeTy *dst) {
     // src is not a newly added node
-    if (src->getNodeID() < copyWorkList.size()) {
-      copyWorkList.reset(src->getNodeID());
+    if (src->getNodeID() < copyWorkList.getNodeNum()) {
+      copyWorkList.push(src->getNodeID());
     }
 
-    if (dst->getNodeID() < targetList.size()) {
-      targetList.reset(dst->getNodeID());
+    if (dst->getNodeID() < targetList.getNodeNum()) {
+      targetList.push(dst->getNodeID());
     }
 
     // we need to handle the copy edge
-    requiredEdge.set(hashEdge(src, dst));
+    requiredEdge.insert(edgeKey(src, dst));
   }
 
   // seems like the scc becomes the bottleneck, need to merge large scc
   void processCopySCC(const std::vector<CGNodeTy *> &scc) {
+    CGNodeTy *superNode = collapseNodes(scc);
+
+    const PtsTy &pts = PT::getPointsTo(superNode->getNodeID());
+    for (auto cit = superNode->succ_copy_begin(), cie = superNode->succ_copy_end(); cit != cie; cit++) {
+      if (copyPts(pts, *cit)) {
+        // the copy edge changed the pts of src
+        lsWorkList.push((*cit)->getNodeID());
+      }
+    }
+    onPropagated(superNode);
+  }
+
+  // merge the nodes into one of them, return the merged node
+  CGNodeTy *collapseNodes(const std::vector<CGNodeTy *> &scc) {
     assert(scc.size() > 1);
 
-    CGNodeTy *superNode = scc.front();
-    for (auto nit = ++(scc.begin()), nie = scc.end(); nit != nie; nit++) {
+    CGNodeTy *superNode = super::getConsGraph()->selectSuperNode(scc);
+    for (CGNodeTy *node : scc) {
+      if (node == superNode) {
+        continue;
+      }
       // if any node in the scc is the target, the scc supernode is the target
-      if (!targetList.test((*nit)->getNodeID())) {
-        targetList.reset(superNode->getNodeID());
+      if (targetList.contains(node->getNodeID())) {
+        targetList.push(superNode->getNodeID());
       }
 
-      // merge pts in scc all into front
-      super::processCopy(*nit, superNode);
+      // merge pts in scc all into the super node
+      super::processCopy(node, superNode);
       // clear the points-to set after it is merged into the super node
-      PT::clear((*nit)->getNodeID());
+      PT::clear(node->getNodeID());
+      diffPts[node->getNodeID()].clear();
+      lsDiffPts[node->getNodeID()].clear();
     }
 
-    lsWorkList.reset(superNode->getNodeID());
-
-    // changedCopy.set(hashEdge(superNode, superNode));
+    lsWorkList.push(superNode->getNodeID());
+    // the super node takes over the load/store edges of the whole scc, which have not seen its full pts yet
+    lsProcessed.reset(superNode->getNodeID());
 
     // collapse scc to the front node
     super::getConsGraph()->collapseSCCTo(scc, superNode);
@@ -136,165 +161,540 @@ class PartialUpdateSolver : public SolverBase<LangModel, PartialUpdateSolver<Lan
     if (superNode->isFunctionPtr()) {
       this->updateFunPtr(superNode->getNodeID());
     }
+    return superNode;
+  }
+
+  // hybrid cycle detection: the objects newly pointed to by node are in a copy cycle with its target
+  void queueHCDMerges(CGNodeTy *node, const PtsTy &newPts) {
+    auto it = hcdTargets.find(node->getNodeID());
+    if (it == hcdTargets.end()) {
+      return;
+    }
+    for (auto obj : newPts) {
+      pendingMerges.emplace_back(super::getConsGraph()->getObjectNode(obj)->getNodeID(), it->second);
+    }
+  }
 
-    for (auto cit = superNode->succ_copy_begin(), cie = superNode->succ_copy_end(); cit != cie; cit++) {
-      if (super::processCopy(superNode, *cit)) {
-        // the copy edge changed the pts of src
-        // changedCopy.set(hashEdge(superNode, *cit));
+  // merge the pointers that always have the same pts before solving, see computeEquivalentPointers
+  void substituteEquivalentPointers() {
+    ConsGraphTy &consGraph = *(super::getConsGraph());
+    const size_t nodeNum = consGraph.getNodeNum();
+    diffPts.resize(nodeNum);
+    lsDiffPts.resize(nodeNum);
+    propagated.resize(nodeNum, false);
+    lsProcessed.resize(nodeNum, false);
+
+    for (const auto &group : computeEquivalentPointers<PT>(consGraph)) {
+      std::vector<CGNodeTy *> nodes;
+      nodes.reserve(group.size());
+      for (NodeID id : group) {
+        nodes.push_back(consGraph.getNode(id));
+      }
+      collapseNodes(nodes);
+      numSubstitutedNodes += group.size() - 1;
+    }
+    LOG_DEBUG("PTA offline substitution merged {} of {} nodes", numSubstitutedNodes, nodeNum);
+  }
+
+  // Merge the objects queued by hybrid cycle detection into their targets before the next SCC pass.
+  // A merged node has not propagated its new pts yet, so it becomes a root of the pass and copies its full pts.
+  void mergeHCDCandidates() {
+    ConsGraphTy &consGraph = *(super::getConsGraph());
+    for (auto [objID, targetID] : pendingMerges) {
+      CGNodeTy *obj = consGraph.getNode(objID)->getSuperNode();
+      CGNodeTy *target = consGraph.getNode(targetID)->getSuperNode();
+      if (obj == target || obj->isSpecialNode() || obj->isImmutableNode() || target->isImmutableNode()) {
+        continue;
+      }
+
+      CGNodeTy *merged = collapseNodes({target, obj});
+      CGNodeTy *mergedAway = merged == target ? obj : target;
+      // the copy edges recorded by the last load/store pass now lead to the merged node
+      for (auto it = merged->pred_copy_begin(), ie = merged->pred_copy_end(); it != ie; it++) {
+        if (requiredEdge.count(edgeKey(*it, mergedAway))) {
+          requiredEdge.insert(edgeKey(*it, merged));
+        }
+      }
+      copyWorkList.push(merged->getNodeID());
+      propagated.reset(merged->getNodeID());
+      numHCDMerges++;
+    }
+    pendingMerges.clear();
+  }
+
+  // pts(dst) |= pts, the targets new to dst are added to its diff
+  inline bool copyPts(const PtsTy &pts, CGNodeTy *dst) {
+    if (PT::unionWithDiff(dst->getNodeID(), pts, diffPts[dst->getNodeID()])) {
+      if (dst->isFunctionPtr()) {
+        // node used for indirect call
+        this->updateFunPtr(dst->getNodeID());
+      }
+      return true;
+    }
+    return false;
+  }
 
-        lsWorkList.reset((*cit)->getNodeID());
+  // the part of pts(src) that still needs to be copied along src --COPY--> dst
+  inline const PtsTy &getCopyPts(CGNodeTy *src, CGNodeTy *dst) const {
+    NodeID id = src->getNodeID();
+    if (propagated.test(id) && requiredEdge.count(edgeKey(src, dst)) == 0) {
+      // dst already holds everything src had when it last propagated
+      return diffPts[id];
+    }
+    // a new edge, or src never propagated before
+    return PT::getPointsTo(id);
+  }
+
+  // src has copied its diff to all its successors
+  inline void onPropagated(CGNodeTy *src) {
+    NodeID id = src->getNodeID();
+    propagated.set(id);
+    if (lsProcessed.test(id)) {
+      // keep the diff until the loads/stores of src have seen it
+      if (lsDiffPts[id].empty()) {
+        std::swap(lsDiffPts[id], diffPts[id]);
+      } else {
+        lsDiffPts[id] |= diffPts[id];
       }
     }
+    diffPts[id].clear();
+  }
+
+  // the part of pts(node) that the loads/stores of node have not seen yet
+  inline const PtsTy &getLoadStorePts(CGNodeTy *node) const {
+    NodeID id = node->getNodeID();
+    return lsProcessed.test(id) ? lsDiffPts[id] : PT::getPointsTo(id);
+  }
+
+  inline void onLoadStoreProcessed(CGNodeTy *node) {
+    lsProcessed.set(node->getNodeID());
+    lsDiffPts[node->getNodeID()].clear();
   }
 
-  // copy worklist
-  llvm::BitVector copyWorkList;
+  // copy worklist, the roots of the next SCC pass
+  WorkList copyWorkList;
   // load/store/offset worklist
-  llvm::BitVector lsWorkList;
+  WorkList lsWorkList;
   // the target node id of the newly added copy edge by load/store/offset
-  llvm::BitVector targetList;
+  WorkList targetList;
+  // visit numbers reused by the SCC passes, so a pass only touches the nodes it visits
+  std::vector<unsigned> sccVisitNumbers;
+
+  // set of the new added copy edge (identified by the node id of src/dst)
+  // only holds the edges recorded since the last copy propagation, so it stays small and is cheap to clear
+  llvm::DenseSet<std::pair<NodeID, NodeID>> requiredEdge;
+
+  // Difference propagation: a node only copies the targets added to it since it last propagated (diffPts),
+  // and its loads/stores only visit the targets added since they were last processed (lsDiffPts).
+  // Nodes that have not propagated (or been load/store processed) yet use their full pts instead.
+  std::vector<PtsTy> diffPts;
+  std::vector<PtsTy> lsDiffPts;
+  llvm::BitVector propagated;
+  llvm::BitVector lsProcessed;
+
+  // pointer p -> pointer q, where *p is in a cycle with q, see computeHCDTargets
+  llvm::DenseMap<NodeID, NodeID> hcdTargets;
+  // (object node, pointer) pairs found to be in a cycle during load/store processing
+  std::vector<std::pair<NodeID, NodeID>> pendingMerges;
+
+  // workers used by the parallel phases, null when solving on a single thread
+  std::unique_ptr<llvm::ThreadPool> pool;
+  unsigned numWorkers = 1;
+
+  // number of loop iterations a worker claims at once
+  static constexpr size_t PARALLEL_GRAIN = 64;
+  // number of load/store nodes whose new copy edges are gathered at once
+  static constexpr size_t LS_BATCH = 4096;
+
+  // run fn(i) for every i in [0, n) on the worker pool, small ranges run on the calling thread
+  template <typename Fn>
+  void parallelFor(size_t n, Fn fn) {
+    if (pool == nullptr || n <= PARALLEL_GRAIN) {
+      for (size_t i = 0; i < n; i++) {
+        fn(i);
+      }
+      return;
+    }
+
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+      // the workers use the points-to sets of this analysis
+      auto const scope = this->enterScope();
+      for (size_t begin = next.fetch_add(PARALLEL_GRAIN); begin < n; begin = next.fetch_add(PARALLEL_GRAIN)) {
+        for (size_t i = begin, end = std::min(n, begin + PARALLEL_GRAIN); i < end; i++) {
+          fn(i);
+        }
+      }
+    };
+    auto const numTasks = std::min<size_t>(numWorkers, (n + PARALLEL_GRAIN - 1) / PARALLEL_GRAIN);
+    for (size_t i = 0; i < numTasks; i++) {
+      pool->async(worker);
+    }
+    pool->wait();
+  }
+
+  void propagateCopy(const std::vector<CGNodeTy *> &scc) {
+    if (scc.size() > 1) {
+      processCopySCC(scc);
+      return;
+    }
+
+    CGNodeTy *curNode = scc.front();
+    for (auto cit = curNode->succ_copy_begin(), cie = curNode->succ_copy_end(); cit != cie; cit++) {
+      if (shouldProcessCopy(curNode, *cit)) {
+        if (copyPts(getCopyPts(curNode, *cit), *cit)) {
+          lsWorkList.push((*cit)->getNodeID());
+        }
+      }
+    }
+    onPropagated(curNode);
+  }
+
+  // Wave propagation over the copy SCCs (given in reverse topological order).
+  // Each SCC is placed one level past the deepest SCC with an edge into it, so once the levels below are done
+  // every points-to set flowing out of the current level is final. Copies out of a level are grouped by their
+  // target, so each points-to set is written by exactly one worker. The union is order independent, which keeps
+  // the result identical to propagating in topological order.
+  void propagateCopyByLevel(const std::vector<std::vector<CGNodeTy *>> &sccs) {
+    constexpr uint32_t NOT_VISITED = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> sccOf(super::getConsGraph()->getNodeNum(), NOT_VISITED);
+    for (uint32_t i = 0; i < sccs.size(); i++) {
+      for (auto node : sccs[i]) {
+        sccOf[node->getNodeID()] = i;
+      }
+    }
+
+    // successors always come before their predecessors in sccs
+    std::vector<uint32_t> level(sccs.size(), 0);
+    std::vector<std::vector<uint32_t>> waves;
+    for (auto i = static_cast<uint32_t>(sccs.size()); i-- > 0;) {
+      if (level[i] >= waves.size()) {
+        waves.resize(level[i] + 1);
+      }
+      waves[level[i]].push_back(i);
+
+      for (auto node : sccs[i]) {
+        for (auto cit = node->succ_copy_begin(), cie = node->succ_copy_end(); cit != cie; cit++) {
+          auto succ = sccOf[(*cit)->getNodeID()];
+          if (succ != NOT_VISITED && succ != i) {
+            level[succ] = std::max(level[succ], level[i] + 1);
+          }
+        }
+      }
+    }
+
+    // (dst, pts to copy into dst) of the copies that need to be processed in the current wave
+    std::vector<std::pair<CGNodeTy *, const PtsTy *>> copies;
+    std::vector<CGNodeTy *> sources;
+    std::vector<size_t> targets;
+    std::vector<char> changed;
+    for (auto const &wave : waves) {
+      copies.clear();
+      sources.clear();
+      for (auto i : wave) {
+        auto const &scc = sccs[i];
+        if (scc.size() > 1) {
+          // collapsing modifies the constraint graph, but only around this scc, which no other scc in the wave touches
+          processCopySCC(scc);
+          continue;
+        }
+        CGNodeTy *curNode = scc.front();
+        sources.push_back(curNode);
+        for (auto cit = curNode->succ_copy_begin(), cie = curNode->succ_copy_end(); cit != cie; cit++) {
+          if (shouldProcessCopy(curNode, *cit)) {
+            copies.emplace_back(*cit, &getCopyPts(curNode, *cit));
+          }
+        }
+      }
+
+      if (copies.size() <= PARALLEL_GRAIN) {
+        for (auto [dst, pts] : copies) {
+          if (copyPts(*pts, dst)) {
+            lsWorkList.push(dst->getNodeID());
+          }
+        }
+      } else {
+        propagateWave(copies, targets, changed);
+      }
+
+      // the copies above read the diffs of the sources, so they can only be cleared now
+      for (auto src : sources) {
+        onPropagated(src);
+      }
+    }
+  }
+
+  void propagateWave(std::vector<std::pair<CGNodeTy *, const PtsTy *>> &copies, std::vector<size_t> &targets,
+                     std::vector<char> &changed) {
+
+    std::sort(copies.begin(), copies.end(),
+              [](auto const &lhs, auto const &rhs) { return lhs.first->getNodeID() < rhs.first->getNodeID(); });
+    targets.clear();
+    for (size_t i = 0; i < copies.size(); i++) {
+      if (i == 0 || copies[i].first != copies[i - 1].first) {
+        targets.push_back(i);
+      }
+    }
+    targets.push_back(copies.size());
+
+    auto const numTargets = targets.size() - 1;
+    changed.assign(numTargets, false);
+    parallelFor(numTargets, [&](size_t t) {
+      NodeID dst = copies[targets[t]].first->getNodeID();
+      bool targetChanged = false;
+      for (size_t i = targets[t]; i < targets[t + 1]; i++) {
+        targetChanged |= PT::unionWithDiff(dst, *copies[i].second, diffPts[dst]);
+      }
+      changed[t] = targetChanged;
+    });
+
+    // the worklists are shared by every target, so update them after the workers are done
+    for (size_t t = 0; t < numTargets; t++) {
+      if (changed[t]) {
+        CGNodeTy *dst = copies[targets[t]].first;
+        if (dst->isFunctionPtr()) {
+          this->updateFunPtr(dst->getNodeID());
+        }
+        lsWorkList.push(dst->getNodeID());
+      }
+    }
+  }
+
+  void processLoadStoreNode(CGNodeTy *curNode) {
+    const PtsTy &pts = getLoadStorePts(curNode);
+    queueHCDMerges(curNode, pts);
+    for (auto it = curNode->pred_store_begin(), ie = curNode->pred_store_end(); it != ie; it++) {
+      super::processStoreDiff(*it, curNode, pts, [&](CGNodeTy *src, CGNodeTy *dst) { recordCopyEdge(src, dst); });
+    }
+
+    for (auto it = curNode->succ_load_begin(), ie = curNode->succ_load_end(); it != ie; it++) {
+      super::processLoadDiff(curNode, *it, pts, [&](CGNodeTy *src, CGNodeTy *dst) { recordCopyEdge(src, dst); });
+    }
+    onLoadStoreProcessed(curNode);
+
+    processSpecialAndOffset(curNode);
+  }
+
+  void processSpecialAndOffset(CGNodeTy *curNode) {
+    // to handled special constraints
+    for (auto it = curNode->succ_special_begin(), ie = curNode->succ_special_end(); it != ie; it++) {
+      super::processSpecial(curNode, *it, [&](CGNodeTy *src, CGNodeTy *dst) { recordCopyEdge(src, dst); });
+    }
+
+#ifndef NO_ADDR_OF_FOR_OFFSET
+    for (auto it = curNode->succ_offset_begin(), ie = curNode->succ_offset_end(); it != ie; it++) {
+      super::processOffset(curNode, *it, [&](CGNodeTy *fieldObj, CGNodeTy *ptr) {
+        auto addrNode = llvm::cast<ObjNodeTy>(fieldObj)->getAddrTakenNode();
+        recordCopyEdge(addrNode, ptr);
+      });
+    }
+#endif
+  }
 
-  // set of the new added copy edge (identified by the hash value of src/dst)
-  llvm::BitVector requiredEdge;
+  // Load/store processing only reads points-to sets, which do not change until the next copy propagation.
+  // Workers gather the copy edges each load/store implies, then the edges are added to the constraint graph in
+  // node order, exactly as the sequential loop would add them.
+  void processLoadStoreInParallel(const std::vector<NodeID> &nodes) {
+    ConsGraphTy &consGraph = *(super::getConsGraph());
+    using EdgeVec = std::vector<std::pair<CGNodeTy *, CGNodeTy *>>;
+    std::vector<EdgeVec> stores, loads;
+    // the workers must not compress the super node paths they walk
+    auto const superNodeOfObj = [&](NodeID obj) {
+      return consGraph.getCGNode(consGraph.peekSuperNodeID(consGraph.getObjectNode(obj)->getNodeID()));
+    };
+
+    for (size_t batchBegin = 0; batchBegin < nodes.size(); batchBegin += LS_BATCH) {
+      auto const batchSize = std::min(LS_BATCH, nodes.size() - batchBegin);
+      stores.assign(batchSize, EdgeVec());
+      loads.assign(batchSize, EdgeVec());
+
+      parallelFor(batchSize, [&](size_t i) {
+        CGNodeTy *curNode = consGraph.getNode(nodes[batchBegin + i]);
+        const PtsTy &pts = getLoadStorePts(curNode);
+        for (auto it = curNode->pred_store_begin(), ie = curNode->pred_store_end(); it != ie; it++) {
+          for (auto obj : pts) {
+            stores[i].emplace_back(*it, superNodeOfObj(obj));
+          }
+        }
+        for (auto it = curNode->succ_load_begin(), ie = curNode->succ_load_end(); it != ie; it++) {
+          for (auto obj : pts) {
+            loads[i].emplace_back(superNodeOfObj(obj), *it);
+          }
+        }
+      });
 
-  // llvm::BitVector changedCopy;
+      for (size_t i = 0; i < batchSize; i++) {
+        for (auto [src, dst] : stores[i]) {
+          if (consGraph.addConstraints(src, dst, Constraints::copy)) {
+            recordCopyEdge(src, dst);
+          }
+        }
+        for (auto [src, dst] : loads[i]) {
+          if (consGraph.addConstraints(src, dst, Constraints::copy)) {
+            recordCopyEdge(src, dst);
+          }
+        }
+        CGNodeTy *curNode = consGraph.getNode(nodes[batchBegin + i]);
+        queueHCDMerges(curNode, getLoadStorePts(curNode));
+        onLoadStoreProcessed(curNode);
+        processSpecialAndOffset(curNode);
+      }
+    }
+  }
 
  public:
-  PartialUpdateSolver() : copyWorkList(), lsWorkList(), targetList(), requiredEdge(HASH_EDGE_LIMIT) {}
+  PartialUpdateSolver() : copyWorkList(), lsWorkList(), targetList(), requiredEdge() {}
+
+  // The order load/store nodes are processed in, the points-to results are the same for every order.
+  // Topological processes the nodes in the topological order of the copy SCCs they were last propagated in.
+  void setWorkListOrder(WorkListOrder order) { lsWorkList.setOrder(order); }
+
+  // Solve with the given number of threads, 1 solves on the calling thread only.
+  // The points-to results do not depend on the number of threads.
+  void setNumWorkers(unsigned workers) {
+    numWorkers = std::max(1u, workers);
+    if (numWorkers > 1) {
+      pool = std::make_unique<llvm::ThreadPool>(numWorkers);
+    } else {
+      pool.reset();
+    }
+  }
 
  protected:
-  inline size_t hashEdge(CGNodeTy *src, CGNodeTy *dst) {
-    size_t hashed = llvm::hash_value(std::make_pair<void *, void *>(src, dst));
-    return hashed % HASH_EDGE_LIMIT;
+  static inline std::pair<NodeID, NodeID> edgeKey(CGNodeTy *src, CGNodeTy *dst) {
+    return std::make_pair(src->getNodeID(), dst->getNodeID());
   }
 
   bool shouldProcessCopy(CGNodeTy *src, CGNodeTy *dst) {
-    if (!lsWorkList.test(src->getNodeID())) {
+    if (lsWorkList.contains(src->getNodeID())) {
       // if the incoming src changed then yes
       return true;
     }
-    bool isDstTarget = !targetList.test(dst->getNodeID());
-    bool isSrcUnhandled = !copyWorkList.test(src->getNodeID());
+    bool isDstTarget = targetList.contains(dst->getNodeID());
+    bool isSrcUnhandled = copyWorkList.contains(src->getNodeID());
 
     if (isDstTarget && isSrcUnhandled) {
       // whether this is the edge
-      return requiredEdge.test(hashEdge(src, dst));
+      return requiredEdge.count(edgeKey(src, dst)) > 0;
     }
 
     return false;
   }
 
   int numOfPTAIterations = 0;
+  bool substitutePointers = true;
+  size_t numSubstitutedNodes = 0;
+  bool detectHybridCycles = true;
+  size_t numHCDMerges = 0;
+
+ public:
+  // Number of fixed-point iterations run by the solver so far
+  [[nodiscard]] int getNumIterations() const { return numOfPTAIterations; }
+
+  // Number of constraint nodes merged by the offline substitution before solving
+  [[nodiscard]] size_t getNumSubstitutedNodes() const { return numSubstitutedNodes; }
+
+  // Enable or disable the offline substitution, the points-to results are the same either way
+  void setPointerSubstitution(bool enable) { substitutePointers = enable; }
+
+  // Number of objects merged into a copy cycle found by hybrid cycle detection while solving
+  [[nodiscard]] size_t getNumHCDMerges() const { return numHCDMerges; }
+
+  // Enable or disable hybrid cycle detection, the points-to results are the same either way
+  void setHybridCycleDetection(bool enable) { detectHybridCycles = enable; }
+
+ protected:
   void runSolver(LangModel & /* langModel */) {
     ConsGraphTy &consGraph = *(super::getConsGraph());
 
     do {
-      std::stack<std::vector<CGNodeTy *>> copySCCStack;
+      // the constraint graph might have grown since the last iteration
+      const size_t nodeNum = consGraph.getNodeNum();
+      diffPts.resize(nodeNum);
+      lsDiffPts.resize(nodeNum);
+      propagated.resize(nodeNum, false);
+      lsProcessed.resize(nodeNum, false);
+      mergeHCDCandidates();
+
+      // SCCs come out of the iterator in reverse topological order
+      std::vector<std::vector<CGNodeTy *>> copySCCs;
 
       // first do SCC detection and topo-sort
       // load/store/offset can create new copy constraint to be handled
-      auto copy_it = scc_begin<ctx, Constraints::copy, false>(consGraph, copyWorkList);
-      auto copy_ie = scc_end<ctx, Constraints::copy, false>(consGraph, copyWorkList);
+      auto copy_it = scc_begin<ctx, Constraints::copy, false>(consGraph, copyWorkList.getOrdered(),
+                                                              std::move(sccVisitNumbers));
+      auto copy_ie = scc_end<ctx, Constraints::copy, false>(consGraph);
 
       for (; copy_it != copy_ie; ++copy_it) {
-        copySCCStack.push(*copy_it);
+        copySCCs.push_back(*copy_it);
       }
-
-      while (!copySCCStack.empty()) {
-        const std::vector<CGNodeTy *> &scc = copySCCStack.top();
-        // llvm::outs() << scc.front()->getNodeID() << ",";
-
-        if (scc.size() > 1) {
-          processCopySCC(scc);
-        } else {
-          CGNodeTy *curNode = scc.front();
-          for (auto cit = curNode->succ_copy_begin(), cie = curNode->succ_copy_end(); cit != cie; cit++) {
-            if (shouldProcessCopy(curNode, *cit)) {
-              if (super::processCopy(curNode, *cit)) {
-                // changedCopy.set(hashEdge(curNode, *cit));
-                lsWorkList.reset((*cit)->getNodeID());
-              }
-            }
-          }
+      sccVisitNumbers = copy_it.releaseVisitNumbers();
+      for (auto const &scc : copySCCs) {
+        for (auto node : scc) {
+          sccVisitNumbers[node->getNodeID()] = 0;
         }
-        copySCCStack.pop();
       }
 
-      assert(copySCCStack.size() == 0);
-
-      // set all copy to be already handled
-      copyWorkList.set();  // empty the worklist
-      targetList.set();
-
-      requiredEdge.reset();
-
-      // const size_t prevNodeNum = consGraph.getNodeNum();
-      int _lastID = lsWorkList.find_first_unset();
-      while (_lastID >= 0) {
-        unsigned int lastID = static_cast<unsigned int>(_lastID);
-
-        CGNodeTy *curNode = consGraph.getNode(lastID);
-
-        for (auto it = curNode->pred_store_begin(), ie = curNode->pred_store_end(); it != ie; it++) {
-          super::processStore(*it, curNode, [&](CGNodeTy *src, CGNodeTy *dst) { recordCopyEdge(src, dst); });
-        }
-
-        for (auto it = curNode->succ_load_begin(), ie = curNode->succ_load_end(); it != ie; it++) {
-          super::processLoad(curNode, *it, [&](CGNodeTy *src, CGNodeTy *dst) { recordCopyEdge(src, dst); });
+      if (lsWorkList.getOrder() == WorkListOrder::Topological) {
+        auto rank = static_cast<uint32_t>(copySCCs.size());
+        for (auto const &scc : copySCCs) {
+          rank--;
+          for (auto node : scc) {
+            lsWorkList.setPriority(node->getNodeID(), rank);
+          }
         }
+      }
 
-        // to handled special constraints
-        for (auto it = curNode->succ_special_begin(), ie = curNode->succ_special_end(); it != ie; it++) {
-          super::processSpecial(curNode, *it, [&](CGNodeTy *src, CGNodeTy *dst) { recordCopyEdge(src, dst); });
+      if (pool != nullptr) {
+        propagateCopyByLevel(copySCCs);
+      } else {
+        for (auto it = copySCCs.rbegin(), ie = copySCCs.rend(); it != ie; it++) {
+          propagateCopy(*it);
         }
+      }
 
-#ifndef NO_ADDR_OF_FOR_OFFSET
-        for (auto it = curNode->succ_offset_begin(), ie = curNode->succ_offset_end(); it != ie; it++) {
-          super::processOffset(curNode, *it, [&](CGNodeTy *fieldObj, CGNodeTy *ptr) {
-            auto addrNode = llvm::cast<ObjNodeTy>(fieldObj)->getAddrTakenNode();
-            recordCopyEdge(addrNode, ptr);
-          });
+      // set all copy to be already handled
+      copyWorkList.clear();  // empty the worklist
+      targetList.clear();
+
+      requiredEdge.clear();
+
+      // mark all lsWorkList as done
+      auto const lsNodes = lsWorkList.take();
+      if (pool != nullptr) {
+        processLoadStoreInParallel(lsNodes);
+      } else {
+        for (NodeID id : lsNodes) {
+          processLoadStoreNode(consGraph.getNode(id));
         }
-#endif
-        _lastID = lsWorkList.find_next_unset(lastID);
       }
 
-#ifndef NO_ADDR_OF_FOR_OFFSET
-      // index field can create new object thus make the constraint graph
-      // larger.
-      lsWorkList.resize(consGraph.getNodeNum(), true);
-      lsWorkList.set();  // mark all lsWorkList as done
-#else
-      assert(prevNodeNum == consGraph.getNodeNum());
-      llvm::BitVector tmpWorklist(lsWorkList);
-      lsWorkList.set();  // copy and clear lsWorkList
-
-      lastID = tmpWorklist.find_first_unset();
-
-      while (lastID >= 0) {
-        CGNodeTy *curNode = consGraph.getNode(lastID);
+#ifdef NO_ADDR_OF_FOR_OFFSET
+      for (NodeID id : lsNodes) {
+        CGNodeTy *curNode = consGraph.getNode(id);
 
         for (auto it = curNode->succ_offset_begin(), ie = curNode->succ_offset_end(); it != ie; it++) {
           super::processOffset(curNode, *it, [&](CGNodeTy *fieldObj, CGNodeTy *ptr) {
-            assert(ptr->getNodeID() < targetList.size());
+            assert(ptr->getNodeID() < targetList.getNodeNum());
             // targetList.reset(ptr->getNodeID());
-            PT::insert(ptr->getNodeID(), llvm::cast<ObjNodeTy>(fieldObj)->getObjectID());
+            NodeID objID = llvm::cast<ObjNodeTy>(fieldObj)->getObjectID();
+            if (PT::insert(ptr->getNodeID(), objID)) {
+              diffPts[ptr->getNodeID()].set(objID);
+            }
 
             // ensure that ptr is visited by SCCIterator
-            copyWorkList.reset(ptr->getNodeID());
+            copyWorkList.push(ptr->getNodeID());
             // the pts of ptr has been updated, so need to be revisted by
             // load/store
-            lsWorkList.reset(ptr->getNodeID());
+            lsWorkList.push(ptr->getNodeID());
           });
         }
-        lastID = tmpWorklist.find_next_unset(lastID);
       }
 #endif
-      lsWorkList.resize(consGraph.getNodeNum(), true);
-      // the newly added node contains address taken node, which need to be
-      // revisited again so set the extend bit to 0 (unhandled)
-      copyWorkList.resize(consGraph.getNodeNum(), false);
-      targetList.resize(consGraph.getNodeNum(), true);
+      // index field can create new object thus make the constraint graph
+      // larger. the newly added node contains address taken node, which need to be
+      // revisited again
+      growWorkLists(false);
 
 #ifdef RESOLVE_FUNPTR_IMMEDIATELY
       // resolve function pointer at a earlier stage
@@ -306,25 +706,120 @@ class PartialUpdateSolver : public SolverBase<LangModel, PartialUpdateSolver<Lan
       super::getConsGraph()->unregisterCallBack();
 
       // extend the worklist, as the consgraph is expanded,
-      lsWorkList.resize(super::getConsGraph()->getNodeNum(), false);
-      targetList.resize(super::getConsGraph()->getNodeNum(), false);
-      copyWorkList.resize(super::getConsGraph()->getNodeNum(), false);
+      growWorkLists(true);
 #endif
-      // The call to count in this log message is evaluated regardless of log
-      // level and are very expensive LOG_TRACE("hash map fill rate, count = {},
-      // size = {}, rate={}", requiredEdge.count(), requiredEdge.size(),
-      //           ((float)requiredEdge.count()) / requiredEdge.size());
-
+      // no set is being read between two iterations
+      PT::compact();
       LOG_DEBUG("PTA Iteration No: {} - nodes: {}", numOfPTAIterations++, this->getConsGraph()->getNodeNum());
-    } while (!copyWorkList.all());
+      if (super::checkBudget()) return;
+    } while (!copyWorkList.empty());
+  }
+
+  // grow the worklists to the constraint graph, the new nodes are pending in the copy worklist,
+  // and also in the load/store worklist and the target list if allPending.
+  void growWorkLists(bool allPending) {
+    auto const prevNodeNum = static_cast<NodeID>(copyWorkList.getNodeNum());
+    auto const nodeNum = static_cast<NodeID>(super::getConsGraph()->getNodeNum());
+    copyWorkList.resize(nodeNum);
+    lsWorkList.resize(nodeNum);
+    targetList.resize(nodeNum);
+
+    copyWorkList.pushRange(prevNodeNum, nodeNum);
+    if (allPending) {
+      lsWorkList.pushRange(prevNodeNum, nodeNum);
+      targetList.pushRange(prevNodeNum, nodeNum);
+    }
+  }
+
+  void resetSolver() {
+    copyWorkList.reset();
+    lsWorkList.reset();
+    targetList.reset();
+    sccVisitNumbers.clear();
+    requiredEdge.clear();
+    diffPts.clear();
+    lsDiffPts.clear();
+    propagated.clear();
+    lsProcessed.clear();
+    hcdTargets.clear();
+    pendingMerges.clear();
+    numOfPTAIterations = 0;
+    numSubstitutedNodes = 0;
+    numHCDMerges = 0;
   }
 
   void solve() {
     // initially, all node need to be traversed.
-    copyWorkList.resize(super::getConsGraph()->getNodeNum(), false);
-    lsWorkList.resize(super::getConsGraph()->getNodeNum(), false);
-    targetList.resize(super::getConsGraph()->getNodeNum(), false);
+    growWorkLists(true);
 
+    if (substitutePointers) {
+      substituteEquivalentPointers();
+    }
+    if (detectHybridCycles) {
+      hcdTargets = computeHCDTargets(*super::getConsGraph());
+    }
+    solveWorkLists();
+  }
+
+  // The pts of the seeded nodes are already part of their final pts, so they start out as propagated and load/store
+  // processed, apart from the constraints that reach nodes that are solved again. Only the other nodes are queued.
+  void solveIncremental(const llvm::BitVector &seeded) {
+    ConsGraphTy &consGraph = *(super::getConsGraph());
+    const auto nodeNum = static_cast<NodeID>(consGraph.getNodeNum());
+    copyWorkList.resize(nodeNum);
+    lsWorkList.resize(nodeNum);
+    targetList.resize(nodeNum);
+    diffPts.resize(nodeNum);
+    lsDiffPts.resize(nodeNum);
+    propagated.resize(nodeNum, false);
+    lsProcessed.resize(nodeNum, false);
+    for (NodeID id = 0; id < nodeNum; id++) {
+      if (seeded.test(id)) {
+        propagated.set(id);
+        lsProcessed.set(id);
+      } else {
+        copyWorkList.push(id);
+        lsWorkList.push(id);
+        targetList.push(id);
+      }
+    }
+    if (detectHybridCycles) {
+      hcdTargets = computeHCDTargets(consGraph);
+    }
+
+    // a copy only needs to be propagated if dst does not hold pts(src) yet
+    auto const onNewCopy = [&](CGNodeTy *src, CGNodeTy *dst) {
+      if (!PT::contains(dst->getNodeID(), src->getNodeID())) {
+        recordCopyEdge(src, dst);
+      }
+    };
+    for (NodeID id = 0; id < nodeNum; id++) {
+      if (!seeded.test(id)) continue;
+
+      CGNodeTy *curNode = consGraph.getNode(id);
+      for (auto it = curNode->succ_copy_begin(), ie = curNode->succ_copy_end(); it != ie; it++) {
+        onNewCopy(curNode, *it);
+      }
+      // the copies derived from the seeded pts are not in the graph yet
+      for (auto it = curNode->pred_store_begin(), ie = curNode->pred_store_end(); it != ie; it++) {
+        super::processStore(*it, curNode, onNewCopy);
+      }
+      for (auto it = curNode->succ_load_begin(), ie = curNode->succ_load_end(); it != ie; it++) {
+        super::processLoad(curNode, *it, onNewCopy);
+      }
+      processSpecialAndOffset(curNode);
+
+      if (curNode->isFunctionPtr() && !PT::isEmpty(id)) {
+        this->updateFunPtr(id);
+      }
+    }
+    // the field objects created above
+    growWorkLists(true);
+    solveWorkLists();
+  }
+
+  // run the solver until the worklists are empty and no indirect call resolves to new targets
+  void solveWorkLists() {
 #ifdef RESOLVE_FUNPTR_IMMEDIATELY
     this->runSolver(*super::getLangModel());
 #else
@@ -334,11 +829,12 @@ class PartialUpdateSolver : public SolverBase<LangModel, PartialUpdateSolver<Lan
     do {
       // after this, the current contraints graph will reach fixed point.
       this->runSolver(*super::getLangModel());
+      if (super::checkBudget()) return;
 
-      assert(lsWorkList.all());  // all visited (1)
-      assert(targetList.all());
-      assert(copyWorkList.all());
-      assert(!requiredEdge.any());  // all zero
+      assert(lsWorkList.empty());  // all visited (1)
+      assert(targetList.empty());
+      assert(copyWorkList.empty());
+      assert(requiredEdge.empty());
 
       // record every constraints added during indirect call resolve
       size_t prevNodeNum = super::getConsGraph()->getNodeNum();
@@ -349,16 +845,25 @@ class PartialUpdateSolver : public SolverBase<LangModel, PartialUpdateSolver<Lan
       super::getConsGraph()->unregisterCallBack();
 
       // extend the worklist, as the consgraph is expanded,
-      lsWorkList.resize(super::getConsGraph()->getNodeNum(), false);
-      targetList.resize(super::getConsGraph()->getNodeNum(), false);
-      copyWorkList.resize(super::getConsGraph()->getNodeNum(), false);
+      growWorkLists(true);
     } while (reanalyze);
 #endif
+    PT::compact();
   }
   friend super;
   friend CallBack;
 };
 
+// PartialUpdateSolver running copy propagation and load/store processing on a pool of worker threads.
+// Gives the same points-to results as PartialUpdateSolver.
+template <typename LangModel>
+class ParallelPartialUpdateSolver : public PartialUpdateSolver<LangModel> {
+ public:
+  explicit ParallelPartialUpdateSolver(unsigned numWorkers = std::thread::hardware_concurrency()) {
+    this->setNumWorkers(numWorkers);
+  }
+};
+
 // template <typename LangModel>
 // char PartialUpdateSolver<LangModel>::ID = 0;
 //
@@ -0,0 +1,387 @@
+/* Copyright 2021 Coderrect Inc. All Rights Reserved.
+Licensed under the GNU Affero General Public License, version 3 or later (“AGPL”), as published by the Free Software
+Foundation. You may not use this file except in compliance with the License. You may obtain a copy of the License at
+https://www.gnu.org/licenses/agpl-3.0.en.html
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an “AS IS” BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/ADT/Twine.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/Endian.h>
+#include <llvm/Support/EndianStream.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+#include "PointerAnalysis/Graph/NodeID.def"
+
+namespace pta {
+
+// Numbers the globals, functions, arguments and instructions of a module in module order,
+// so that the values referred to by persisted results can be found again in another run on the same module.
+class ValueNumbering {
+  std::vector<const llvm::Value *> values;
+  llvm::DenseMap<const llvm::Value *, uint32_t> ids;
+
+  void add(const llvm::Value *value) {
+    ids.try_emplace(value, static_cast<uint32_t>(values.size()));
+    values.push_back(value);
+  }
+
+ public:
+  static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+  explicit ValueNumbering(const llvm::Module &module) {
+    for (auto const &global : module.globals()) {
+      add(&global);
+    }
+    for (auto const &function : module) {
+      add(&function);
+      for (auto const &arg : function.args()) {
+        add(&arg);
+      }
+      for (auto const &block : function) {
+        for (auto const &inst : block) {
+          add(&inst);
+        }
+      }
+    }
+  }
+
+  [[nodiscard]] uint32_t getID(const llvm::Value *value) const {
+    auto it = ids.find(value);
+    return it == ids.end() ? NONE : it->second;
+  }
+
+  [[nodiscard]] const llvm::Value *getValue(uint32_t id) const { return id < values.size() ? values[id] : nullptr; }
+};
+
+// Solved pointer-analysis results in a file that is mapped into memory and queried in place.
+//
+// Layout, every field is a little-endian uint32 unless noted:
+//   header     magic, version, module hash (uint64), layout hash (uint64), numConstructedNodes, numNodes,
+//              numObjects, numPts, numEvents, numEdges, numConstructedEdges, numFunctions
+//   superNodes [numNodes]       the super node of every constraint node
+//   ptsBegin   [numNodes + 1]   pts(n) of a super node n is ptsData[ptsBegin[n], ptsBegin[n + 1])
+//   ptsData    [numPts]         object ids, sorted
+//   nodeKeys   [numNodes]       uint64 structural key of every node, 0 if it has none, see StructuralKeys
+//   objects    [numObjects]     (constraint node id, ValueNumbering id of the allocation site)
+//   events     [numEvents]      the SolveEvents of the run in order, see EventEntry
+//   edges      [numEdges]       the constraints of the graph that the solver did not derive, see EdgeEntry
+//   functions  [numFunctions]   uint64 structural key of every function owning a node
+//   nodeOwners [numNodes]       the function whose constraints create the node, an index into functions or NONE
+// numConstructedNodes is the size of the constraint graph before solving, the events grow it to numNodes.
+// The first numConstructedEdges edges are the constraints of the graph as constructed.
+// The keys, events and edges let a run on a changed module reuse the results, see Incremental.h.
+class PersistedResults {
+ public:
+  using u32 = llvm::support::ulittle32_t;
+  using u64 = llvm::support::ulittle64_t;
+
+  static constexpr uint32_t MAGIC = 0x5450524f;  // "ORPT"
+  static constexpr uint32_t VERSION = 3;
+  static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+  struct Header {
+    u32 magic;
+    u32 version;
+    u64 moduleHash;
+    u64 layoutHash;
+    u32 numConstructedNodes;
+    u32 numNodes;
+    u32 numObjects;
+    u32 numPts;
+    u32 numEvents;
+    u32 numEdges;
+    u32 numConstructedEdges;
+    u32 numFunctions;
+  };
+
+  struct ObjectEntry {
+    u32 nodeID;
+    u32 allocSite;
+  };
+
+  // id and value replay the event on the same module.
+  // On another module an IndexObject is found by the key of the object node and the key of the GEP (target),
+  // a ResolveCall by the key of the indirect call (site) and of the function (target). node is the object node
+  // or the function pointer node of the event.
+  struct EventEntry {
+    u32 kind;
+    u32 id;
+    u32 value;
+    u32 node;
+    u64 site;
+    u64 target;
+  };
+
+  // src --constraint--> dst, via is NONE for a constraint of the program, or the source of the special
+  // constraint whose objects added the copy
+  struct EdgeEntry {
+    u32 src;
+    u32 dst;
+    u32 constraint;
+    u32 via;
+  };
+
+  // the file is read in place, the entries must not be padded
+  static_assert(sizeof(Header) == 56 && sizeof(ObjectEntry) == 8 && sizeof(EventEntry) == 32 &&
+                sizeof(EdgeEntry) == 16);
+
+ private:
+  std::unique_ptr<llvm::MemoryBuffer> buffer;
+  const Header *header = nullptr;
+  const u32 *superNodes = nullptr;
+  const u32 *ptsBegin = nullptr;
+  const u32 *ptsData = nullptr;
+  const u64 *nodeKeys = nullptr;
+  const ObjectEntry *objects = nullptr;
+  const EventEntry *events = nullptr;
+  const EdgeEntry *edges = nullptr;
+  const u64 *functions = nullptr;
+  const u32 *nodeOwners = nullptr;
+
+  explicit PersistedResults(std::unique_ptr<llvm::MemoryBuffer> buffer) : buffer(std::move(buffer)) {}
+
+ public:
+  // map the file at path, null if it does not exist or is not a results file
+  static std::unique_ptr<PersistedResults> open(const llvm::Twine &path) {
+    auto file = llvm::MemoryBuffer::getFile(path, /*FileSize=*/-1, /*RequiresNullTerminator=*/false);
+    if (!file) return nullptr;
+
+    std::unique_ptr<PersistedResults> results(new PersistedResults(std::move(file.get())));
+    llvm::StringRef data = results->buffer->getBuffer();
+    if (data.size() < sizeof(Header)) return nullptr;
+
+    auto header = reinterpret_cast<const Header *>(data.data());
+    if (header->magic != MAGIC || header->version != VERSION) return nullptr;
+
+    uint64_t numNodes = header->numNodes;
+    uint64_t size = sizeof(Header) + sizeof(u32) * (numNodes + numNodes + 1 + header->numPts) + sizeof(u64) * numNodes +
+                    sizeof(ObjectEntry) * header->numObjects + sizeof(EventEntry) * header->numEvents +
+                    sizeof(EdgeEntry) * header->numEdges + sizeof(u64) * header->numFunctions +
+                    sizeof(u32) * numNodes;
+    if (data.size() != size || header->numConstructedEdges > header->numEdges) return nullptr;
+
+    results->header = header;
+    results->superNodes = reinterpret_cast<const u32 *>(header + 1);
+    results->ptsBegin = results->superNodes + numNodes;
+    results->ptsData = results->ptsBegin + numNodes + 1;
+    results->nodeKeys = reinterpret_cast<const u64 *>(results->ptsData + header->numPts);
+    results->objects = reinterpret_cast<const ObjectEntry *>(results->nodeKeys + numNodes);
+    results->events = reinterpret_cast<const EventEntry *>(results->objects + header->numObjects);
+    results->edges = reinterpret_cast<const EdgeEntry *>(results->events + header->numEvents);
+    results->functions = reinterpret_cast<const u64 *>(results->edges + header->numEdges);
+    results->nodeOwners = reinterpret_cast<const u32 *>(results->functions + header->numFunctions);
+
+    // the offsets are read without checks from here on
+    for (NodeID id = 0; id < numNodes; id++) {
+      NodeID superNode = results->superNodes[id];
+      if (superNode >= numNodes || results->ptsBegin[id] > results->ptsBegin[id + 1]) return nullptr;
+      uint32_t owner = results->nodeOwners[id];
+      if (owner != NONE && owner >= header->numFunctions) return nullptr;
+    }
+    if (results->ptsBegin[numNodes] != header->numPts) return nullptr;
+    for (auto const &object : results->getObjects()) {
+      if (object.nodeID >= numNodes) return nullptr;
+    }
+    for (NodeID id = 0; id < header->numPts; id++) {
+      if (results->ptsData[id] >= header->numObjects) return nullptr;
+    }
+    for (auto const &event : results->getEvents()) {
+      if (event.node >= numNodes) return nullptr;
+    }
+    for (auto const &edge : results->getEdges()) {
+      if (edge.src >= numNodes || edge.dst >= numNodes || (edge.via != NONE && edge.via >= numNodes)) return nullptr;
+    }
+    return results;
+  }
+
+  // same as open, but also null if the file does not hold results for the module with the given hash
+  static std::unique_ptr<PersistedResults> open(const llvm::Twine &path, uint64_t moduleHash) {
+    auto results = open(path);
+    if (results == nullptr || results->getModuleHash() != moduleHash) return nullptr;
+    return results;
+  }
+
+  [[nodiscard]] uint64_t getModuleHash() const { return header->moduleHash; }
+  [[nodiscard]] uint64_t getLayoutHash() const { return header->layoutHash; }
+  [[nodiscard]] size_t getNumConstructedNodes() const { return header->numConstructedNodes; }
+  [[nodiscard]] size_t getNumNodes() const { return header->numNodes; }
+  [[nodiscard]] bool hasNode(NodeID id) const { return id < header->numNodes; }
+  [[nodiscard]] NodeID getSuperNode(NodeID id) const { return superNodes[id]; }
+  [[nodiscard]] uint64_t getNodeKey(NodeID id) const { return nodeKeys[id]; }
+
+  // the sorted object ids in pts(id)
+  [[nodiscard]] llvm::ArrayRef<u32> getPointsTo(NodeID id) const {
+    NodeID superNode = superNodes[id];
+    return llvm::makeArrayRef(ptsData + ptsBegin[superNode], ptsData + ptsBegin[superNode + 1]);
+  }
+
+  [[nodiscard]] llvm::ArrayRef<ObjectEntry> getObjects() const {
+    return llvm::makeArrayRef(objects, header->numObjects);
+  }
+
+  [[nodiscard]] llvm::ArrayRef<EventEntry> getEvents() const { return llvm::makeArrayRef(events, header->numEvents); }
+
+  [[nodiscard]] llvm::ArrayRef<EdgeEntry> getEdges() const { return llvm::makeArrayRef(edges, header->numEdges); }
+  [[nodiscard]] size_t getNumConstructedEdges() const { return header->numConstructedEdges; }
+
+  [[nodiscard]] llvm::ArrayRef<u64> getFunctions() const {
+    return llvm::makeArrayRef(functions, header->numFunctions);
+  }
+
+  // the index of the function owning the node in getFunctions(), NONE if it has none
+  [[nodiscard]] uint32_t getOwner(NodeID id) const { return nodeOwners[id]; }
+};
+
+// Collects the results of a run and writes them in the layout of PersistedResults
+struct PersistedResultsWriter {
+  uint64_t moduleHash = 0;
+  uint64_t layoutHash = 0;
+  uint32_t numConstructedNodes = 0;
+  std::vector<uint32_t> superNodes;
+  // pts of every node, empty for the nodes that have a super node
+  std::vector<std::vector<uint32_t>> pointsTo;
+  std::vector<uint64_t> nodeKeys;
+  std::vector<std::pair<uint32_t, uint32_t>> objects;
+  // (kind, id, value, node, site, target), see PersistedResults::EventEntry
+  std::vector<std::tuple<uint32_t, uint32_t, uint32_t, uint32_t, uint64_t, uint64_t>> events;
+  std::vector<std::array<uint32_t, 4>> edges;
+  uint32_t numConstructedEdges = 0;
+  std::vector<uint64_t> functions;
+  std::vector<uint32_t> nodeOwners;
+
+  // write to a temporary file first, so that a concurrent run never maps a partially written file
+  bool write(llvm::StringRef path) const {
+    llvm::SmallString<128> tmpPath;
+    int fd;
+    if (llvm::sys::fs::createUniqueFile(path + ".tmp%%%%%%", fd, tmpPath)) return false;
+    {
+      llvm::raw_fd_ostream os(fd, /*shouldClose=*/true);
+      llvm::support::endian::Writer writer(os, llvm::support::little);
+
+      size_t numPts = 0;
+      for (auto const &pts : pointsTo) {
+        numPts += pts.size();
+      }
+
+      writer.write<uint32_t>(PersistedResults::MAGIC);
+      writer.write<uint32_t>(PersistedResults::VERSION);
+      writer.write<uint64_t>(moduleHash);
+      writer.write<uint64_t>(layoutHash);
+      writer.write<uint32_t>(numConstructedNodes);
+      writer.write<uint32_t>(static_cast<uint32_t>(superNodes.size()));
+      writer.write<uint32_t>(static_cast<uint32_t>(objects.size()));
+      writer.write<uint32_t>(static_cast<uint32_t>(numPts));
+      writer.write<uint32_t>(static_cast<uint32_t>(events.size()));
+      writer.write<uint32_t>(static_cast<uint32_t>(edges.size()));
+      writer.write<uint32_t>(numConstructedEdges);
+      writer.write<uint32_t>(static_cast<uint32_t>(functions.size()));
+
+      for (uint32_t superNode : superNodes) {
+        writer.write<uint32_t>(superNode);
+      }
+      uint32_t begin = 0;
+      for (auto const &pts : pointsTo) {
+        writer.write<uint32_t>(begin);
+        begin += pts.size();
+      }
+      writer.write<uint32_t>(begin);
+      for (auto const &pts : pointsTo) {
+        for (uint32_t obj : pts) {
+          writer.write<uint32_t>(obj);
+        }
+      }
+      for (uint64_t key : nodeKeys) {
+        writer.write<uint64_t>(key);
+      }
+      for (auto [nodeID, allocSite] : objects) {
+        writer.write<uint32_t>(nodeID);
+        writer.write<uint32_t>(allocSite);
+      }
+      for (auto const &[kind, id, value, node, site, target] : events) {
+        writer.write<uint32_t>(kind);
+        writer.write<uint32_t>(id);
+        writer.write<uint32_t>(value);
+        writer.write<uint32_t>(node);
+        writer.write<uint64_t>(site);
+        writer.write<uint64_t>(target);
+      }
+      for (auto const &edge : edges) {
+        for (uint32_t field : edge) {
+          writer.write<uint32_t>(field);
+        }
+      }
+      for (uint64_t key : functions) {
+        writer.write<uint64_t>(key);
+      }
+      for (uint32_t owner : nodeOwners) {
+        writer.write<uint32_t>(owner);
+      }
+
+      if (os.has_error()) {
+        os.clear_error();
+        llvm::sys::fs::remove(tmpPath);
+        return false;
+      }
+    }
+    if (llvm::sys::fs::rename(tmpPath, path)) {
+      llvm::sys::fs::remove(tmpPath);
+      return false;
+    }
+    return true;
+  }
+};
+
+// true if the sorted object ids a and b have a normal (not null or universal) object in common
+template <typename R1, typename R2>
+bool intersectsNoSpecialNode(const R1 &a, const R2 &b) {
+  auto it1 = a.begin(), ie1 = a.end();
+  auto it2 = b.begin(), ie2 = b.end();
+  while (it1 != ie1 && it2 != ie2) {
+    NodeID id1 = *it1, id2 = *it2;
+    if (id1 < id2) {
+      it1++;
+    } else if (id2 < id1) {
+      it2++;
+    } else {
+      if (id1 >= NORMAL_OBJ_START_ID) return true;
+      it1++;
+      it2++;
+    }
+  }
+  return false;
+}
+
+// true if the sorted object ids a are the same as b
+template <typename R1, typename R2>
+bool equalPts(const R1 &a, const R2 &b) {
+  return std::equal(a.begin(), a.end(), b.begin(), b.end(),
+                    [](NodeID id1, NodeID id2) { return id1 == id2; });
+}
+
+// true if the sorted object ids a contain every id in b
+template <typename R1, typename R2>
+bool containsPts(const R1 &a, const R2 &b) {
+  return std::includes(a.begin(), a.end(), b.begin(), b.end(), [](NodeID id1, NodeID id2) { return id1 < id2; });
+}
+
+}  // namespace pta
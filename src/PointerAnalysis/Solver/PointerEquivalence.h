@@ -0,0 +1,127 @@
+/* Copyright 2021 Coderrect Inc. All Rights Reserved.
+Licensed under the GNU Affero General Public License, version 3 or later (“AGPL”), as published by the Free Software
+Foundation. You may not use this file except in compliance with the License. You may obtain a copy of the License at
+https://www.gnu.org/licenses/agpl-3.0.en.html
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an “AS IS” BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <llvm/IR/Argument.h>
+#include <llvm/IR/InstrTypes.h>
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include "OfflineGraph.h"
+#include "PointerAnalysis/Graph/ConstraintGraph/ConstraintGraph.h"
+#include "PointerAnalysis/Program/Pointer.h"
+
+namespace pta {
+
+// Offline variable substitution by hash-based value numbering (HVN, Hardekopf & Lin, SAS'07) over copy edges.
+//
+// Every pointer gets a label standing for its final points-to set. A pointer whose pts can change through anything
+// but the copy edges of the initial graph gets a label of its own: objects, pointers with an initial pts,
+// destinations of load/offset/special edges, and formal parameters, call results and anonymous pointers, which get
+// new copy edges as indirect calls are resolved. Any other pointer is labelled by the set of labels of its copy
+// predecessors, so pointers with the same label always have the same pts.
+//
+// Returns the groups of equivalent pointers, each sorted by node id. Pointers that can never point to anything are
+// left alone.
+template <typename PT, typename ctx>
+std::vector<std::vector<NodeID>> computeEquivalentPointers(const ConstraintGraph<ctx> &consGraph) {
+  using CGNodeTy = CGNodeBase<ctx>;
+  constexpr uint32_t EMPTY = 0;  // label of pointers whose pts stays empty
+
+  auto const hasOwnLabel = [](CGNodeTy *node) {
+    if (node->isSpecialNode() || node->isImmutableNode() || !PT::isEmpty(node->getNodeID())) return true;
+    if (node->pred_load_begin() != node->pred_load_end() || node->pred_offset_begin() != node->pred_offset_end() ||
+        node->pred_special_begin() != node->pred_special_end()) {
+      return true;
+    }
+    auto ptrNode = llvm::dyn_cast<CGPtrNode<ctx>>(node);
+    if (ptrNode == nullptr || ptrNode->isAnonNode()) return true;
+    auto const value = ptrNode->getPointer()->getValue();
+    return llvm::isa<llvm::Argument>(value) || llvm::isa<llvm::CallBase>(value);
+  };
+
+  auto const n = static_cast<uint32_t>(consGraph.getNodeNum());
+  OfflineGraph graph;
+  graph.offsets.resize(static_cast<size_t>(n) + 1, 0);
+  for (uint32_t id = 0; id < n; id++) {
+    graph.offsets[id] = static_cast<uint32_t>(graph.succs.size());
+    CGNodeTy *node = consGraph.getCGNode(id);
+    if (node->hasSuperNode()) continue;
+    for (auto it = node->succ_copy_begin(), ie = node->succ_copy_end(); it != ie; it++) {
+      graph.succs.push_back((*it)->getNodeID());
+    }
+  }
+  graph.offsets[n] = static_cast<uint32_t>(graph.succs.size());
+
+  std::vector<std::vector<uint32_t>> sccs;
+  forEachOfflineSCC(graph, [&](llvm::ArrayRef<uint32_t> scc) { sccs.emplace_back(scc.begin(), scc.end()); });
+
+  // label the sccs in topological order, so that all the predecessors are labelled first
+  std::vector<uint32_t> labels(n, EMPTY);
+  std::map<std::vector<uint32_t>, uint32_t> labelOfPreds;
+  uint32_t nextLabel = EMPTY + 1;
+  for (auto sccIt = sccs.rbegin(), sccIe = sccs.rend(); sccIt != sccIe; sccIt++) {
+    auto const &scc = *sccIt;
+    if (consGraph.getCGNode(scc.front())->hasSuperNode()) continue;
+
+    uint32_t label = EMPTY;
+    if (std::any_of(scc.begin(), scc.end(), [&](uint32_t id) { return hasOwnLabel(consGraph.getCGNode(id)); })) {
+      label = nextLabel++;
+    } else {
+      std::vector<uint32_t> predLabels;
+      for (auto const id : scc) {
+        CGNodeTy *node = consGraph.getCGNode(id);
+        for (auto it = node->pred_copy_begin(), ie = node->pred_copy_end(); it != ie; it++) {
+          auto const predLabel = labels[(*it)->getNodeID()];
+          if (predLabel != EMPTY) predLabels.push_back(predLabel);
+        }
+      }
+      std::sort(predLabels.begin(), predLabels.end());
+      predLabels.erase(std::unique(predLabels.begin(), predLabels.end()), predLabels.end());
+
+      if (predLabels.size() == 1) {
+        label = predLabels.front();
+      } else if (!predLabels.empty()) {
+        auto [it, inserted] = labelOfPreds.try_emplace(std::move(predLabels), nextLabel);
+        if (inserted) nextLabel++;
+        label = it->second;
+      }
+    }
+
+    for (auto const id : scc) {
+      labels[id] = label;
+    }
+  }
+
+  // objects, anonymous and immutable pointers keep their own nodes, the solver relies on them not being merged
+  auto const canMerge = [](CGNodeTy *node) {
+    auto ptrNode = llvm::dyn_cast<CGPtrNode<ctx>>(node);
+    return ptrNode != nullptr && !ptrNode->isAnonNode() && !node->isSpecialNode() && !node->isImmutableNode();
+  };
+
+  std::vector<std::vector<NodeID>> groupOfLabel(nextLabel);
+  for (uint32_t id = 0; id < n; id++) {
+    if (labels[id] != EMPTY && canMerge(consGraph.getCGNode(id))) {
+      groupOfLabel[labels[id]].push_back(id);
+    }
+  }
+
+  std::vector<std::vector<NodeID>> groups;
+  for (auto &group : groupOfLabel) {
+    if (group.size() > 1) groups.push_back(std::move(group));
+  }
+  return groups;
+}
+
+}  // namespace pta
@@ -16,6 +16,7 @@ limitations under the License.
 #include <vector>
 
 #include "PointerAnalysis/Solver/PointsTo/PTSTrait.h"
+#include "PointerAnalysis/Util/ScopedInstance.h"
 
 namespace pta {
 
@@ -26,50 +27,71 @@ class BitVectorPTS {
   using PtsTy = llvm::SparseBitVector<>;
   using iterator = PtsTy::iterator;
 
-  static std::vector<PtsTy> ptsVec;
-  // ptsVec[20] ==> SparseBitVector ==> "010000..."
+  // the pts of every node of an analysis
+  struct Storage {
+    std::vector<PtsTy> ptsVec;
+    // ptsVec[20] ==> SparseBitVector ==> "010000..."
+  };
+
+  [[nodiscard]] static inline std::vector<PtsTy>& ptsVec() { return ScopedInstance<Storage>::get().ptsVec; }
 
   static inline void onNewNodeCreation(NodeID id) {
     // should be the same value
     // int ** ptr = (int **) malloc(sizeof(int *)); // o1
     // *ptr = &o2; // ptr
-    assert(id == ptsVec.size());
-    ptsVec.emplace_back();
-    assert(ptsVec.size() == (id + 1));
+    assert(id == ptsVec().size());
+    ptsVec().emplace_back();
+    assert(ptsVec().size() == (id + 1));
   }
 
-  static inline void clearAll() { ptsVec.clear(); }
+  static inline void clearAll() { ptsVec().clear(); }
+
+  // every node owns its set, nothing to release
+  static inline void compact() {}
 
   // get the pts of the corresponding node
   [[nodiscard]] static inline const PtsTy& getPointsTo(NodeID id) {
-    assert(id < ptsVec.size());
-    return ptsVec[id];
+    assert(id < ptsVec().size());
+    return ptsVec()[id];
   }
 
   // union the pts of the nodes
   static inline bool unionWith(NodeID src, NodeID dst) {
-    assert(src < ptsVec.size() && dst < ptsVec.size());
+    assert(src < ptsVec().size() && dst < ptsVec().size());
 
-    bool r = ptsVec[src] |= ptsVec[dst];
+    bool r = ptsVec()[src] |= ptsVec()[dst];
     // bz: this has no problem, but compiler won't git up warnings ... so translate equivalently
     // assert(ptsVec[src].find_last() < 0 ? true : ptsVec[src].find_last() < ptsVec.size());
-    int _last = ptsVec[src].find_last();
+    int _last = ptsVec()[src].find_last();
     if (_last >= 0) {
       long unsigned int last = static_cast<long unsigned int>(_last);
-      assert(last < ptsVec.size());
+      assert(last < ptsVec().size());
     }
     return r;
   }
 
+  // union pts into the pts of the node, and add the newly inserted elements to diff
+  static inline bool unionWithDiff(NodeID id, const PtsTy& pts, PtsTy& diff) {
+    assert(id < ptsVec().size());
+    PtsTy added;
+    added.intersectWithComplement(pts, ptsVec()[id]);
+    if (added.empty()) {
+      return false;
+    }
+    ptsVec()[id] |= added;
+    diff |= added;
+    return true;
+  }
+
   // whether the two pts intersect
   [[nodiscard]] static inline bool intersectWith(NodeID src, NodeID dst) {
-    assert(src < ptsVec.size() && dst < ptsVec.size());
-    return ptsVec[src].intersects(ptsVec[dst]);
+    assert(src < ptsVec().size() && dst < ptsVec().size());
+    return ptsVec()[src].intersects(ptsVec()[dst]);
   }
 
   [[nodiscard]] static inline bool intersectWithNoSpecialNode(NodeID src, NodeID dst) {
-    assert(src < ptsVec.size() && dst < ptsVec.size());
-    auto result = ptsVec[src] & ptsVec[dst];
+    assert(src < ptsVec().size() && dst < ptsVec().size());
+    auto result = ptsVec()[src] & ptsVec()[dst];
 
     for (unsigned i = 0; i < NORMAL_OBJ_START_ID; i++) {
       // remove special node
@@ -81,53 +103,53 @@ class BitVectorPTS {
 
   // insert a node into the pts
   static inline bool insert(NodeID src, TargetID idx) {
-    assert(src < ptsVec.size() && idx < ptsVec.size());
+    assert(src < ptsVec().size() && idx < ptsVec().size());
 
     // JEFF TODO: check if they have the same type?
-    return ptsVec[src].test_and_set(idx);
+    return ptsVec()[src].test_and_set(idx);
   }
 
   // Return true if this has idx as an element
   [[nodiscard]] static inline bool has(NodeID src, TargetID idx) {
-    assert(src < ptsVec.size() && idx < ptsVec.size());
-    return ptsVec[src].test(idx);
+    assert(src < ptsVec().size() && idx < ptsVec().size());
+    return ptsVec()[src].test(idx);
   }
 
   [[nodiscard]] static inline bool equal(NodeID src, NodeID dst) {
-    assert(src < ptsVec.size() && dst < ptsVec.size());
-    return ptsVec[src] == ptsVec[dst];
+    assert(src < ptsVec().size() && dst < ptsVec().size());
+    return ptsVec()[src] == ptsVec()[dst];
   }
 
   // Return true if *this is a superset of other
   [[nodiscard]] static inline bool contains(NodeID src, NodeID dst) {
-    assert(src < ptsVec.size() && dst < ptsVec.size());
-    return ptsVec[src].contains(ptsVec[dst]);
+    assert(src < ptsVec().size() && dst < ptsVec().size());
+    return ptsVec()[src].contains(ptsVec()[dst]);
   }
 
   [[nodiscard]] static inline bool isEmpty(NodeID id) {
-    assert(id < ptsVec.size());
-    return ptsVec[id].empty();
+    assert(id < ptsVec().size());
+    return ptsVec()[id].empty();
   }
 
   [[nodiscard]] static inline iterator begin(NodeID id) {
-    assert(id < ptsVec.size());
-    assert(*ptsVec[id].begin() < ptsVec.size());
-    return ptsVec[id].begin();
+    assert(id < ptsVec().size());
+    assert(*ptsVec()[id].begin() < ptsVec().size());
+    return ptsVec()[id].begin();
   }
 
   [[nodiscard]] static inline iterator end(NodeID id) {
-    assert(id < ptsVec.size());
-    return ptsVec[id].end();
+    assert(id < ptsVec().size());
+    return ptsVec()[id].end();
   }
 
   static inline void clear(NodeID id) {
-    assert(id < ptsVec.size());
-    ptsVec[id].clear();
+    assert(id < ptsVec().size());
+    ptsVec()[id].clear();
   }
 
   static inline size_t count(NodeID id) {
-    assert(id < ptsVec.size());
-    return ptsVec[id].count();
+    assert(id < ptsVec().size());
+    return ptsVec()[id].count();
   }
 
   static inline const PtsTy& getPointedBy(NodeID /*id*/) {
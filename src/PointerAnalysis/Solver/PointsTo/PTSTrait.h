@@ -23,15 +23,25 @@ struct PTSTrait {
   using PtsTy = typename Pts::UnknownTypeError;
   // iterator type
   using iterator = typename Pts::UnknownTypeError;
+  // the points-to sets of one analysis, made current through ScopedInstance<Storage>
+  using Storage = typename Pts::UnknownTypeError;
 
   static inline void clearAll() { return Pts::unKnownMethodError; }
 
   static inline void onNewNodeCreation(NodeID id) { return Pts::unKnownMethodError(id); }
 
+  // release the memory of sets no node holds anymore, called by the solver when no set is being read
+  static inline void compact() { return Pts::unKnownMethodError; }
+
   static inline const PtsTy& getPointsTo(NodeID id) { return Pts::unKnownMethodError(id); }
 
   static inline bool unionWith(NodeID src, NodeID dst) { return Pts::unKnownMethodError(src, dst); }
 
+  // pts(id) |= pts, also adding the elements new to pts(id) into diff
+  static inline bool unionWithDiff(NodeID id, const PtsTy& pts, PtsTy& diff) {
+    return Pts::unKnownMethodError(id, pts, diff);
+  }
+
   static inline bool intersectWith(NodeID src, NodeID dst) { return Pts::unKnownMethodError(src, dst); }
 
   static inline bool intersectWithNoSpecialNode(NodeID src, NodeID dst) { return Pts::unKnownMethodError(src, dst); }
@@ -59,6 +69,9 @@ struct PTSTrait {
 
 }  // namespace pta
 
+// Every points-to set backend defines its trait with this macro. BitVectorPTS keeps a set per node, SharedPTS stores
+// equal sets once and needs less memory when many nodes share a set, RoaringPTS keeps a compressed bitmap per node and
+// is faster on large sets (pts-bench compares them).
 #define DEFINE_PTS_TRAIT(IMPL)                                                                         \
   template <>                                                                                          \
   struct pta::PTSTrait<IMPL> {                                                                         \
@@ -66,14 +79,20 @@ struct PTSTrait {
                                                                                                        \
     using PtsTy = typename IMPL::PtsTy;                                                                \
     using iterator = typename IMPL::iterator;                                                          \
+    using Storage = typename IMPL::Storage;                                                            \
                                                                                                        \
     static inline void clearAll() { return IMPL::clearAll(); }                                         \
     static inline void onNewNodeCreation(NodeID id) { return IMPL::onNewNodeCreation(id); }            \
+    static inline void compact() { return IMPL::compact(); }                                           \
                                                                                                        \
     static inline const PtsTy& getPointsTo(NodeID id) { return IMPL::getPointsTo(id); }                \
                                                                                                        \
     static inline bool unionWith(NodeID src, NodeID dst) { return IMPL::unionWith(src, dst); }         \
                                                                                                        \
+    static inline bool unionWithDiff(NodeID id, const PtsTy& pts, PtsTy& diff) {                       \
+      return IMPL::unionWithDiff(id, pts, diff);                                                       \
+    }                                                                                                  \
+                                                                                                       \
     static inline bool intersectWith(NodeID src, NodeID dst) { return IMPL::intersectWith(src, dst); } \
                                                                                                        \
     static inline bool intersectWithNoSpecialNode(NodeID src, NodeID dst) {                            \
@@ -13,6 +13,7 @@ limitations under the License.
 #pragma once
 
 #include "PTSTrait.h"
+#include "PointerAnalysis/Util/ScopedInstance.h"
 
 namespace pta {
 
@@ -23,48 +24,72 @@ class PointedByPts {
   using PtsTy = llvm::SparseBitVector<>;
   using iterator = PtsTy::iterator;
 
-  // points to set
-  static std::vector<PtsTy> pointsTo;
-  // pointed by set
-  static std::vector<PtsTy> pointedBy;
+  struct Storage {
+    // points to set
+    std::vector<PtsTy> pointsTo;
+    // pointed by set
+    std::vector<PtsTy> pointedBy;
+  };
+
+  [[nodiscard]] static inline std::vector<PtsTy>& pointsTo() { return ScopedInstance<Storage>::get().pointsTo; }
+  [[nodiscard]] static inline std::vector<PtsTy>& pointedBy() { return ScopedInstance<Storage>::get().pointedBy; }
 
   static void clearAll() {
-    pointsTo.clear();
-    pointedBy.clear();
+    pointsTo().clear();
+    pointedBy().clear();
   }
 
+  // every node owns its set, nothing to release
+  static inline void compact() {}
+
   static inline void onNewNodeCreation(NodeID id) {
-    assert(id == pointsTo.size());
-    assert(pointsTo.size() == pointedBy.size());
+    assert(id == pointsTo().size());
+    assert(pointsTo().size() == pointedBy().size());
 
-    pointsTo.emplace_back();
-    pointedBy.emplace_back();
+    pointsTo().emplace_back();
+    pointedBy().emplace_back();
 
-    assert(pointsTo.size() == id + 1 && pointedBy.size() == id + 1);
+    assert(pointsTo().size() == id + 1 && pointedBy().size() == id + 1);
   }
 
   // union the pts of the nodes
   static inline bool unionWith(NodeID src, NodeID dst) {
-    assert(src < pointsTo.size() && dst < pointsTo.size());
+    assert(src < pointsTo().size() && dst < pointsTo().size());
     // update the pointed by relation first
-    for (NodeID id : pointsTo[dst]) {
+    for (NodeID id : pointsTo()[dst]) {
       // must be pointed by dst already
-      assert(pointedBy[id].test(dst));
+      assert(pointedBy()[id].test(dst));
       // now can also be pointed by src
-      pointedBy[id].set(src);
+      pointedBy()[id].set(src);
+    }
+    return pointsTo()[src] |= pointsTo()[dst];
+  }
+
+  // union pts into the pts of the node, and add the newly inserted elements to diff
+  static inline bool unionWithDiff(NodeID id, const PtsTy& pts, PtsTy& diff) {
+    assert(id < pointsTo().size());
+    PtsTy added;
+    added.intersectWithComplement(pts, pointsTo()[id]);
+    if (added.empty()) {
+      return false;
+    }
+    for (NodeID obj : added) {
+      pointedBy()[obj].set(id);
     }
-    return pointsTo[src] |= pointsTo[dst];
+    pointsTo()[id] |= added;
+    diff |= added;
+    return true;
   }
 
   // whether the two pts intersect
   [[nodiscard]] static inline bool intersectWith(NodeID src, NodeID dst) {
-    assert(src < pointsTo.size() && dst < pointsTo.size());
-    return pointsTo[src].intersects(pointsTo[dst]);
+    assert(src < pointsTo().size() && dst < pointsTo().size());
+    return pointsTo()[src].intersects(pointsTo()[dst]);
   }
 
   [[nodiscard]] static inline bool intersectWithNoSpecialNode(NodeID src, NodeID dst) {
-    assert(src < pointsTo.size() && dst < pointsTo.size());
-    auto result = pointsTo[src] & pointsTo[dst];
+    assert(src < pointsTo().size() && dst < pointsTo().size());
+    auto result = pointsTo()[src] & pointsTo()[dst];
 
     for (int i = 0; i < NORMAL_NODE_START_ID; i++) {
       // remove special node
@@ -76,62 +101,62 @@ class PointedByPts {
 
   // insert a node into the pts
   static inline bool insert(NodeID src, TargetID idx) {
-    assert(src < pointsTo.size() && idx < pointsTo.size());
+    assert(src < pointsTo().size() && idx < pointsTo().size());
     // idx now can be pointed by src
-    pointedBy[idx].set(src);
-    return pointsTo[src].test_and_set(idx);
+    pointedBy()[idx].set(src);
+    return pointsTo()[src].test_and_set(idx);
   }
 
   [[nodiscard]] static inline bool equal(NodeID src, NodeID dst) {
-    assert(src < pointsTo.size() && dst < pointsTo.size());
-    return pointsTo[src] == pointsTo[dst];
+    assert(src < pointsTo().size() && dst < pointsTo().size());
+    return pointsTo()[src] == pointsTo()[dst];
   }
 
   // Return true if this has idx as an element
   [[nodiscard]] static inline bool has(NodeID src, TargetID idx) {
-    assert(src < pointsTo.size() && idx < pointsTo.size());
-    return pointsTo[src].test(idx);
+    assert(src < pointsTo().size() && idx < pointsTo().size());
+    return pointsTo()[src].test(idx);
   }
 
   // Return true if *this is a superset of other
   [[nodiscard]] static inline bool contains(NodeID src, NodeID dst) {
-    assert(src < pointsTo.size() && dst < pointsTo.size());
-    return pointsTo[src].contains(pointsTo[dst]);
+    assert(src < pointsTo().size() && dst < pointsTo().size());
+    return pointsTo()[src].contains(pointsTo()[dst]);
   }
 
   [[nodiscard]] static inline bool isEmpty(NodeID id) {
-    assert(id < pointsTo.size());
-    return pointsTo[id].empty();
+    assert(id < pointsTo().size());
+    return pointsTo()[id].empty();
   }
 
   [[nodiscard]] static inline iterator begin(NodeID id) {
-    assert(id < pointsTo.size());
-    return pointsTo[id].begin();
+    assert(id < pointsTo().size());
+    return pointsTo()[id].begin();
   }
 
   [[nodiscard]] static inline iterator end(NodeID id) {
-    assert(id < pointsTo.size());
-    return pointsTo[id].end();
+    assert(id < pointsTo().size());
+    return pointsTo()[id].end();
   }
 
   static inline void clear(NodeID id) {
-    assert(id < pointsTo.size());
-    pointsTo[id].clear();
+    assert(id < pointsTo().size());
+    pointsTo()[id].clear();
   }
 
   [[nodiscard]] static inline const PtsTy& getPointedBy(NodeID id) {
-    assert(id < pointsTo.size());
-    return pointedBy[id];
+    assert(id < pointsTo().size());
+    return pointedBy()[id];
   }
 
   [[nodiscard]] static inline const PtsTy& getPointsTo(NodeID id) {
-    assert(id < pointsTo.size());
-    return pointsTo[id];
+    assert(id < pointsTo().size());
+    return pointsTo()[id];
   }
 
   [[nodiscard]] static inline size_t count(NodeID id) {
-    assert(id < pointsTo.size());
-    return pointsTo[id].count();
+    assert(id < pointsTo().size());
+    return pointsTo()[id].count();
   }
 
   static inline constexpr bool supportPointedBy() { return true; }
@@ -0,0 +1,748 @@
+/* Copyright 2021 Coderrect Inc. All Rights Reserved.
+Licensed under the GNU Affero General Public License, version 3 or later (“AGPL”), as published by the Free Software
+Foundation. You may not use this file except in compliance with the License. You may obtain a copy of the License at
+https://www.gnu.org/licenses/agpl-3.0.en.html
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an “AS IS” BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "PointerAnalysis/Solver/PointsTo/RoaringBitmap.h"
+
+#include <llvm/Support/MathExtras.h>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define PTA_ROARING_X86
+#include <immintrin.h>
+#endif
+
+using namespace pta;
+
+namespace {
+
+using Container = RoaringBitmap::Container;
+using Kind = RoaringBitmap::Kind;
+
+constexpr uint32_t BITMAP_WORDS = 1024;
+constexpr uint32_t ARRAY_MAX = 4096;
+
+using Words = std::array<uint64_t, BITMAP_WORDS>;
+
+// Kernels on two bitmaps of BITMAP_WORDS words
+struct Kernels {
+  const char *name;
+  // dst |= src, returns the number of bits in dst
+  uint32_t (*unionWith)(uint64_t *dst, const uint64_t *src);
+  // dst = lhs & rhs, returns the number of bits in dst
+  uint32_t (*intersect)(uint64_t *dst, const uint64_t *lhs, const uint64_t *rhs);
+  // dst = lhs & ~rhs, returns the number of bits in dst
+  uint32_t (*difference)(uint64_t *dst, const uint64_t *lhs, const uint64_t *rhs);
+  bool (*intersects)(const uint64_t *lhs, const uint64_t *rhs);
+  // whether rhs is a subset of lhs
+  bool (*contains)(const uint64_t *lhs, const uint64_t *rhs);
+};
+
+uint32_t scalarUnion(uint64_t *dst, const uint64_t *src) {
+  uint32_t card = 0;
+  for (uint32_t i = 0; i < BITMAP_WORDS; i++) {
+    dst[i] |= src[i];
+    card += llvm::countPopulation(dst[i]);
+  }
+  return card;
+}
+
+uint32_t scalarIntersect(uint64_t *dst, const uint64_t *lhs, const uint64_t *rhs) {
+  uint32_t card = 0;
+  for (uint32_t i = 0; i < BITMAP_WORDS; i++) {
+    dst[i] = lhs[i] & rhs[i];
+    card += llvm::countPopulation(dst[i]);
+  }
+  return card;
+}
+
+uint32_t scalarDifference(uint64_t *dst, const uint64_t *lhs, const uint64_t *rhs) {
+  uint32_t card = 0;
+  for (uint32_t i = 0; i < BITMAP_WORDS; i++) {
+    dst[i] = lhs[i] & ~rhs[i];
+    card += llvm::countPopulation(dst[i]);
+  }
+  return card;
+}
+
+bool scalarIntersects(const uint64_t *lhs, const uint64_t *rhs) {
+  for (uint32_t i = 0; i < BITMAP_WORDS; i++) {
+    if (lhs[i] & rhs[i]) return true;
+  }
+  return false;
+}
+
+bool scalarContains(const uint64_t *lhs, const uint64_t *rhs) {
+  for (uint32_t i = 0; i < BITMAP_WORDS; i++) {
+    if (rhs[i] & ~lhs[i]) return false;
+  }
+  return true;
+}
+
+constexpr Kernels scalarKernels{"scalar", scalarUnion, scalarIntersect, scalarDifference, scalarIntersects,
+                                scalarContains};
+
+#ifdef PTA_ROARING_X86
+
+// The bitwise operations and the early exit tests are vectorized, the popcounts use the popcnt instruction.
+
+__attribute__((target("popcnt"))) inline uint32_t popcount(const uint64_t *words, uint32_t n) {
+  uint32_t card = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    card += static_cast<uint32_t>(__builtin_popcountll(words[i]));
+  }
+  return card;
+}
+
+__attribute__((target("sse4.1,popcnt"))) uint32_t sse41Union(uint64_t *dst, const uint64_t *src) {
+  uint32_t card = 0;
+  for (uint32_t i = 0; i < BITMAP_WORDS; i += 2) {
+    auto d = reinterpret_cast<__m128i *>(dst + i);
+    auto s = reinterpret_cast<const __m128i *>(src + i);
+    _mm_storeu_si128(d, _mm_or_si128(_mm_loadu_si128(d), _mm_loadu_si128(s)));
+    card += popcount(dst + i, 2);
+  }
+  return card;
+}
+
+__attribute__((target("sse4.1,popcnt"))) uint32_t sse41Intersect(uint64_t *dst, const uint64_t *lhs,
+                                                                  const uint64_t *rhs) {
+  uint32_t card = 0;
+  for (uint32_t i = 0; i < BITMAP_WORDS; i += 2) {
+    auto l = _mm_loadu_si128(reinterpret_cast<const __m128i *>(lhs + i));
+    auto r = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rhs + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_and_si128(l, r));
+    card += popcount(dst + i, 2);
+  }
+  return card;
+}
+
+__attribute__((target("sse4.1,popcnt"))) uint32_t sse41Difference(uint64_t *dst, const uint64_t *lhs,
+                                                                   const uint64_t *rhs) {
+  uint32_t card = 0;
+  for (uint32_t i = 0; i < BITMAP_WORDS; i += 2) {
+    auto l = _mm_loadu_si128(reinterpret_cast<const __m128i *>(lhs + i));
+    auto r = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rhs + i));
+    // andnot(r, l) is ~r & l
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_andnot_si128(r, l));
+    card += popcount(dst + i, 2);
+  }
+  return card;
+}
+
+__attribute__((target("sse4.1"))) bool sse41Intersects(const uint64_t *lhs, const uint64_t *rhs) {
+  for (uint32_t i = 0; i < BITMAP_WORDS; i += 2) {
+    auto l = _mm_loadu_si128(reinterpret_cast<const __m128i *>(lhs + i));
+    auto r = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rhs + i));
+    if (!_mm_testz_si128(l, r)) return true;
+  }
+  return false;
+}
+
+__attribute__((target("sse4.1"))) bool sse41Contains(const uint64_t *lhs, const uint64_t *rhs) {
+  for (uint32_t i = 0; i < BITMAP_WORDS; i += 2) {
+    auto l = _mm_loadu_si128(reinterpret_cast<const __m128i *>(lhs + i));
+    auto r = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rhs + i));
+    // testc(l, r) is whether ~l & r is 0
+    if (!_mm_testc_si128(l, r)) return false;
+  }
+  return true;
+}
+
+__attribute__((target("avx2,popcnt"))) uint32_t avx2Union(uint64_t *dst, const uint64_t *src) {
+  uint32_t card = 0;
+  for (uint32_t i = 0; i < BITMAP_WORDS; i += 4) {
+    auto d = reinterpret_cast<__m256i *>(dst + i);
+    auto s = reinterpret_cast<const __m256i *>(src + i);
+    _mm256_storeu_si256(d, _mm256_or_si256(_mm256_loadu_si256(d), _mm256_loadu_si256(s)));
+    card += popcount(dst + i, 4);
+  }
+  return card;
+}
+
+__attribute__((target("avx2,popcnt"))) uint32_t avx2Intersect(uint64_t *dst, const uint64_t *lhs,
+                                                               const uint64_t *rhs) {
+  uint32_t card = 0;
+  for (uint32_t i = 0; i < BITMAP_WORDS; i += 4) {
+    auto l = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(lhs + i));
+    auto r = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(rhs + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_and_si256(l, r));
+    card += popcount(dst + i, 4);
+  }
+  return card;
+}
+
+__attribute__((target("avx2,popcnt"))) uint32_t avx2Difference(uint64_t *dst, const uint64_t *lhs,
+                                                                const uint64_t *rhs) {
+  uint32_t card = 0;
+  for (uint32_t i = 0; i < BITMAP_WORDS; i += 4) {
+    auto l = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(lhs + i));
+    auto r = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(rhs + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_andnot_si256(r, l));
+    card += popcount(dst + i, 4);
+  }
+  return card;
+}
+
+__attribute__((target("avx2"))) bool avx2Intersects(const uint64_t *lhs, const uint64_t *rhs) {
+  for (uint32_t i = 0; i < BITMAP_WORDS; i += 4) {
+    auto l = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(lhs + i));
+    auto r = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(rhs + i));
+    if (!_mm256_testz_si256(l, r)) return true;
+  }
+  return false;
+}
+
+__attribute__((target("avx2"))) bool avx2Contains(const uint64_t *lhs, const uint64_t *rhs) {
+  for (uint32_t i = 0; i < BITMAP_WORDS; i += 4) {
+    auto l = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(lhs + i));
+    auto r = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(rhs + i));
+    if (!_mm256_testc_si256(l, r)) return false;
+  }
+  return true;
+}
+
+constexpr Kernels sse41Kernels{"sse4.1", sse41Union, sse41Intersect, sse41Difference, sse41Intersects, sse41Contains};
+constexpr Kernels avx2Kernels{"avx2", avx2Union, avx2Intersect, avx2Difference, avx2Intersects, avx2Contains};
+
+#endif
+
+const Kernels *selectKernels() {
+#ifdef PTA_ROARING_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) return &avx2Kernels;
+  if (__builtin_cpu_supports("sse4.1") && __builtin_cpu_supports("popcnt")) return &sse41Kernels;
+#endif
+  return &scalarKernels;
+}
+
+const Kernels *const bestKernels = selectKernels();
+const Kernels *kernels = bestKernels;
+
+// Bitmap helpers
+
+inline bool testBit(const uint64_t *words, uint16_t low) { return (words[low >> 6] >> (low & 63)) & 1; }
+inline void setBit(uint64_t *words, uint16_t low) { words[low >> 6] |= uint64_t(1) << (low & 63); }
+inline void clearBit(uint64_t *words, uint16_t low) { words[low >> 6] &= ~(uint64_t(1) << (low & 63)); }
+
+// set the bits [start, last]
+void setRange(uint64_t *words, uint32_t start, uint32_t last) {
+  uint32_t const firstWord = start >> 6, lastWord = last >> 6;
+  uint64_t const firstMask = ~uint64_t(0) << (start & 63);
+  uint64_t const lastMask = ~uint64_t(0) >> (63 - (last & 63));
+  if (firstWord == lastWord) {
+    words[firstWord] |= firstMask & lastMask;
+    return;
+  }
+  words[firstWord] |= firstMask;
+  for (uint32_t i = firstWord + 1; i < lastWord; i++) {
+    words[i] = ~uint64_t(0);
+  }
+  words[lastWord] |= lastMask;
+}
+
+// Run helpers, runs are (start, length - 1) pairs
+
+inline uint32_t numRunsOf(const Container &c) { return static_cast<uint32_t>(c.values.size() / 2); }
+inline uint32_t runStart(const Container &c, uint32_t i) { return c.values[2 * i]; }
+inline uint32_t runLast(const Container &c, uint32_t i) { return uint32_t(c.values[2 * i]) + c.values[2 * i + 1]; }
+
+inline void appendRun(std::vector<uint16_t> &runs, uint32_t start, uint32_t last) {
+  runs.push_back(static_cast<uint16_t>(start));
+  runs.push_back(static_cast<uint16_t>(last - start));
+}
+
+// Container helpers
+
+bool containerTest(const Container &c, uint16_t low) {
+  switch (c.kind) {
+    case Kind::Array:
+      return std::binary_search(c.values.begin(), c.values.end(), low);
+    case Kind::Bitmap:
+      return testBit(c.bits.data(), low);
+    case Kind::Run: {
+      // the last run starting at or before low
+      uint32_t lo = 0, hi = numRunsOf(c);
+      while (lo < hi) {
+        uint32_t const mid = (lo + hi) / 2;
+        if (runStart(c, mid) <= low) {
+          lo = mid + 1;
+        } else {
+          hi = mid;
+        }
+      }
+      return lo > 0 && low <= runLast(c, lo - 1);
+    }
+  }
+  return false;
+}
+
+// the container as a bitmap, either its own words or a copy in scratch
+const uint64_t *asBitmap(const Container &c, Words &scratch) {
+  switch (c.kind) {
+    case Kind::Bitmap:
+      return c.bits.data();
+    case Kind::Array:
+      scratch.fill(0);
+      for (auto low : c.values) {
+        setBit(scratch.data(), low);
+      }
+      return scratch.data();
+    case Kind::Run:
+      scratch.fill(0);
+      for (uint32_t i = 0, n = numRunsOf(c); i < n; i++) {
+        setRange(scratch.data(), runStart(c, i), runLast(c, i));
+      }
+      return scratch.data();
+  }
+  return nullptr;
+}
+
+void toBitmap(Container &c) {
+  if (c.kind == Kind::Bitmap) return;
+  Words scratch;
+  asBitmap(c, scratch);
+  c.bits.assign(scratch.begin(), scratch.end());
+  c.values.clear();
+  c.values.shrink_to_fit();
+  c.kind = Kind::Bitmap;
+}
+
+// only for containers with at most ARRAY_MAX ids
+void toArray(Container &c) {
+  assert(c.card <= ARRAY_MAX);
+  std::vector<uint16_t> values;
+  values.reserve(c.card);
+  if (c.kind == Kind::Array) {
+    return;
+  } else if (c.kind == Kind::Bitmap) {
+    for (uint32_t i = 0; i < BITMAP_WORDS; i++) {
+      for (uint64_t w = c.bits[i]; w != 0; w &= w - 1) {
+        values.push_back(static_cast<uint16_t>(i * 64 + llvm::countTrailingZeros(w)));
+      }
+    }
+    c.bits.clear();
+    c.bits.shrink_to_fit();
+  } else {
+    for (uint32_t i = 0, n = numRunsOf(c); i < n; i++) {
+      for (uint32_t v = runStart(c, i), last = runLast(c, i); v <= last; v++) {
+        values.push_back(static_cast<uint16_t>(v));
+      }
+    }
+  }
+  c.values = std::move(values);
+  c.kind = Kind::Array;
+}
+
+// the container as an array if it fits, as a bitmap otherwise
+void toArrayOrBitmap(Container &c) {
+  if (c.card <= ARRAY_MAX) {
+    toArray(c);
+  } else {
+    toBitmap(c);
+  }
+}
+
+uint32_t countRuns(const Container &c) {
+  switch (c.kind) {
+    case Kind::Array: {
+      uint32_t runs = 1;
+      for (size_t i = 1; i < c.values.size(); i++) {
+        if (c.values[i] != c.values[i - 1] + 1) runs++;
+      }
+      return runs;
+    }
+    case Kind::Bitmap: {
+      // a run starts at every set bit whose lower neighbour is not set
+      uint32_t runs = 0;
+      uint64_t carry = 0;
+      for (uint32_t i = 0; i < BITMAP_WORDS; i++) {
+        uint64_t const w = c.bits[i];
+        runs += llvm::countPopulation(w & ~((w << 1) | carry));
+        carry = w >> 63;
+      }
+      return runs;
+    }
+    case Kind::Run:
+      return numRunsOf(c);
+  }
+  return 0;
+}
+
+void toRun(Container &c) {
+  std::vector<uint16_t> runs;
+  if (c.kind == Kind::Run) {
+    return;
+  } else if (c.kind == Kind::Array) {
+    uint32_t start = c.values[0], last = c.values[0];
+    for (size_t i = 1; i < c.values.size(); i++) {
+      if (c.values[i] != last + 1) {
+        appendRun(runs, start, last);
+        start = c.values[i];
+      }
+      last = c.values[i];
+    }
+    appendRun(runs, start, last);
+  } else {
+    // scan for the first set bit, then for the first clear bit after it
+    uint32_t i = 0;
+    uint64_t w = c.bits[0];
+    while (true) {
+      while (w == 0 && ++i < BITMAP_WORDS) w = c.bits[i];
+      if (i == BITMAP_WORDS) break;
+      uint32_t const start = i * 64 + llvm::countTrailingZeros(w);
+      // fill the bits below start so that the first clear bit is the end of the run
+      w |= w - 1;
+      while (w == ~uint64_t(0) && ++i < BITMAP_WORDS) w = c.bits[i];
+      if (i == BITMAP_WORDS) {
+        appendRun(runs, start, 0xFFFF);
+        break;
+      }
+      uint32_t const end = i * 64 + llvm::countTrailingOnes(w);
+      appendRun(runs, start, end - 1);
+      // clear the bits below end
+      w &= ~uint64_t(0) << (end & 63);
+    }
+    c.bits.clear();
+    c.bits.shrink_to_fit();
+  }
+  c.values = std::move(runs);
+  c.kind = Kind::Run;
+}
+
+// Pick the smallest kind for the container. Runs are only used when they are at least twice as small, so that a few
+// consecutive ids do not flip between arrays and runs on every insertion.
+void optimize(Container &c) {
+  size_t const arrayBytes = c.card <= ARRAY_MAX ? c.card * sizeof(uint16_t) : SIZE_MAX;
+  size_t const bitmapBytes = BITMAP_WORDS * sizeof(uint64_t);
+  size_t const runBytes = countRuns(c) * 2 * sizeof(uint16_t);
+  if (runBytes * 2 <= std::min(arrayBytes, bitmapBytes)) {
+    toRun(c);
+  } else {
+    toArrayOrBitmap(c);
+  }
+}
+
+bool containerSet(Container &c, uint16_t low) {
+  if (c.kind == Kind::Run) {
+    if (containerTest(c, low)) return false;
+    toArrayOrBitmap(c);
+  }
+
+  if (c.kind == Kind::Array) {
+    auto it = std::lower_bound(c.values.begin(), c.values.end(), low);
+    if (it != c.values.end() && *it == low) return false;
+    c.values.insert(it, low);
+    c.card++;
+    if (c.card > ARRAY_MAX) toBitmap(c);
+    return true;
+  }
+
+  if (testBit(c.bits.data(), low)) return false;
+  setBit(c.bits.data(), low);
+  c.card++;
+  return true;
+}
+
+// the container must contain low
+void containerReset(Container &c, uint16_t low) {
+  if (c.kind == Kind::Run) {
+    toArrayOrBitmap(c);
+  }
+  c.card--;
+  if (c.kind == Kind::Array) {
+    c.values.erase(std::lower_bound(c.values.begin(), c.values.end(), low));
+  } else {
+    clearBit(c.bits.data(), low);
+    if (c.card <= ARRAY_MAX) toArray(c);
+  }
+}
+
+// lhs |= rhs, returns whether lhs changed
+bool containerUnion(Container &lhs, const Container &rhs) {
+  uint32_t const oldCard = lhs.card;
+  if (lhs.kind == Kind::Array && rhs.kind == Kind::Array && lhs.card + rhs.card <= ARRAY_MAX) {
+    std::vector<uint16_t> merged;
+    merged.reserve(lhs.card + rhs.card);
+    std::set_union(lhs.values.begin(), lhs.values.end(), rhs.values.begin(), rhs.values.end(),
+                   std::back_inserter(merged));
+    if (merged.size() == oldCard) return false;
+    lhs.values = std::move(merged);
+    lhs.card = static_cast<uint32_t>(lhs.values.size());
+  } else {
+    if (lhs.kind == Kind::Run && rhs.kind == Kind::Array) {
+      // the common case of a few new ids for a dense set
+      bool changed = false;
+      for (auto low : rhs.values) {
+        changed |= containerSet(lhs, low);
+      }
+      if (changed && lhs.kind != Kind::Run) optimize(lhs);
+      return changed;
+    }
+    toBitmap(lhs);
+    if (rhs.kind == Kind::Array) {
+      for (auto low : rhs.values) {
+        if (!testBit(lhs.bits.data(), low)) {
+          setBit(lhs.bits.data(), low);
+          lhs.card++;
+        }
+      }
+    } else {
+      Words scratch;
+      lhs.card = kernels->unionWith(lhs.bits.data(), asBitmap(rhs, scratch));
+    }
+  }
+  optimize(lhs);
+  return lhs.card != oldCard;
+}
+
+bool containerIntersects(const Container &lhs, const Container &rhs) {
+  if (lhs.kind == Kind::Array && rhs.kind == Kind::Array) {
+    auto li = lhs.values.begin(), le = lhs.values.end();
+    auto ri = rhs.values.begin(), re = rhs.values.end();
+    while (li != le && ri != re) {
+      if (*li < *ri) {
+        li = std::lower_bound(li, le, *ri);
+      } else if (*ri < *li) {
+        ri = std::lower_bound(ri, re, *li);
+      } else {
+        return true;
+      }
+    }
+    return false;
+  }
+  if (lhs.kind == Kind::Array || rhs.kind == Kind::Array) {
+    const Container &array = lhs.kind == Kind::Array ? lhs : rhs;
+    const Container &other = lhs.kind == Kind::Array ? rhs : lhs;
+    return std::any_of(array.values.begin(), array.values.end(),
+                       [&](uint16_t low) { return containerTest(other, low); });
+  }
+  if (lhs.kind == Kind::Run && rhs.kind == Kind::Run) {
+    uint32_t i = 0, j = 0;
+    while (i < numRunsOf(lhs) && j < numRunsOf(rhs)) {
+      if (runLast(lhs, i) < runStart(rhs, j)) {
+        i++;
+      } else if (runLast(rhs, j) < runStart(lhs, i)) {
+        j++;
+      } else {
+        return true;
+      }
+    }
+    return false;
+  }
+  Words lhsScratch, rhsScratch;
+  return kernels->intersects(asBitmap(lhs, lhsScratch), asBitmap(rhs, rhsScratch));
+}
+
+// whether rhs is a subset of lhs
+bool containerContains(const Container &lhs, const Container &rhs) {
+  if (rhs.card > lhs.card) return false;
+  if (rhs.kind == Kind::Array) {
+    if (lhs.kind == Kind::Array) {
+      return std::includes(lhs.values.begin(), lhs.values.end(), rhs.values.begin(), rhs.values.end());
+    }
+    return std::all_of(rhs.values.begin(), rhs.values.end(), [&](uint16_t low) { return containerTest(lhs, low); });
+  }
+  Words lhsScratch, rhsScratch;
+  return kernels->contains(asBitmap(lhs, lhsScratch), asBitmap(rhs, rhsScratch));
+}
+
+// lhs & rhs, or lhs & ~rhs if complement, with card 0 if empty
+Container containerAnd(const Container &lhs, const Container &rhs, bool complement) {
+  Container result;
+  result.key = lhs.key;
+  if (lhs.kind == Kind::Array) {
+    for (auto low : lhs.values) {
+      if (containerTest(rhs, low) != complement) result.values.push_back(low);
+    }
+    result.card = static_cast<uint32_t>(result.values.size());
+    return result;
+  }
+  if (!complement && rhs.kind == Kind::Array) {
+    for (auto low : rhs.values) {
+      if (containerTest(lhs, low)) result.values.push_back(low);
+    }
+    result.card = static_cast<uint32_t>(result.values.size());
+    return result;
+  }
+
+  Words lhsScratch, rhsScratch;
+  result.kind = Kind::Bitmap;
+  result.bits.resize(BITMAP_WORDS);
+  auto const lhsBits = asBitmap(lhs, lhsScratch), rhsBits = asBitmap(rhs, rhsScratch);
+  result.card = complement ? kernels->difference(result.bits.data(), lhsBits, rhsBits)
+                           : kernels->intersect(result.bits.data(), lhsBits, rhsBits);
+  if (result.card != 0) optimize(result);
+  return result;
+}
+
+bool containerEqual(const Container &lhs, const Container &rhs) {
+  if (lhs.key != rhs.key || lhs.card != rhs.card) return false;
+  if (lhs.kind == rhs.kind) {
+    // every kind has a single representation of a set
+    return lhs.values == rhs.values && lhs.bits == rhs.bits;
+  }
+  return containerContains(lhs, rhs);
+}
+
+}  // namespace
+
+size_t RoaringBitmap::lowerBound(uint16_t key) const {
+  auto it = std::lower_bound(containers.begin(), containers.end(), key,
+                             [](const Container &c, uint16_t key) { return c.key < key; });
+  return static_cast<size_t>(it - containers.begin());
+}
+
+size_t RoaringBitmap::count() const {
+  size_t result = 0;
+  for (auto const &c : containers) {
+    result += c.card;
+  }
+  return result;
+}
+
+bool RoaringBitmap::test(unsigned id) const {
+  auto const i = lowerBound(highBits(id));
+  return i < containers.size() && containers[i].key == highBits(id) && containerTest(containers[i], lowBits(id));
+}
+
+bool RoaringBitmap::set(unsigned id) {
+  auto const i = lowerBound(highBits(id));
+  if (i < containers.size() && containers[i].key == highBits(id)) {
+    return containerSet(containers[i], lowBits(id));
+  }
+  Container c;
+  c.key = highBits(id);
+  c.card = 1;
+  c.values.push_back(lowBits(id));
+  containers.insert(containers.begin() + static_cast<std::ptrdiff_t>(i), std::move(c));
+  return true;
+}
+
+void RoaringBitmap::reset(unsigned id) {
+  auto const i = lowerBound(highBits(id));
+  if (i == containers.size() || containers[i].key != highBits(id) || !containerTest(containers[i], lowBits(id))) {
+    return;
+  }
+  containerReset(containers[i], lowBits(id));
+  if (containers[i].card == 0) {
+    containers.erase(containers.begin() + static_cast<std::ptrdiff_t>(i));
+  }
+}
+
+bool RoaringBitmap::operator|=(const RoaringBitmap &rhs) {
+  if (this == &rhs || rhs.empty()) return false;
+
+  bool newKeys = false;
+  bool changed = false;
+  for (size_t i = 0, j = 0; j < rhs.containers.size(); j++) {
+    while (i < containers.size() && containers[i].key < rhs.containers[j].key) i++;
+    if (i < containers.size() && containers[i].key == rhs.containers[j].key) {
+      changed |= containerUnion(containers[i], rhs.containers[j]);
+    } else {
+      newKeys = true;
+    }
+  }
+  if (!newKeys) return changed;
+
+  // merge the containers of the chunks that are new to this set
+  std::vector<Container> merged;
+  merged.reserve(containers.size() + rhs.containers.size());
+  size_t i = 0, j = 0;
+  while (i < containers.size() || j < rhs.containers.size()) {
+    if (j == rhs.containers.size() || (i < containers.size() && containers[i].key <= rhs.containers[j].key)) {
+      if (j < rhs.containers.size() && containers[i].key == rhs.containers[j].key) j++;
+      merged.push_back(std::move(containers[i++]));
+    } else {
+      merged.push_back(rhs.containers[j++]);
+    }
+  }
+  containers = std::move(merged);
+  return true;
+}
+
+void RoaringBitmap::intersectWithComplement(const RoaringBitmap &lhs, const RoaringBitmap &rhs) {
+  std::vector<Container> result;
+  result.reserve(lhs.containers.size());
+  size_t j = 0;
+  for (auto const &c : lhs.containers) {
+    while (j < rhs.containers.size() && rhs.containers[j].key < c.key) j++;
+    if (j == rhs.containers.size() || rhs.containers[j].key != c.key) {
+      result.push_back(c);
+      continue;
+    }
+    Container diff = containerAnd(c, rhs.containers[j], true);
+    if (diff.card != 0) result.push_back(std::move(diff));
+  }
+  containers = std::move(result);
+}
+
+bool RoaringBitmap::intersects(const RoaringBitmap &rhs) const {
+  size_t i = 0, j = 0;
+  while (i < containers.size() && j < rhs.containers.size()) {
+    if (containers[i].key < rhs.containers[j].key) {
+      i++;
+    } else if (rhs.containers[j].key < containers[i].key) {
+      j++;
+    } else {
+      if (containerIntersects(containers[i], rhs.containers[j])) return true;
+      i++;
+      j++;
+    }
+  }
+  return false;
+}
+
+bool RoaringBitmap::contains(const RoaringBitmap &rhs) const {
+  size_t i = 0;
+  for (auto const &c : rhs.containers) {
+    while (i < containers.size() && containers[i].key < c.key) i++;
+    if (i == containers.size() || containers[i].key != c.key || !containerContains(containers[i], c)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool RoaringBitmap::operator==(const RoaringBitmap &rhs) const {
+  return containers.size() == rhs.containers.size() &&
+         std::equal(containers.begin(), containers.end(), rhs.containers.begin(), containerEqual);
+}
+
+RoaringBitmap pta::operator&(const RoaringBitmap &lhs, const RoaringBitmap &rhs) {
+  RoaringBitmap result;
+  size_t i = 0, j = 0;
+  while (i < lhs.containers.size() && j < rhs.containers.size()) {
+    if (lhs.containers[i].key < rhs.containers[j].key) {
+      i++;
+    } else if (rhs.containers[j].key < lhs.containers[i].key) {
+      j++;
+    } else {
+      Container c = containerAnd(lhs.containers[i++], rhs.containers[j++], false);
+      if (c.card != 0) result.containers.push_back(std::move(c));
+    }
+  }
+  return result;
+}
+
+size_t RoaringBitmap::getMemoryUsage() const {
+  size_t bytes = containers.capacity() * sizeof(Container);
+  for (auto const &c : containers) {
+    bytes += c.values.capacity() * sizeof(uint16_t) + c.bits.capacity() * sizeof(uint64_t);
+  }
+  return bytes;
+}
+
+const char *RoaringBitmap::getKernelName() { return kernels->name; }
+
+void RoaringBitmap::useScalarKernels(bool scalar) { kernels = scalar ? &scalarKernels : bestKernels; }
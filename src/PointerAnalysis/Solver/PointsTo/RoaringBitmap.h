@@ -0,0 +1,204 @@
+/* Copyright 2021 Coderrect Inc. All Rights Reserved.
+Licensed under the GNU Affero General Public License, version 3 or later (“AGPL”), as published by the Free Software
+Foundation. You may not use this file except in compliance with the License. You may obtain a copy of the License at
+https://www.gnu.org/licenses/agpl-3.0.en.html
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an “AS IS” BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <llvm/Support/MathExtras.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+namespace pta {
+
+// Compressed bitmap in the style of Roaring (Lemire et al.), with the part of the llvm::SparseBitVector interface that
+// the solvers use.
+//
+// The 32-bit id space is split into chunks of 2^16 ids, and a chunk is stored in one of three containers:
+//   Array  - the sorted low 16 bits of the ids, for chunks with at most 4096 ids
+//   Bitmap - 1024 words of bits
+//   Run    - (start, length - 1) pairs of the low 16 bits of consecutive ids
+// The containers of a set are kept sorted by chunk in one vector. Operations on bitmaps use SIMD kernels picked at
+// runtime (see RoaringBitmap.cpp).
+class RoaringBitmap {
+ public:
+  enum class Kind : uint8_t { Array, Bitmap, Run };
+
+  struct Container {
+    // the high 16 bits of the ids in the container
+    uint16_t key = 0;
+    Kind kind = Kind::Array;
+    // number of ids in the container, never 0
+    uint32_t card = 0;
+    // Array: sorted ids, Run: (start, length - 1) pairs
+    std::vector<uint16_t> values;
+    // Bitmap: 1024 words
+    std::vector<uint64_t> bits;
+  };
+
+  class iterator {
+    const std::vector<Container> *containers = nullptr;
+    size_t ci = 0;
+    // Array: index of the id, Bitmap: index of the word, Run: index of the run
+    uint32_t pos = 0;
+    // Bitmap: bits of the current word that are not visited yet, Run: the last id of the current run
+    uint64_t word = 0;
+    uint32_t cur = 0;
+
+    void load();
+    void nextContainer() {
+      ci++;
+      if (ci < containers->size()) load();
+    }
+    void nextInBitmap();
+    void advance();
+
+    friend class RoaringBitmap;
+
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = unsigned;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const unsigned *;
+    using reference = unsigned;
+
+    iterator() = default;
+    iterator(const std::vector<Container> *containers, size_t ci) : containers(containers), ci(ci) {
+      if (ci < containers->size()) load();
+    }
+
+    unsigned operator*() const { return cur; }
+
+    iterator &operator++() {
+      advance();
+      return *this;
+    }
+
+    iterator operator++(int) {
+      iterator tmp = *this;
+      advance();
+      return tmp;
+    }
+
+    bool operator==(const iterator &rhs) const {
+      return ci == rhs.ci && (ci >= containers->size() || cur == rhs.cur);
+    }
+    bool operator!=(const iterator &rhs) const { return !(*this == rhs); }
+  };
+
+ private:
+  std::vector<Container> containers;
+
+  [[nodiscard]] static inline uint16_t highBits(unsigned id) { return static_cast<uint16_t>(id >> 16); }
+  [[nodiscard]] static inline uint16_t lowBits(unsigned id) { return static_cast<uint16_t>(id & 0xFFFF); }
+
+  // index of the container of the chunk, or of the first container after it
+  [[nodiscard]] size_t lowerBound(uint16_t key) const;
+
+ public:
+  [[nodiscard]] iterator begin() const { return iterator(&containers, 0); }
+  [[nodiscard]] iterator end() const { return iterator(&containers, containers.size()); }
+
+  [[nodiscard]] bool empty() const { return containers.empty(); }
+  [[nodiscard]] size_t count() const;
+  void clear() { containers.clear(); }
+
+  [[nodiscard]] bool test(unsigned id) const;
+  // returns true if id was not in the set
+  bool set(unsigned id);
+  bool test_and_set(unsigned id) { return set(id); }
+  void reset(unsigned id);
+
+  // returns true if the set changed
+  bool operator|=(const RoaringBitmap &rhs);
+  // this = lhs - rhs
+  void intersectWithComplement(const RoaringBitmap &lhs, const RoaringBitmap &rhs);
+  [[nodiscard]] bool intersects(const RoaringBitmap &rhs) const;
+  // whether rhs is a subset of this
+  [[nodiscard]] bool contains(const RoaringBitmap &rhs) const;
+
+  bool operator==(const RoaringBitmap &rhs) const;
+  bool operator!=(const RoaringBitmap &rhs) const { return !(*this == rhs); }
+
+  friend RoaringBitmap operator&(const RoaringBitmap &lhs, const RoaringBitmap &rhs);
+
+  // bytes used by the containers
+  [[nodiscard]] size_t getMemoryUsage() const;
+
+  // name of the word kernels in use, "avx2", "sse4.1" or "scalar"
+  static const char *getKernelName();
+  // use the scalar kernels even if the CPU supports SIMD, for benchmarking
+  static void useScalarKernels(bool scalar);
+};
+
+RoaringBitmap operator&(const RoaringBitmap &lhs, const RoaringBitmap &rhs);
+
+inline void RoaringBitmap::iterator::load() {
+  const Container &c = (*containers)[ci];
+  auto const base = static_cast<uint32_t>(c.key) << 16;
+  pos = 0;
+  switch (c.kind) {
+    case Kind::Array:
+      cur = base | c.values[0];
+      break;
+    case Kind::Bitmap:
+      word = c.bits[0];
+      nextInBitmap();
+      break;
+    case Kind::Run:
+      cur = base | c.values[0];
+      word = base | (static_cast<uint32_t>(c.values[0]) + c.values[1]);
+      break;
+  }
+}
+
+inline void RoaringBitmap::iterator::nextInBitmap() {
+  const Container &c = (*containers)[ci];
+  while (word == 0) {
+    if (++pos == c.bits.size()) {
+      nextContainer();
+      return;
+    }
+    word = c.bits[pos];
+  }
+  cur = (static_cast<uint32_t>(c.key) << 16) | (pos * 64 + llvm::countTrailingZeros(word));
+}
+
+inline void RoaringBitmap::iterator::advance() {
+  const Container &c = (*containers)[ci];
+  switch (c.kind) {
+    case Kind::Array:
+      if (++pos < c.values.size()) {
+        cur = (static_cast<uint32_t>(c.key) << 16) | c.values[pos];
+      } else {
+        nextContainer();
+      }
+      break;
+    case Kind::Bitmap:
+      word &= word - 1;
+      nextInBitmap();
+      break;
+    case Kind::Run:
+      if (cur < word) {
+        cur++;
+      } else if ((++pos) * 2 < c.values.size()) {
+        auto const base = static_cast<uint32_t>(c.key) << 16;
+        cur = base | c.values[pos * 2];
+        word = base | (static_cast<uint32_t>(c.values[pos * 2]) + c.values[pos * 2 + 1]);
+      } else {
+        nextContainer();
+      }
+      break;
+  }
+}
+
+}  // namespace pta
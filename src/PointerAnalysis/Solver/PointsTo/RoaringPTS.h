@@ -0,0 +1,139 @@
+/* Copyright 2021 Coderrect Inc. All Rights Reserved.
+Licensed under the GNU Affero General Public License, version 3 or later (“AGPL”), as published by the Free Software
+Foundation. You may not use this file except in compliance with the License. You may obtain a copy of the License at
+https://www.gnu.org/licenses/agpl-3.0.en.html
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an “AS IS” BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <vector>
+
+#include "PointerAnalysis/Solver/PointsTo/PTSTrait.h"
+#include "PointerAnalysis/Solver/PointsTo/RoaringBitmap.h"
+#include "PointerAnalysis/Util/ScopedInstance.h"
+
+namespace pta {
+
+// Same as BitVectorPTS, but every node owns a RoaringBitmap, which is smaller and faster for large and dense sets.
+class RoaringPTS {
+ private:
+  using TargetID = NodeID;
+  using PtsTy = RoaringBitmap;
+  using iterator = PtsTy::iterator;
+
+  // the pts of every node of an analysis
+  struct Storage {
+    std::vector<PtsTy> ptsVec;
+  };
+
+  [[nodiscard]] static inline std::vector<PtsTy>& ptsVec() { return ScopedInstance<Storage>::get().ptsVec; }
+
+  static inline void onNewNodeCreation(NodeID id) {
+    assert(id == ptsVec().size());
+    ptsVec().emplace_back();
+  }
+
+  static inline void clearAll() { ptsVec().clear(); }
+
+  // every node owns its set, nothing to release
+  static inline void compact() {}
+
+  [[nodiscard]] static inline const PtsTy& getPointsTo(NodeID id) {
+    assert(id < ptsVec().size());
+    return ptsVec()[id];
+  }
+
+  static inline bool unionWith(NodeID src, NodeID dst) {
+    assert(src < ptsVec().size() && dst < ptsVec().size());
+    return ptsVec()[src] |= ptsVec()[dst];
+  }
+
+  static inline bool unionWithDiff(NodeID id, const PtsTy& pts, PtsTy& diff) {
+    assert(id < ptsVec().size());
+    PtsTy added;
+    added.intersectWithComplement(pts, ptsVec()[id]);
+    if (added.empty()) {
+      return false;
+    }
+    ptsVec()[id] |= added;
+    diff |= added;
+    return true;
+  }
+
+  [[nodiscard]] static inline bool intersectWith(NodeID src, NodeID dst) {
+    assert(src < ptsVec().size() && dst < ptsVec().size());
+    return ptsVec()[src].intersects(ptsVec()[dst]);
+  }
+
+  [[nodiscard]] static inline bool intersectWithNoSpecialNode(NodeID src, NodeID dst) {
+    assert(src < ptsVec().size() && dst < ptsVec().size());
+    auto result = ptsVec()[src] & ptsVec()[dst];
+    for (unsigned i = 0; i < NORMAL_OBJ_START_ID; i++) {
+      // remove special node
+      result.reset(i);
+    }
+    return !result.empty();
+  }
+
+  static inline bool insert(NodeID src, TargetID idx) {
+    assert(src < ptsVec().size() && idx < ptsVec().size());
+    return ptsVec()[src].test_and_set(idx);
+  }
+
+  [[nodiscard]] static inline bool has(NodeID src, TargetID idx) {
+    assert(src < ptsVec().size() && idx < ptsVec().size());
+    return ptsVec()[src].test(idx);
+  }
+
+  [[nodiscard]] static inline bool equal(NodeID src, NodeID dst) {
+    assert(src < ptsVec().size() && dst < ptsVec().size());
+    return ptsVec()[src] == ptsVec()[dst];
+  }
+
+  [[nodiscard]] static inline bool contains(NodeID src, NodeID dst) {
+    assert(src < ptsVec().size() && dst < ptsVec().size());
+    return ptsVec()[src].contains(ptsVec()[dst]);
+  }
+
+  [[nodiscard]] static inline bool isEmpty(NodeID id) {
+    assert(id < ptsVec().size());
+    return ptsVec()[id].empty();
+  }
+
+  [[nodiscard]] static inline iterator begin(NodeID id) {
+    assert(id < ptsVec().size());
+    return ptsVec()[id].begin();
+  }
+
+  [[nodiscard]] static inline iterator end(NodeID id) {
+    assert(id < ptsVec().size());
+    return ptsVec()[id].end();
+  }
+
+  static inline void clear(NodeID id) {
+    assert(id < ptsVec().size());
+    ptsVec()[id].clear();
+  }
+
+  static inline size_t count(NodeID id) {
+    assert(id < ptsVec().size());
+    return ptsVec()[id].count();
+  }
+
+  static inline const PtsTy& getPointedBy(NodeID /*id*/) {
+    llvm_unreachable("not supported by RoaringPTS, use PointedByPts instead");
+  }
+
+  static inline constexpr bool supportPointedBy() { return false; }
+
+  friend class PTSTrait<RoaringPTS>;
+};
+
+}  // namespace pta
+
+DEFINE_PTS_TRAIT(pta::RoaringPTS)
@@ -0,0 +1,362 @@
+/* Copyright 2021 Coderrect Inc. All Rights Reserved.
+Licensed under the GNU Affero General Public License, version 3 or later (“AGPL”), as published by the Free Software
+Foundation. You may not use this file except in compliance with the License. You may obtain a copy of the License at
+https://www.gnu.org/licenses/agpl-3.0.en.html
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an “AS IS” BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <llvm/ADT/BitVector.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/Hashing.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/SparseBitVector.h>
+
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "PointerAnalysis/Solver/PointsTo/PTSTrait.h"
+#include "PointerAnalysis/Util/ScopedInstance.h"
+
+namespace pta {
+
+// Hash-consed points-to sets: every distinct set is stored once and is never modified, a node only holds the id of
+// its current set. When many pointers end up with the same set this takes less memory than BitVectorPTS, pts-bench
+// reports the memory of both on the sets of a real run.
+// Updating a node builds the new set and looks it up in the table instead of mutating in place. The unions and
+// insertions are memoized on the ids of their operands, and the diffs propagated by the solver are interned too so
+// that their unions hit the memo. Every set counts the nodes holding it, and compact() releases the sets no node
+// holds anymore. The solver calls it between rounds, when no set is being read.
+class SharedPTS {
+ private:
+  using TargetID = NodeID;
+  using PtsTy = llvm::SparseBitVector<>;
+  using iterator = PtsTy::iterator;
+  using PtsID = uint32_t;
+
+  static constexpr PtsID EMPTY_SET = 0;
+
+  struct Storage {
+    // the pts id of every node
+    std::vector<PtsID> nodePts;
+    // the unique sets indexed by id, a deque so that references to a set stay valid while new sets are added
+    std::deque<PtsTy> sets{PtsTy()};
+    // the number of nodes holding every set
+    std::vector<uint32_t> refs{0};
+    // sets that have been held by no node since they were added or since their last node moved to another set
+    std::vector<PtsID> unreferenced;
+    // ids released by compact(), reused by new sets
+    std::vector<PtsID> freeIDs;
+    // hash of a set ==> ids of the sets with that hash
+    std::unordered_map<size_t, llvm::SmallVector<PtsID, 1>> table;
+    // (set, set) ==> union and (set, element) ==> set with the element inserted
+    llvm::DenseMap<std::pair<PtsID, PtsID>, PtsID> unionCache;
+    llvm::DenseMap<std::pair<PtsID, TargetID>, PtsID> insertCache;
+    // the parallel solver updates different nodes concurrently, but they share the tables
+    std::mutex lock;
+  };
+
+  [[nodiscard]] static inline Storage& storage() { return ScopedInstance<Storage>::get(); }
+
+  [[nodiscard]] static inline size_t hashSet(const PtsTy& pts) {
+    return llvm::hash_combine_range(pts.begin(), pts.end());
+  }
+
+  // union is commutative, so the key is ordered
+  [[nodiscard]] static inline std::pair<PtsID, PtsID> unionKey(PtsID lhs, PtsID rhs) {
+    return std::make_pair(std::min(lhs, rhs), std::max(lhs, rhs));
+  }
+
+  // the id of the unique set equal to pts, adding it to the table if needed. Must hold the lock.
+  template <typename Set>
+  static inline PtsID intern(Storage& s, Set&& pts, size_t hash) {
+    if (pts.empty()) {
+      return EMPTY_SET;
+    }
+    auto& bucket = s.table[hash];
+    for (auto id : bucket) {
+      if (s.sets[id] == pts) {
+        return id;
+      }
+    }
+    PtsID id;
+    if (s.freeIDs.empty()) {
+      id = static_cast<PtsID>(s.sets.size());
+      s.sets.emplace_back(std::forward<Set>(pts));
+      s.refs.push_back(0);
+    } else {
+      id = s.freeIDs.back();
+      s.freeIDs.pop_back();
+      s.sets[id] = std::forward<Set>(pts);
+    }
+    // released by the next compact() unless a node takes it before
+    s.unreferenced.push_back(id);
+    bucket.push_back(id);
+    return id;
+  }
+
+  // make id the set of node. Must hold the lock.
+  static inline void assign(Storage& s, NodeID node, PtsID id) {
+    auto const old = s.nodePts[node];
+    if (old == id) {
+      return;
+    }
+    if (id != EMPTY_SET) {
+      s.refs[id]++;
+    }
+    if (old != EMPTY_SET && --s.refs[old] == 0) {
+      s.unreferenced.push_back(old);
+    }
+    s.nodePts[node] = id;
+  }
+
+  static inline PtsID unionOf(Storage& s, PtsID lhs, PtsID rhs) {
+    if (lhs == rhs || rhs == EMPTY_SET) return lhs;
+    if (lhs == EMPTY_SET) return rhs;
+    auto const key = unionKey(lhs, rhs);
+    if (auto it = s.unionCache.find(key); it != s.unionCache.end()) {
+      return it->second;
+    }
+    PtsTy result = s.sets[lhs];
+    result |= s.sets[rhs];
+    auto const hash = hashSet(result);
+    auto const id = intern(s, std::move(result), hash);
+    s.unionCache[key] = id;
+    return id;
+  }
+
+  [[nodiscard]] static inline const PtsTy& setOf(NodeID id) {
+    auto& s = storage();
+    assert(id < s.nodePts.size());
+    return s.sets[s.nodePts[id]];
+  }
+
+  static inline void onNewNodeCreation(NodeID id) {
+    auto& s = storage();
+    assert(id == s.nodePts.size());
+    s.nodePts.push_back(EMPTY_SET);
+  }
+
+  static inline void clearAll() {
+    auto& s = storage();
+    s.nodePts.clear();
+    s.sets.clear();
+    s.sets.emplace_back();
+    s.refs.assign(1, 0);
+    s.unreferenced.clear();
+    s.freeIDs.clear();
+    s.table.clear();
+    s.unionCache.clear();
+    s.insertCache.clear();
+  }
+
+  static inline void compact() {
+    auto& s = storage();
+    std::lock_guard<std::mutex> guard(s.lock);
+    llvm::BitVector released(s.sets.size());
+    for (auto id : s.unreferenced) {
+      // a node took the set again, or it is listed twice
+      if (s.refs[id] != 0 || released.test(id)) {
+        continue;
+      }
+      auto bucket = s.table.find(hashSet(s.sets[id]));
+      assert(bucket != s.table.end());
+      bucket->second.erase(std::find(bucket->second.begin(), bucket->second.end(), id));
+      if (bucket->second.empty()) {
+        s.table.erase(bucket);
+      }
+      s.sets[id].clear();
+      s.freeIDs.push_back(id);
+      released.set(id);
+    }
+    s.unreferenced.clear();
+    if (released.none()) {
+      return;
+    }
+
+    // the released ids are reused by new sets, so no memoized result may refer to them
+    for (auto it = s.unionCache.begin(), ie = s.unionCache.end(); it != ie;) {
+      auto cur = it++;
+      if (released.test(cur->first.first) || released.test(cur->first.second) || released.test(cur->second)) {
+        s.unionCache.erase(cur);
+      }
+    }
+    for (auto it = s.insertCache.begin(), ie = s.insertCache.end(); it != ie;) {
+      auto cur = it++;
+      if (released.test(cur->first.first) || released.test(cur->second)) {
+        s.insertCache.erase(cur);
+      }
+    }
+  }
+
+  [[nodiscard]] static inline const PtsTy& getPointsTo(NodeID id) { return setOf(id); }
+
+  static inline bool unionWith(NodeID src, NodeID dst) {
+    auto& s = storage();
+    assert(src < s.nodePts.size() && dst < s.nodePts.size());
+    std::lock_guard<std::mutex> guard(s.lock);
+    auto const result = unionOf(s, s.nodePts[src], s.nodePts[dst]);
+    if (result == s.nodePts[src]) {
+      return false;
+    }
+    assign(s, src, result);
+    return true;
+  }
+
+  // The solver propagates the same diff to many nodes, which often hold the same set, so the union is memoized on
+  // the ids of the node set and the interned diff. The sets are only computed outside the lock: the set of id can
+  // only be replaced by this thread, and no set is released before the next compact().
+  static inline bool unionWithDiff(NodeID id, const PtsTy& pts, PtsTy& diff) {
+    if (pts.empty()) {
+      return false;
+    }
+    auto& s = storage();
+    assert(id < s.nodePts.size());
+    auto const diffHash = hashSet(pts);
+
+    PtsID cur, result = EMPTY_SET;
+    std::pair<PtsID, PtsID> key;
+    const PtsTy *curPts, *resultPts = nullptr;
+    {
+      std::lock_guard<std::mutex> guard(s.lock);
+      cur = s.nodePts[id];
+      key = unionKey(cur, intern(s, pts, diffHash));
+      if (auto it = s.unionCache.find(key); it != s.unionCache.end()) {
+        result = it->second;
+        resultPts = &s.sets[result];
+      }
+      curPts = &s.sets[cur];
+    }
+
+    PtsTy added;
+    if (resultPts != nullptr) {
+      if (result == cur) {
+        return false;
+      }
+      added.intersectWithComplement(*resultPts, *curPts);
+      diff |= added;
+      std::lock_guard<std::mutex> guard(s.lock);
+      assign(s, id, result);
+      return true;
+    }
+
+    added.intersectWithComplement(pts, *curPts);
+    if (added.empty()) {
+      std::lock_guard<std::mutex> guard(s.lock);
+      s.unionCache[key] = cur;
+      return false;
+    }
+    diff |= added;
+    added |= *curPts;
+    auto const hash = hashSet(added);
+
+    std::lock_guard<std::mutex> guard(s.lock);
+    result = intern(s, std::move(added), hash);
+    s.unionCache[key] = result;
+    assign(s, id, result);
+    return true;
+  }
+
+  [[nodiscard]] static inline bool intersectWith(NodeID src, NodeID dst) {
+    auto& s = storage();
+    assert(src < s.nodePts.size() && dst < s.nodePts.size());
+    auto const lhs = s.nodePts[src], rhs = s.nodePts[dst];
+    if (lhs == EMPTY_SET || rhs == EMPTY_SET) return false;
+    return lhs == rhs || s.sets[lhs].intersects(s.sets[rhs]);
+  }
+
+  [[nodiscard]] static inline bool intersectWithNoSpecialNode(NodeID src, NodeID dst) {
+    auto result = setOf(src) & setOf(dst);
+    for (unsigned i = 0; i < NORMAL_OBJ_START_ID; i++) {
+      // remove special node
+      result.reset(i);
+    }
+    return !result.empty();
+  }
+
+  static inline bool insert(NodeID src, TargetID idx) {
+    auto& s = storage();
+    assert(src < s.nodePts.size() && idx < s.nodePts.size());
+    std::lock_guard<std::mutex> guard(s.lock);
+    auto const cur = s.nodePts[src];
+    auto const key = std::make_pair(cur, idx);
+    auto it = s.insertCache.find(key);
+    if (it == s.insertCache.end()) {
+      if (s.sets[cur].test(idx)) {
+        return false;
+      }
+      PtsTy result = s.sets[cur];
+      result.set(idx);
+      auto const hash = hashSet(result);
+      it = s.insertCache.try_emplace(key, intern(s, std::move(result), hash)).first;
+    }
+    if (it->second == cur) {
+      return false;
+    }
+    assign(s, src, it->second);
+    return true;
+  }
+
+  [[nodiscard]] static inline bool has(NodeID src, TargetID idx) { return setOf(src).test(idx); }
+
+  // equal sets are the same set
+  [[nodiscard]] static inline bool equal(NodeID src, NodeID dst) {
+    auto& s = storage();
+    assert(src < s.nodePts.size() && dst < s.nodePts.size());
+    return s.nodePts[src] == s.nodePts[dst];
+  }
+
+  [[nodiscard]] static inline bool contains(NodeID src, NodeID dst) {
+    auto& s = storage();
+    assert(src < s.nodePts.size() && dst < s.nodePts.size());
+    auto const lhs = s.nodePts[src], rhs = s.nodePts[dst];
+    return lhs == rhs || rhs == EMPTY_SET || s.sets[lhs].contains(s.sets[rhs]);
+  }
+
+  [[nodiscard]] static inline bool isEmpty(NodeID id) {
+    auto& s = storage();
+    assert(id < s.nodePts.size());
+    return s.nodePts[id] == EMPTY_SET;
+  }
+
+  [[nodiscard]] static inline iterator begin(NodeID id) { return setOf(id).begin(); }
+
+  [[nodiscard]] static inline iterator end(NodeID id) { return setOf(id).end(); }
+
+  static inline void clear(NodeID id) {
+    auto& s = storage();
+    assert(id < s.nodePts.size());
+    std::lock_guard<std::mutex> guard(s.lock);
+    assign(s, id, EMPTY_SET);
+  }
+
+  static inline size_t count(NodeID id) { return setOf(id).count(); }
+
+  static inline const PtsTy& getPointedBy(NodeID /*id*/) {
+    llvm_unreachable("not supported by SharedPTS, use PointedByPts instead");
+  }
+
+  static inline constexpr bool supportPointedBy() { return false; }
+
+ public:
+  // number of distinct non-empty sets stored by the analysis in scope, including the ones compact() has not
+  // released yet
+  [[nodiscard]] static inline size_t getNumSets() {
+    auto& s = storage();
+    return s.sets.size() - 1 - s.freeIDs.size();
+  }
+
+  friend class PTSTrait<SharedPTS>;
+};
+
+}  // namespace pta
+
+DEFINE_PTS_TRAIT(pta::SharedPTS)
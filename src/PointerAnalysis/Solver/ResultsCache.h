@@ -0,0 +1,646 @@
+/* Copyright 2021 Coderrect Inc. All Rights Reserved.
+Licensed under the GNU Affero General Public License, version 3 or later (“AGPL”), as published by the Free Software
+Foundation. You may not use this file except in compliance with the License. You may obtain a copy of the License at
+https://www.gnu.org/licenses/agpl-3.0.en.html
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an “AS IS” BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <llvm/ADT/BitVector.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Logging/Log.h"
+#include "PointerAnalysis/Graph/ConstraintGraph/ConstraintGraph.h"
+#include "PointerAnalysis/Models/LanguageModel/LangModelTrait.h"
+#include "PointerAnalysis/Models/MemoryModel/MemModelTrait.h"
+#include "PointerAnalysis/Program/CtxFunction.h"
+#include "PointerAnalysis/Solver/Incremental.h"
+#include "PointerAnalysis/Solver/PersistedResults.h"
+#include "PointerAnalysis/Solver/PointsTo/PTSTrait.h"
+
+namespace pta {
+
+// Results of a solver persisted across runs, see SolverBase::setResultsCache.
+//
+// Once the constraint graph is constructed, loadOrSolve() loads the results of an earlier run on the same module, which
+// are then served by the queries apart from the nodes created after loading. Otherwise it solves the graph through the
+// hooks of the solver, starting from the results of another revision of the module if incremental, and save() keeps
+// the results for the later runs.
+template <typename LangModel>
+class ResultsCache {
+  using LMT = LangModelTrait<LangModel>;
+  using ctx = typename LMT::CtxTy;
+  using CT = CtxTrait<ctx>;
+  using MMT = MemModelTrait<typename LMT::MemModelTy>;
+  using ObjTy = typename MMT::ObjectTy;
+  using PT = PTSTrait<typename LMT::PointsToTy>;
+  using ConsGraphTy = ConstraintGraph<ctx>;
+  using CGNodeTy = CGNodeBase<ctx>;
+  using PtrNodeTy = CGPtrNode<ctx>;
+  using ObjNodeTy = CGObjNode<ctx, ObjTy>;
+
+ public:
+  // what the cache needs from the solver
+  struct Hooks {
+    // drop the solver state and construct the constraint graph again, returns the new language model
+    std::function<LangModel *()> rebuild;
+    // solve the graph from scratch
+    std::function<void()> solve;
+    // solve with the pts of the seeded nodes taken from another revision of the module
+    std::function<void(const llvm::BitVector &)> solveIncremental;
+    // return true if the solve was stopped early by the budget check
+    std::function<bool()> stoppedEarly;
+  };
+
+ private:
+  // the directory of the results, empty if disabled
+  std::string dir;
+  uint64_t moduleHash = 0;
+  std::unique_ptr<PersistedResults> persisted;
+
+  LangModel *langModel = nullptr;
+  ConsGraphTy *consGraph = nullptr;
+  // size of the constraint graph before solving
+  size_t numConstructedNodes = 0;
+
+  // Reusing the results of another revision of the module, see setIncremental
+  bool incremental = false;
+  size_t numReusedNodes = 0;
+  std::unique_ptr<StructuralKeys> structuralKeys;
+  llvm::DenseMap<const ctx *, uint64_t> contextKeys;
+  // the constraints of the graph when solving starts, and the copies the special constraints add while solving,
+  // as (src, dst, constraint, via), see PersistedResults::EdgeEntry
+  std::vector<std::array<uint32_t, 4>> graphEdges;
+  std::vector<std::array<uint32_t, 4>> specialEdges;
+  // the number of graphEdges that are in the graph as constructed
+  size_t numConstructedEdges = 0;
+
+  void setLangModel(LangModel *model) {
+    langModel = model;
+    consGraph = LMT::getConsGraph(model);
+  }
+
+  // the file in dir holding the results for moduleHash
+  [[nodiscard]] std::string getResultsPath() const {
+    llvm::SmallString<128> path(dir);
+    llvm::sys::path::append(path, "openrace-" + llvm::utohexstr(moduleHash, /*LowerCase=*/true) + ".pta");
+    return std::string(path.str());
+  }
+
+  // replay the solve of a previous run on the constructed graph, returns false if there are no usable results
+  bool loadResults() {
+    auto results = PersistedResults::open(getResultsPath(), moduleHash);
+    if (results == nullptr || results->getNumConstructedNodes() != consGraph->getNodeNum()) {
+      return false;
+    }
+
+    ValueNumbering values(*LMT::getLLVMModule(langModel));
+    for (auto const &event : results->getEvents()) {
+      SolveEvent solveEvent{static_cast<typename SolveEvent::Kind>(static_cast<uint32_t>(event.kind)), event.id,
+                            values.getValue(event.value)};
+      if (!LMT::replaySolveEvent(langModel, solveEvent)) {
+        LOG_WARN("Pointer Analysis persisted results do not match the module, solving it instead");
+        return false;
+      }
+    }
+
+    // the replayed graph must have the objects of the run that saved the results
+    bool matches = results->getNumNodes() == consGraph->getNodeNum() &&
+                   results->getObjects().size() == consGraph->getObjectNum();
+    for (NodeID id = 0; matches && id < consGraph->getObjectNum(); id++) {
+      auto const &objEntry = results->getObjects()[id];
+      auto objNode = llvm::cast<ObjNodeTy>(consGraph->getObjectNode(id));
+      uint32_t allocSite =
+          objNode->isSpecialNode() ? ValueNumbering::NONE : values.getID(objNode->getObject()->getValue());
+      matches = objEntry.nodeID == objNode->getNodeID() && objEntry.allocSite == allocSite;
+    }
+    if (!matches) {
+      LOG_WARN("Pointer Analysis persisted results do not match the module, solving it instead");
+      return false;
+    }
+
+    persisted = std::move(results);
+    return true;
+  }
+
+  // save the solved results so that a later run on the same module can load them instead of solving,
+  // and a run on another revision of the module can reuse them
+  void saveResults() {
+    PersistedResultsWriter writer;
+    writer.moduleHash = moduleHash;
+    writer.numConstructedNodes = numConstructedNodes;
+
+    auto &keys = getStructuralKeys();
+    writer.layoutHash = keys.getLayoutHash();
+    addNodeKeys(keys, writer.nodeKeys);
+
+    ValueNumbering values(*LMT::getLLVMModule(langModel));
+    llvm::DenseMap<const llvm::Function *, uint32_t> functions;
+    for (NodeID id = 0; id < consGraph->getNodeNum(); id++) {
+      uint32_t owner = PersistedResults::NONE;
+      if (auto function = getOwner(id)) {
+        auto [it, inserted] = functions.try_emplace(function, writer.functions.size());
+        if (inserted) {
+          writer.functions.push_back(keys.getKey(function));
+        }
+        owner = it->second;
+      }
+      writer.nodeOwners.push_back(owner);
+
+      NodeID superNode = consGraph->peekSuperNodeID(id);
+      writer.superNodes.push_back(superNode);
+      auto &pts = writer.pointsTo.emplace_back();
+      if (superNode == id) {
+        for (auto it = PT::begin(id), ie = PT::end(id); it != ie; it++) {
+          pts.push_back(*it);
+        }
+        std::sort(pts.begin(), pts.end());
+      }
+    }
+    for (NodeID id = 0; id < consGraph->getObjectNum(); id++) {
+      auto objNode = llvm::cast<ObjNodeTy>(consGraph->getObjectNode(id));
+      uint32_t allocSite =
+          objNode->isSpecialNode() ? ValueNumbering::NONE : values.getID(objNode->getObject()->getValue());
+      writer.objects.emplace_back(objNode->getNodeID(), allocSite);
+    }
+    for (auto const &event : LMT::getSolveLog(langModel)) {
+      NodeID node;
+      uint64_t site = 0;
+      if (event.kind == SolveEvent::Kind::IndexObject) {
+        node = consGraph->getObjectNode(event.id)->getNodeID();
+      } else {
+        auto callsite = LMT::getCallGraph(langModel)->getNode(event.id)->getTargetFunPtr();
+        node = LMT::getPtrNode(langModel, callsite->getContext(), callsite->getValue())->getNodeID();
+        site = getCallSiteKey(callsite, keys);
+      }
+      writer.events.emplace_back(static_cast<uint32_t>(event.kind), event.id, values.getID(event.value), node, site,
+                                 keys.getKey(event.value));
+    }
+
+    writer.edges = graphEdges;
+    writer.numConstructedEdges = numConstructedEdges;
+    for (auto const &edge : consGraph->getEdgeLog()) {
+      writer.edges.push_back({edge.src, edge.dst, static_cast<uint32_t>(edge.constraint), PersistedResults::NONE});
+    }
+    writer.edges.insert(writer.edges.end(), specialEdges.begin(), specialEdges.end());
+
+    auto path = getResultsPath();
+    if (!writer.write(path)) {
+      LOG_WARN("Pointer Analysis failed to save results to {}", path);
+    }
+  }
+
+  [[nodiscard]] StructuralKeys &getStructuralKeys() {
+    if (structuralKeys == nullptr) {
+      structuralKeys =
+          std::make_unique<StructuralKeys>(*LMT::getLLVMModule(langModel), LMT::getEntryName(langModel));
+    }
+    return *structuralKeys;
+  }
+
+  // the key of a context is made of the keys of its call sites
+  uint64_t getContextKey(const ctx *context, const StructuralKeys &keys) {
+    CtxID id = CT::getID(context);
+    if (id < FIRST_INTERNED_CTX_ID) {
+      return id;
+    }
+    auto [it, inserted] = contextKeys.try_emplace(context, 0);
+    if (inserted) {
+      StableHash hash;
+      CT::forEachCallSite(context, [&](const llvm::Instruction *callsite) { hash.add(keys.getCallSiteKey(callsite)); });
+      it->second = hash.get();
+    }
+    return it->second;
+  }
+
+  uint64_t getCallSiteKey(const InDirectCallSite<ctx> *callsite, StructuralKeys &keys) {
+    return StableHash()
+        .add("i")
+        .add(getContextKey(callsite->getContext(), keys))
+        .add(keys.getKey(callsite->getCallSite()))
+        .add(keys.getKey(callsite->getValue()))
+        .get();
+  }
+
+  // the key of a node, 0 if it has none
+  uint64_t getNodeKey(NodeID id, StructuralKeys &keys, const std::vector<uint64_t> &nodeKeys) {
+    if (id < NORMAL_NODE_START_ID) {
+      return StableHash().add("n").add(id).get();
+    }
+    CGNodeTy *node = consGraph->getCGNode(id);
+    if (auto objNode = llvm::dyn_cast<ObjNodeTy>(node)) {
+      auto object = objNode->getObject();
+      if (objNode->isSpecialNode() || object->getValue() == nullptr) {
+        return 0;
+      }
+      return StableHash()
+          .add("o")
+          .add(getContextKey(object->getContext(), keys))
+          .add(keys.getKey(object->getValue()))
+          .add(static_cast<uint64_t>(object->getAllocType()))
+          .add(ObjectPosition<ObjTy>::get(*object))
+          .get();
+    }
+
+    auto ptrNode = llvm::cast<PtrNodeTy>(node);
+    if (ptrNode->isAnonNode()) {
+      // every object is followed by the node taking its address
+      if (nodeKeys[id - 1] != 0 && llvm::isa<ObjNodeTy>(consGraph->getCGNode(id - 1))) {
+        return StableHash().add("a").add(nodeKeys[id - 1]).get();
+      }
+      return 0;
+    }
+    return StableHash()
+        .add(LMT::isRetNode(langModel, ptrNode) ? "r" : "p")
+        .add(getContextKey(ptrNode->getContext(), keys))
+        .add(keys.getKey(ptrNode->getPointer()->getValue()))
+        .get();
+  }
+
+  // The function whose body creates the constraints of the node, null for the nodes of globals and constants, whose
+  // constraints any function can create. The node has the same owner in every run it has the same key in.
+  const llvm::Function *getOwner(NodeID id) const {
+    if (id < NORMAL_NODE_START_ID) {
+      return nullptr;
+    }
+    CGNodeTy *node = consGraph->getCGNode(id);
+    const llvm::Value *value = nullptr;
+    if (auto objNode = llvm::dyn_cast<ObjNodeTy>(node)) {
+      if (!objNode->isSpecialNode()) {
+        value = objNode->getObject()->getValue();
+      }
+    } else {
+      auto ptrNode = llvm::cast<PtrNodeTy>(node);
+      if (ptrNode->isAnonNode()) {
+        // every object is followed by the node taking its address
+        return llvm::isa<ObjNodeTy>(consGraph->getCGNode(id - 1)) ? getOwner(id - 1) : nullptr;
+      }
+      value = ptrNode->getPointer()->getValue();
+      if (LMT::isRetNode(langModel, ptrNode)) {
+        return llvm::cast<llvm::Function>(value);
+      }
+    }
+    if (auto inst = llvm::dyn_cast_or_null<llvm::Instruction>(value)) {
+      return inst->getFunction();
+    }
+    if (auto arg = llvm::dyn_cast_or_null<llvm::Argument>(value)) {
+      return arg->getParent();
+    }
+    return nullptr;
+  }
+
+  // add the keys of the nodes created since the last call
+  void addNodeKeys(StructuralKeys &keys, std::vector<uint64_t> &nodeKeys) {
+    for (auto id = static_cast<NodeID>(nodeKeys.size()); id < consGraph->getNodeNum(); id++) {
+      nodeKeys.push_back(getNodeKey(id, keys, nodeKeys));
+    }
+  }
+
+  // map from key to id, a key that is not unique maps to INVALID_NODE_ID
+  static void addKeyIndex(llvm::DenseMap<uint64_t, NodeID> &index, uint64_t key, NodeID id) {
+    if (key == 0) return;
+    auto [it, inserted] = index.try_emplace(key, id);
+    if (!inserted) {
+      it->second = INVALID_NODE_ID;
+    }
+  }
+
+  static NodeID lookupKey(const llvm::DenseMap<uint64_t, NodeID> &index, uint64_t key) {
+    auto it = index.find(key);
+    return it == index.end() ? INVALID_NODE_ID : it->second;
+  }
+
+  // record the constraints in the graph as constructed, the ones added since are logged by the graph
+  void snapshotEdges() {
+    graphEdges.clear();
+    for (NodeID id = 0; id < consGraph->getNodeNum(); id++) {
+      CGNodeTy *node = consGraph->getCGNode(id);
+      for (auto it = node->succ_edge_begin(), ie = node->succ_edge_end(); it != ie; it++) {
+        graphEdges.push_back(
+            {id, (*it).second->getNodeID(), static_cast<uint32_t>((*it).first), PersistedResults::NONE});
+      }
+    }
+    numConstructedEdges = graphEdges.size();
+  }
+
+  // the newest results in dir computed on a module with the layout
+  [[nodiscard]] std::unique_ptr<PersistedResults> findBaseResults(uint64_t layoutHash) const {
+    std::vector<std::pair<llvm::sys::TimePoint<>, std::string>> files;
+    std::error_code ec;
+    for (llvm::sys::fs::directory_iterator it(dir, ec), ie; it != ie && !ec; it.increment(ec)) {
+      auto name = llvm::sys::path::filename(it->path());
+      llvm::sys::fs::file_status status;
+      if (!name.startswith("openrace-") || !name.endswith(".pta") || llvm::sys::fs::status(it->path(), status)) {
+        continue;
+      }
+      files.emplace_back(status.getLastModificationTime(), it->path());
+    }
+    std::sort(files.begin(), files.end(), std::greater<>());
+    for (auto const &file : files) {
+      auto results = PersistedResults::open(file.second);
+      if (results != nullptr && results->getLayoutHash() == layoutHash) {
+        return results;
+      }
+    }
+    return nullptr;
+  }
+
+  // construct the graph again, dropping everything added to it since
+  void rebuildConsGraph(const Hooks &hooks) {
+    specialEdges.clear();
+    setLangModel(hooks.rebuild());
+    LMT::setSolveLogging(langModel, true);
+  }
+
+  // Replay the solve events of the base results that still apply to the module, and find the nodes whose pts in the
+  // base results still hold, see DirtyNodes. A call resolution is only replayed if the pts of its function pointer
+  // holds, otherwise the graph is built again without it. Returns the new id of every node in the base results.
+  std::vector<NodeID> replayBaseResults(const PersistedResults &base, const Hooks &hooks,
+                                        std::unique_ptr<DirtyNodes> &dirty) {
+    auto &keys = getStructuralKeys();
+    auto const events = base.getEvents();
+    std::vector<bool> dropped(events.size(), false);
+
+    // the functions of the base results with the same structural hash in the module
+    std::vector<bool> unchanged;
+    for (uint64_t key : base.getFunctions()) {
+      unchanged.push_back(llvm::isa_and_nonnull<llvm::Function>(keys.getValue(key)));
+    }
+    auto const isUnchanged = [&](NodeID id) {
+      uint32_t owner = base.getOwner(id);
+      return owner != PersistedResults::NONE && unchanged[owner];
+    };
+
+    while (true) {
+      // the replayed events are logged with the constraints added while solving
+      snapshotEdges();
+      consGraph->setEdgeLogging(true);
+      std::vector<uint64_t> nodeKeys;
+      llvm::DenseMap<uint64_t, NodeID> nodesByKey;
+      llvm::DenseMap<uint64_t, NodeID> callsBySite;
+      auto callGraph = LMT::getCallGraph(langModel);
+      NodeID numCalls = 0;
+      auto const update = [&]() {
+        auto begin = static_cast<NodeID>(nodeKeys.size());
+        addNodeKeys(keys, nodeKeys);
+        for (NodeID id = begin; id < nodeKeys.size(); id++) {
+          addKeyIndex(nodesByKey, nodeKeys[id], id);
+        }
+        for (; numCalls < callGraph->getNodeNum(); numCalls++) {
+          auto callNode = callGraph->getNode(numCalls);
+          if (callNode->isIndirectCall()) {
+            addKeyIndex(callsBySite, getCallSiteKey(callNode->getTargetFunPtr(), keys), numCalls);
+          }
+        }
+      };
+      update();
+
+      // the function pointer of the call site each resolution is replayed on
+      std::vector<NodeID> funPtrs(events.size(), INVALID_NODE_ID);
+      for (size_t i = 0; i < events.size(); i++) {
+        auto const &event = events[i];
+        auto const value = keys.getValue(event.target);
+        if (dropped[i] || value == nullptr) continue;
+
+        if (static_cast<SolveEvent::Kind>(static_cast<uint32_t>(event.kind)) == SolveEvent::Kind::IndexObject) {
+          NodeID node = lookupKey(nodesByKey, base.getNodeKey(event.node));
+          auto idx = llvm::dyn_cast<llvm::Instruction>(value);
+          if (node == INVALID_NODE_ID || idx == nullptr || !llvm::isa<ObjNodeTy>(consGraph->getCGNode(node))) continue;
+          LMT::indexObject(langModel, llvm::cast<ObjNodeTy>(consGraph->getCGNode(node)), idx);
+        } else {
+          NodeID callNode = lookupKey(callsBySite, event.site);
+          if (callNode == INVALID_NODE_ID || !llvm::isa<llvm::Function>(value)) continue;
+          auto callsite = callGraph->getNode(callNode)->getTargetFunPtr();
+          funPtrs[i] = LMT::getPtrNode(langModel, callsite->getContext(), callsite->getValue())->getNodeID();
+          LMT::replaySolveEvent(langModel, {SolveEvent::Kind::ResolveCall, callNode, value});
+        }
+        update();
+      }
+      consGraph->setEdgeLogging(false);
+
+      std::vector<NodeID> oldToNew(base.getNumNodes(), INVALID_NODE_ID);
+      llvm::DenseMap<uint64_t, NodeID> oldNodesByKey;
+      for (NodeID id = 0; id < base.getNumNodes(); id++) {
+        addKeyIndex(oldNodesByKey, base.getNodeKey(id), id);
+      }
+      dirty = std::make_unique<DirtyNodes>(base);
+      for (NodeID id = 0; id < base.getNumNodes(); id++) {
+        if (lookupKey(oldNodesByKey, base.getNodeKey(id)) == id) {
+          oldToNew[id] = lookupKey(nodesByKey, base.getNodeKey(id));
+        }
+        if (oldToNew[id] == INVALID_NODE_ID) {
+          dirty->mark(id);
+        }
+      }
+
+      // the constraints of the base results that are not in the graph any more, an unchanged function constructs
+      // the same constraints between its own nodes
+      auto const baseEdges = base.getEdges();
+      for (size_t i = 0; i < baseEdges.size(); i++) {
+        auto const &edge = baseEdges[i];
+        if (i < base.getNumConstructedEdges() && isUnchanged(edge.src) && isUnchanged(edge.dst)) continue;
+        NodeID src = oldToNew[edge.src], dst = oldToNew[edge.dst];
+        if (edge.via != PersistedResults::NONE || src == INVALID_NODE_ID || dst == INVALID_NODE_ID) continue;
+        auto constraint = static_cast<Constraints>(static_cast<uint32_t>(edge.constraint));
+        if (!consGraph->getCGNode(src)->hasConstraint(consGraph->getCGNode(dst), constraint)) {
+          dirty->retract(edge);
+        }
+      }
+      dirty->propagate();
+
+      bool rebuild = false;
+      for (size_t i = 0; i < events.size(); i++) {
+        if (funPtrs[i] != INVALID_NODE_ID &&
+            (dirty->isDirty(events[i].node) || oldToNew[events[i].node] != funPtrs[i])) {
+          dropped[i] = true;
+          rebuild = true;
+        }
+      }
+      if (!rebuild) {
+        return oldToNew;
+      }
+      rebuildConsGraph(hooks);
+    }
+  }
+
+  // Solve starting from the results of another revision of the module, see setIncremental.
+  // Returns false if there are no results to start from, leaving the graph as constructed.
+  bool solveFromBaseResults(const Hooks &hooks) {
+    auto base = findBaseResults(getStructuralKeys().getLayoutHash());
+    if (base == nullptr) {
+      return false;
+    }
+
+    std::unique_ptr<DirtyNodes> dirty;
+    auto oldToNew = replayBaseResults(*base, hooks, dirty);
+
+    // the object ids of the base results in the graph
+    std::vector<NodeID> objects(base->getObjects().size(), INVALID_NODE_ID);
+    for (NodeID obj = 0; obj < objects.size(); obj++) {
+      NodeID node = oldToNew[base->getObjects()[obj].nodeID];
+      if (node != INVALID_NODE_ID) {
+        objects[obj] = llvm::cast<ObjNodeTy>(consGraph->getCGNode(node))->getObjectID();
+      }
+    }
+
+    // the pts of the clean nodes are part of their final pts, and the solver starts from there
+    llvm::BitVector seeded(consGraph->getNodeNum());
+    for (NodeID id = 0; id < oldToNew.size(); id++) {
+      NodeID node = oldToNew[id];
+      if (node == INVALID_NODE_ID || dirty->isDirty(id)) continue;
+      for (NodeID obj : base->getPointsTo(id)) {
+        if (objects[obj] != INVALID_NODE_ID) {
+          PT::insert(node, objects[obj]);
+        }
+      }
+      seeded.set(node);
+    }
+    numReusedNodes = seeded.count();
+    LOG_INFO("Pointer Analysis reusing the pts of {} of {} nodes", numReusedNodes, consGraph->getNodeNum());
+
+    hooks.solveIncremental(seeded);
+    if (hooks.stoppedEarly()) {
+      return true;
+    }
+
+    // the replayed call resolutions ignore the limit of targets, which makes the resolutions depend on their order
+    // once a call site reaches it
+    auto callGraph = LMT::getCallGraph(langModel);
+    for (NodeID id = 0; id < callGraph->getNodeNum(); id++) {
+      auto callNode = callGraph->getNode(id);
+      if (callNode->isIndirectCall() &&
+          callNode->getTargetFunPtr()->getResolvedTarget().size() >= Max_Indirect_Target) {
+        LOG_INFO("Pointer Analysis indirect call reached the target limit, solving from scratch");
+        rebuildConsGraph(hooks);
+        numReusedNodes = 0;
+        snapshotEdges();
+        hooks.solve();
+        break;
+      }
+    }
+    return true;
+  }
+
+ public:
+  void setDirectory(std::string directory) { dir = std::move(directory); }
+  void setIncremental(bool enable) { incremental = enable; }
+
+  [[nodiscard]] bool isEnabled() const { return !dir.empty(); }
+  [[nodiscard]] bool isLoaded() const { return persisted != nullptr; }
+  [[nodiscard]] size_t getNumReusedNodes() const { return numReusedNodes; }
+
+  // the copies the special constraints add while solving are saved with the results, null if disabled
+  [[nodiscard]] std::vector<std::array<uint32_t, 4>> *getSpecialEdgeLog() {
+    return isEnabled() ? &specialEdges : nullptr;
+  }
+
+  // Called with the constructed graph of the module. Returns true if the results of an earlier run were loaded,
+  // otherwise the graph is solved, and the language model might have been built again through the hooks.
+  bool loadOrSolve(LangModel *model, const llvm::Module &module, llvm::StringRef entry, const Hooks &hooks) {
+    setLangModel(model);
+    numConstructedNodes = consGraph->getNodeNum();
+    structuralKeys = std::make_unique<StructuralKeys>(module, entry);
+    moduleHash = structuralKeys->getModuleHash();
+    // the events replayed before a mismatch stay in the graph, they have to be saved with the rest
+    LMT::setSolveLogging(langModel, true);
+    if (loadResults()) {
+      LMT::setSolveLogging(langModel, false);
+      LOG_INFO("Pointer Analysis loaded the results from {}", getResultsPath());
+      return true;
+    }
+    LOG_INFO("Pointer Analysis Starting to Solve");
+
+    // the results of another revision can only be used on the graph as constructed
+    bool untouched = LMT::getSolveLog(langModel).empty() && consGraph->getNodeNum() == numConstructedNodes;
+    if (!incremental || !untouched || !solveFromBaseResults(hooks)) {
+      snapshotEdges();
+      if (!untouched) {
+        // the events replayed before a mismatch are not part of the graph as constructed
+        numConstructedEdges = 0;
+      }
+      hooks.solve();
+    }
+    return false;
+  }
+
+  // keep the solved results for the later runs
+  void save() {
+    LMT::setSolveLogging(langModel, false);
+    saveResults();
+  }
+
+  // call fn with the sorted object ids of pts(node), which is a super node
+  template <typename Fn>
+  auto withPts(NodeID node, Fn fn) const {
+    if (persisted != nullptr && persisted->hasNode(node)) {
+      return fn(persisted->getPointsTo(node));
+    }
+    llvm::SmallVector<NodeID, 16> pts;
+    for (auto it = PT::begin(node), ie = PT::end(node); it != ie; it++) {
+      pts.push_back(*it);
+    }
+    return fn(llvm::makeArrayRef(pts));
+  }
+
+  // pts queries on two super nodes, served from the loaded results if there are
+  [[nodiscard]] bool intersectWithNoSpecialNode(NodeID n1, NodeID n2) const {
+    if (persisted == nullptr) {
+      return PT::intersectWithNoSpecialNode(n1, n2);
+    }
+    return withPts(n1, [&](auto const &pts1) {
+      return withPts(n2, [&](auto const &pts2) { return intersectsNoSpecialNode(pts1, pts2); });
+    });
+  }
+
+  [[nodiscard]] bool equal(NodeID n1, NodeID n2) const {
+    if (persisted == nullptr) {
+      return PT::equal(n1, n2);
+    }
+    return withPts(n1, [&](auto const &pts1) {
+      return withPts(n2, [&](auto const &pts2) { return equalPts(pts1, pts2); });
+    });
+  }
+
+  [[nodiscard]] bool contains(NodeID n1, NodeID n2) const {
+    if (persisted == nullptr) {
+      return PT::contains(n1, n2);
+    }
+    return withPts(n1, [&](auto const &pts1) {
+      return withPts(n2, [&](auto const &pts2) { return containsPts(pts1, pts2); });
+    });
+  }
+
+  // drop the results of the last run, keeping the settings
+  void reset() {
+    persisted.reset();
+    langModel = nullptr;
+    consGraph = nullptr;
+    numReusedNodes = 0;
+    structuralKeys.reset();
+    contextKeys.clear();
+    graphEdges.clear();
+    specialEdges.clear();
+    numConstructedEdges = 0;
+  }
+};
+
+}  // namespace pta
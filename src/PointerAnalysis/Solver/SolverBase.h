@@ -15,15 +15,24 @@ limitations under the License.
 
 #define DEBUG_TYPE "pta"
 
+#include <llvm/ADT/BitVector.h>
 #include <llvm/IR/Module.h>
 #include <llvm/Pass.h>
+#include <llvm/Support/FileSystem.h>
+
+#include <array>
+#include <functional>
 
 //#include "RDUtil.h"
 #include "Logging/Log.h"
 #include "PointerAnalysis/Graph/CallGraph.h"
 #include "PointerAnalysis/Graph/ConstraintGraph/ConstraintGraph.h"
 #include "PointerAnalysis/Models/MemoryModel/MemModelTrait.h"
+#include "PointerAnalysis/Program/Object.h"
+#include "PointerAnalysis/Solver/DemandDriven.h"
 #include "PointerAnalysis/Solver/PointsTo/BitVectorPTS.h"
+#include "PointerAnalysis/Solver/ResultsCache.h"
+#include "PointerAnalysis/Util/ScopedInstance.h"
 
 extern llvm::cl::opt<bool> ConfigPrintConstraintGraph;
 extern llvm::cl::opt<bool> ConfigPrintCallGraph;
@@ -64,8 +73,100 @@ class SolverBase {
   ConsGraphTy *consGraph;
   llvm::SparseBitVector<> updatedFunPtrs;
 
+ public:
+  // The state the static traits keep for this analysis
+  struct AnalysisState {
+    typename PT::Storage pointsTo;
+    typename CT::Storage contexts;
+    ObjectIDCounter objectIDs;
+  };
+
+  // Makes this analysis the one used by the static traits on the calling thread, until the scope is destroyed
+  class Scope {
+    typename ScopedInstance<typename PT::Storage>::Scope pointsTo;
+    typename CT::Scope contexts;
+    ScopedInstance<ObjectIDCounter>::Scope objectIDs;
+
+   public:
+    explicit Scope(AnalysisState &state)
+        : pointsTo(state.pointsTo), contexts(state.contexts), objectIDs(state.objectIDs) {}
+  };
+
+  // Everything touching the points-to sets, contexts or objects of this analysis needs to be in its scope.
+  // The public queries below enter it themselves.
+  [[nodiscard]] Scope enterScope() const { return Scope(*state); }
+
+ private:
+  std::unique_ptr<AnalysisState> state = std::make_unique<AnalysisState>();
+
+ protected:
+
+  // Called between solver iterations with the current number of constraint graph nodes.
+  // Returning true stops the analysis early, leaving the points-to sets incomplete.
+  std::function<bool(size_t)> budgetCheck;
+  bool stoppedEarly = false;
+
+  // return true if the analysis should stop because it is over budget
+  inline bool checkBudget() {
+    if (!stoppedEarly && budgetCheck && budgetCheck(consGraph->getNodeNum())) {
+      stoppedEarly = true;
+    }
+    return stoppedEarly;
+  }
+
+  // Demand-driven mode, see setDemandDriven. Mutable as the const queries compute the points-to sets they read.
+  mutable DemandDrivenMode<LangModel> demandDriven;
+
+  // leave demand-driven mode and compute every points-to set
+  void solveWholeProgram() {
+    LOG_INFO("Pointer Analysis demand-driven query failed, solving the whole program. queries={}, failed={}",
+             demandDriven.getNumQueries(), demandDriven.getNumFailedQueries());
+    // the pts of the function pointers might be already complete, so the solver would not see them change
+    for (NodeID id = 0; id < consGraph->getNodeNum(); id++) {
+      if (consGraph->getCGNode(id)->isFunctionPtr() && !PT::isEmpty(id)) {
+        updateFunPtr(id);
+      }
+    }
+    static_cast<SubClass *>(this)->solve();
+    // the queries look up super nodes from many threads, which must not compress the paths concurrently
+    consGraph->flattenSuperNodes();
+    demandDriven.stop();
+  }
+
+  // Results persisted across runs, see setResultsCache
+  ResultsCache<LangModel> resultsCache;
+
+  // Solve with the pts of the seeded nodes taken from another revision of the module.
+  // Subclasses can skip the work already done for the seeded nodes, see PartialUpdateSolver.
+  void solveIncremental(const llvm::BitVector & /* seeded */) { static_cast<SubClass *>(this)->solve(); }
+
+  // drop the solver state, and construct the constraint graph of the module from scratch
+  LangModel *constructConsGraph(llvm::Module *module, llvm::StringRef entry) {
+    clearSolverState();
+    langModel.reset();
+    PT::clearAll();
+
+    langModel.reset(LMT::buildInitModel(module, entry));
+    LMT::constructConsGraph(langModel.get());
+    consGraph = LMT::getConsGraph(langModel.get());
+    return langModel.get();
+  }
+
+  // drop what the solver derived from the constraint graph
+  void clearSolverState() {
+    static_cast<SubClass *>(this)->resetSolver();
+    handledGEPMap.clear();
+    handledSpecialMap.clear();
+    updatedFunPtrs.clear();
+  }
+
+  // Hook for subclasses to drop their own solver state in reset()
+  void resetSolver() {}
+
   // TODO: the intersection on pts should be done through PtsTrait for better extensibility
   llvm::DenseMap<PtrNodeTy *, PtsTy> handledGEPMap;
+  // the objects already handled on each special (src, dst) edge
+  llvm::DenseMap<std::pair<NodeID, NodeID>, PtsTy> handledSpecialMap;
 
   inline void updateFunPtr(NodeID indirectNode) { updatedFunPtrs.set(indirectNode); }
 
@@ -74,7 +175,10 @@ class SolverBase {
       return false;
     }
 
+    // the constraints of the resolved calls are part of the program, they are saved with the results
+    consGraph->setEdgeLogging(resultsCache.isEnabled());
     bool reanalyze = LMT::updateFunPtrs(langModel.get(), updatedFunPtrs);
+    consGraph->setEdgeLogging(false);
     updatedFunPtrs.clear();
 
     return reanalyze;
@@ -84,7 +188,6 @@ class SolverBase {
   constexpr inline bool processAddrOf(CGNodeTy *src, CGNodeTy *dst) const;
   inline bool processCopy(CGNodeTy *src, CGNodeTy *dst);
 
-  // TODO: only process diff pts
   template <typename CallBack = Noop>
   inline bool processOffset(CGNodeTy *src, CGNodeTy *dst, CallBack callBack = Noop{}) {
     assert(!src->hasSuperNode() && !dst->hasSuperNode());
@@ -130,7 +233,10 @@ class SolverBase {
     // update the cached pts
     for (auto objNode : nodeVec) {
       // this might create new object, thus modify the points-to set
+      bool logging = consGraph->isEdgeLogging();
+      consGraph->setEdgeLogging(resultsCache.isEnabled());
       auto *fieldObj = llvm::cast_or_null<ObjNodeTy>(LMT::indexObject(this->getLangModel(), objNode, idx));
+      consGraph->setEdgeLogging(logging);
       if (fieldObj == nullptr) {
         continue;
       }
@@ -156,10 +262,16 @@ class SolverBase {
   //     node --COPY--> dst
   template <typename CallBack = Noop>
   bool processLoad(CGNodeTy *src, CGNodeTy *dst, CallBack callBack = Noop{}) {
+    return processLoadDiff(src, dst, PT::getPointsTo(src->getNodeID()), callBack);
+  }
+
+  // same as processLoad, but only for the nodes in diff, which is a subset of pts(src)
+  template <typename CallBack = Noop>
+  bool processLoadDiff(CGNodeTy *src, CGNodeTy *dst, const PtsTy &diff, CallBack callBack = Noop{}) {
     assert(!src->hasSuperNode() && !dst->hasSuperNode());
 
     bool changed = false;
-    for (auto it = PT::begin(src->getNodeID()), ie = PT::end(src->getNodeID()); it != ie; it++) {
+    for (auto it = diff.begin(), ie = diff.end(); it != ie; it++) {
       auto node = consGraph->getObjectNode(*it);
       node = node->getSuperNode();
       if (consGraph->addConstraints(node, dst, Constraints::copy)) {
@@ -173,42 +285,62 @@ class SolverBase {
 
   template <typename CallBack = Noop>
   bool processSpecial(CGNodeTy *src, CGNodeTy *dst, CallBack callBack = Noop{}) {
-    // TODO: we should do a cache here as well! as handling special constraints
-    // are expensive
     assert(!src->hasSuperNode() && !dst->hasSuperNode());
 
+    // handling special constraints is expensive, and an object gives the same constraints every time it is
+    // handled on the same edge. So only handle the objects added to pts(src) since the edge was last handled.
+    PtsTy &handled = handledSpecialMap.try_emplace(std::make_pair(src->getNodeID(), dst->getNodeID())).first->second;
+    PtsTy newObjs;
+    newObjs.intersectWithComplement(PT::getPointsTo(src->getNodeID()), handled);
+    if (newObjs.empty()) {
+      return false;
+    }
+    handled |= newObjs;
+
     struct OnNewConstraints : public ConsGraphTy::OnNewConstraintCallBack {
       CallBack &CB;
+      // the copies are saved with the results, as they depend on the special constraint
+      std::vector<std::array<uint32_t, 4>> *derived;
+      NodeID via;
       virtual ~OnNewConstraints() {}
-      explicit OnNewConstraints(CallBack &CB) : CB(CB) {}
+      OnNewConstraints(CallBack &CB, std::vector<std::array<uint32_t, 4>> *derived, NodeID via)
+          : CB(CB), derived(derived), via(via) {}
 
       void onNewConstraint(CGNodeTy *src, CGNodeTy *dst, Constraints constraint) override {
         assert(constraint == Constraints::copy && "special constraints can only add new copy/addr_of constraints");
+        if (derived != nullptr) {
+          derived->push_back({src->getNodeID(), dst->getNodeID(), static_cast<uint32_t>(constraint), via});
+        }
         CB(src, dst);
       }
     };
 
-    OnNewConstraints cb(callBack);
+    OnNewConstraints cb(callBack, resultsCache.getSpecialEdgeLog(), src->getNodeID());
     bool changed = false;
     this->consGraph->registerCallBack(&cb);
-    for (auto it = PT::begin(src->getNodeID()), ie = PT::end(src->getNodeID()); it != ie; it++) {
+    for (auto it = newObjs.begin(), ie = newObjs.end(); it != ie; it++) {
       auto node = llvm::cast<ObjNodeTy>(consGraph->getObjectNode(*it));
-      changed = node->getObject()->processSpecial(src, dst);
+      changed |= node->getObject()->processSpecial(src, dst);
     }
     this->consGraph->unregisterCallBack();
     return changed;
   }
 
-  // TODO: only process diff pts
   // src --STORE-->dst
   // for every node in pts(dst):
   //      src --COPY--> node
   template <typename CallBack = Noop>
   bool processStore(CGNodeTy *src, CGNodeTy *dst, CallBack callBack = Noop{}) {
+    return processStoreDiff(src, dst, PT::getPointsTo(dst->getNodeID()), callBack);
+  }
+
+  // same as processStore, but only for the nodes in diff, which is a subset of pts(dst)
+  template <typename CallBack = Noop>
+  bool processStoreDiff(CGNodeTy *src, CGNodeTy *dst, const PtsTy &diff, CallBack callBack = Noop{}) {
     assert(!src->hasSuperNode() && !dst->hasSuperNode());
 
     bool changed = false;
-    for (auto it = PT::begin(dst->getNodeID()), ie = PT::end(dst->getNodeID()); it != ie; it++) {
+    for (auto it = diff.begin(), ie = diff.end(); it != ie; it++) {
       // auto tmp = llvm::dyn_cast<ObjNodeTy>(consGraph->getCGNode(*it));
       auto node = consGraph->getObjectNode(*it);
       node = node->getSuperNode();
@@ -227,6 +359,7 @@ class SolverBase {
     // from here
     do {
       static_cast<SubClass *>(this)->runSolver(*langModel);
+      if (checkBudget()) return;
       // resolve indirect calls in language model
       reanalyze = resolveFunPtrs();
     } while (reanalyze);
@@ -280,25 +413,54 @@ class SolverBase {
 
  public:
   // analyze the give module with specified entry function
-  bool analyze(llvm::Module *module, llvm::StringRef entry) {
+  // onPhase is called with the name of each stage of the analysis ("pta-construction", "pta-solve") as it starts
+  template <typename PhaseCallBack = Noop>
+  bool analyze(llvm::Module *module, llvm::StringRef entry, PhaseCallBack onPhase = Noop{}) {
     assert(langModel == nullptr && "can not run pointer analysis twice");
-    // ensure the points to set are cleaned.
-    // TODO: support different point-to set instance for different PTA instance
-    // new they all share a global vector to store it.
-    PT::clearAll();
+    auto const scope = enterScope();
 
+    onPhase("pta-construction");
     // using language model to construct language model
-    langModel.reset(LMT::buildInitModel(module, entry));
-    LMT::constructConsGraph(langModel.get());
-
-    consGraph = LMT::getConsGraph(langModel.get());
-
-    LOG_INFO("Pointer Analysis Starting to Solve");
-
-    // subclass might override solve() directly for more aggressive overriding
-    static_cast<SubClass *>(this)->solve();
+    constructConsGraph(module, entry);
+    if (checkBudget()) return false;
+
+    onPhase("pta-solve");
+    if (resultsCache.isEnabled()) {
+      typename ResultsCache<LangModel>::Hooks hooks{
+          [this, module, entry] { return constructConsGraph(module, entry); },
+          [this] { static_cast<SubClass *>(this)->solve(); },
+          [this](const llvm::BitVector &seeded) { static_cast<SubClass *>(this)->solveIncremental(seeded); },
+          [this] { return stoppedEarly; }};
+      if (resultsCache.loadOrSolve(langModel.get(), *module, entry, hooks)) {
+        return false;
+      }
+      // the queries look up super nodes from many threads, which must not compress the paths concurrently
+      consGraph->flattenSuperNodes();
+    } else if (demandDriven.isEnabled() && !ConfigDumpPointsToSet) {
+      // dumping the points-to sets needs all of them
+      LOG_INFO("Pointer Analysis Starting to Solve");
+      auto special = [this](CGNodeTy *src, CGNodeTy *dst) { return processSpecial(src, dst); };
+      if (demandDriven.start(langModel.get(), special, [this] { return checkBudget(); })) {
+        // analyze() has returned when a query fails, there is nothing left to fall back to
+        demandDriven.setFallback([this] {
+          budgetCheck = nullptr;
+          solveWholeProgram();
+        });
+      } else {
+        solveWholeProgram();
+      }
+    } else {
+      LOG_INFO("Pointer Analysis Starting to Solve");
+      // subclass might override solve() directly for more aggressive overriding
+      static_cast<SubClass *>(this)->solve();
+      consGraph->flattenSuperNodes();
+    }
+    if (stoppedEarly) return false;
 
     LOG_INFO("Pointer Analysis Finished Solving");
+    if (resultsCache.isEnabled()) {
+      resultsCache.save();
+    }
 
     LOG_DEBUG("PTA constraint graph node number {}, callgraph node number {}", this->getConsGraph()->getNodeNum(),
               this->getCallGraph()->getNodeNum());
@@ -331,6 +493,8 @@ class SolverBase {
   std::map<std::string, ObjNodeTy *> lockStrObjects;
   void getPointsToForSpecialLockPtr(const ctx *context, const llvm::Instruction *I, std::string lockStr,
                                     const llvm::Value *lockPtr, std::vector<const ObjTy *> &result) {
+    auto const scope = enterScope();
+    auto const lock = demandDriven.lock();
     // create annonymous object if it does not exist
     if (lockStrObjects.find(lockStr) == lockStrObjects.end()) {
       auto objNode = LMT::allocSpecialAnonObj(langModel.get(), I, lockPtr);
@@ -340,6 +504,8 @@ class SolverBase {
   }
 
   void getPointsTo(const ctx *context, const llvm::Value *V, std::multiset<const ObjTy *> &result) const {
+    auto const scope = enterScope();
+    auto const lock = demandDriven.lock();
     assert(V->getType()->isPointerTy());
 
     // get the node value
@@ -347,18 +513,23 @@ class SolverBase {
     if (node == INVALID_NODE_ID) {
       return;
     }
-
-    for (auto it = PT::begin(node), ie = PT::end(node); it != ie; it++) {
-      auto objNode = llvm::dyn_cast<ObjNodeTy>(consGraph->getObjectNode(*it));
-      assert(objNode);
-      if (objNode->isSpecialNode()) {
-        continue;
+    demandDriven.query(consGraph, node);
+
+    resultsCache.withPts(node, [&](auto const &pts) {
+      for (NodeID obj : pts) {
+        auto objNode = llvm::dyn_cast<ObjNodeTy>(consGraph->getObjectNode(obj));
+        assert(objNode);
+        if (objNode->isSpecialNode()) {
+          continue;
+        }
+        result.insert(objNode->getObject());
       }
-      result.insert(objNode->getObject());
-    }
+    });
   }
 
   void getFSPointsTo(const ctx *context, const llvm::Value *V, std::vector<const ObjTy *> &result) const {
+    auto const scope = enterScope();
+    auto const lock = demandDriven.lock();
     assert(V->getType()->isPointerTy());
 
     // get the node value
@@ -366,15 +537,18 @@ class SolverBase {
     if (node == INVALID_NODE_ID) {
       return;
     }
-
-    for (auto it = PT::begin(node), ie = PT::end(node); it != ie; it++) {
-      auto objNode = llvm::dyn_cast<ObjNodeTy>(consGraph->getObjectNode(*it));
-      assert(objNode);
-      if (objNode->isSpecialNode() || objNode->isFIObject()) {
-        continue;
+    demandDriven.query(consGraph, node);
+
+    resultsCache.withPts(node, [&](auto const &pts) {
+      for (NodeID obj : pts) {
+        auto objNode = llvm::dyn_cast<ObjNodeTy>(consGraph->getObjectNode(obj));
+        assert(objNode);
+        if (objNode->isSpecialNode() || objNode->isFIObject()) {
+          continue;
+        }
+        result.push_back(objNode->getObject());
       }
-      result.push_back(objNode->getObject());
-    }
+    });
   }
 
   const llvm::Type *getPointedType(const ctx *context, const llvm::Value *V) const {
@@ -402,16 +576,21 @@ class SolverBase {
   }
 
   [[nodiscard]] bool alias(const ctx *c1, const llvm::Value *v1, const ctx *c2, const llvm::Value *v2) const {
+    auto const scope = enterScope();
+    auto const lock = demandDriven.lock();
     assert(v1->getType()->isPointerTy() && v2->getType()->isPointerTy());
 
     NodeID n1 = LMT::getSuperNodeIDForValue(langModel.get(), c1, v1);
     NodeID n2 = LMT::getSuperNodeIDForValue(langModel.get(), c2, v2);
 
     assert(n1 != INVALID_NODE_ID && n2 != INVALID_NODE_ID && "can not find node in constraint graph!");
-    return PT::intersectWithNoSpecialNode(n1, n2);
+    demandDriven.query(consGraph, n1, n2);
+    return resultsCache.intersectWithNoSpecialNode(n1, n2);
   }
 
   [[nodiscard]] bool aliasIfExsit(const ctx *c1, const llvm::Value *v1, const ctx *c2, const llvm::Value *v2) const {
+    auto const scope = enterScope();
+    auto const lock = demandDriven.lock();
     assert(v1->getType()->isPointerTy() && v2->getType()->isPointerTy());
 
     NodeID n1 = LMT::getSuperNodeIDForValue(langModel.get(), c1, v1);
@@ -420,27 +599,75 @@ class SolverBase {
     if (n1 == INVALID_NODE_ID || n2 == INVALID_NODE_ID) {
       return false;
     }
-    return PT::intersectWithNoSpecialNode(n1, n2);
+    demandDriven.query(consGraph, n1, n2);
+    return resultsCache.intersectWithNoSpecialNode(n1, n2);
   }
 
   [[nodiscard]] bool hasIdenticalPTS(const ctx *c1, const llvm::Value *v1, const ctx *c2, const llvm::Value *v2) const {
+    auto const scope = enterScope();
+    auto const lock = demandDriven.lock();
     assert(v1->getType()->isPointerTy() && v2->getType()->isPointerTy());
 
     NodeID n1 = LMT::getSuperNodeIDForValue(langModel.get(), c1, v1);
     NodeID n2 = LMT::getSuperNodeIDForValue(langModel.get(), c2, v2);
 
     assert(n1 != INVALID_NODE_ID && n2 != INVALID_NODE_ID && "can not find node in constraint graph!");
-    return PT::equal(n1, n2);
+    demandDriven.query(consGraph, n1, n2);
+    return resultsCache.equal(n1, n2);
   }
 
   [[nodiscard]] bool containsPTS(const ctx *c1, const llvm::Value *v1, const ctx *c2, const llvm::Value *v2) const {
+    auto const scope = enterScope();
+    auto const lock = demandDriven.lock();
     assert(v1->getType()->isPointerTy() && v2->getType()->isPointerTy());
 
     NodeID n1 = LMT::getSuperNodeIDForValue(langModel.get(), c1, v1);
     NodeID n2 = LMT::getSuperNodeIDForValue(langModel.get(), c2, v2);
 
     assert(n1 != INVALID_NODE_ID && n2 != INVALID_NODE_ID && "can not find node in constraint graph!");
-    return PT::contains(n1, n2);
+    demandDriven.query(consGraph, n1, n2);
+    return resultsCache.contains(n1, n2);
+  }
+
+  // Set a check that is polled while analyzing, see budgetCheck
+  void setBudgetCheck(std::function<bool(size_t)> check) { budgetCheck = std::move(check); }
+
+  // Compute the points-to sets on demand when they are queried, instead of solving the whole program in analyze().
+  // A query that needs to visit more than queryBudget nodes solves the whole program instead. 0 disables it.
+  void setDemandDriven(size_t queryBudget) { demandDriven.setBudget(queryBudget); }
+
+  // Keep the solved results in the directory dir, keyed by the hash of the module.
+  // analyze() then loads the results of an earlier run on the same module instead of solving, or saves its own.
+  // An empty dir disables it.
+  void setResultsCache(std::string dir) { resultsCache.setDirectory(std::move(dir)); }
+
+  // return true if the points-to sets are served from results saved by an earlier run
+  [[nodiscard]] bool isLoadedFromCache() const { return resultsCache.isLoaded(); }
+
+  // When there are no saved results for the module, start from the newest results in the cache that were computed on
+  // another revision of it. Only the pts that depend on what changed are solved again, the results are the same as
+  // solving from scratch. Needs setResultsCache.
+  void setIncremental(bool enable) { resultsCache.setIncremental(enable); }
+
+  // Number of nodes whose pts were taken from another revision of the module by the last analyze()
+  [[nodiscard]] size_t getNumReusedNodes() const { return resultsCache.getNumReusedNodes(); }
+
+  // return true if the points-to sets are still computed on demand
+  [[nodiscard]] bool isDemandDriven() const { return demandDriven.isActive(); }
+
+  // return true if the last analyze() was stopped early by the budget check
+  [[nodiscard]] bool isStoppedEarly() const { return stoppedEarly; }
+
+  // Drop the results of a previous analyze() so that analyze() can run again
+  void reset() {
+    clearSolverState();
+    demandDriven.reset();
+    resultsCache.reset();
+    stoppedEarly = false;
+    consGraph = nullptr;
+    langModel.reset();
+    auto const scope = enterScope();
+    CT::release();
   }
 
   // Delegator of the language model
@@ -453,6 +680,8 @@ class SolverBase {
   [[nodiscard]] inline const llvm::Module *getLLVMModule() const { return LMT::getLLVMModule(this->getLangModel()); }
 
   [[nodiscard]] inline const CallGraphNode<ctx> *getDirectNode(const ctx *C, const llvm::Function *F) {
+    auto const scope = enterScope();
+    auto const lock = demandDriven.lock();
     return LMT::getDirectNode(this->getLangModel(), C, F);
   }
 
@@ -0,0 +1,161 @@
+/* Copyright 2021 Coderrect Inc. All Rights Reserved.
+Licensed under the GNU Affero General Public License, version 3 or later (“AGPL”), as published by the Free Software
+Foundation. You may not use this file except in compliance with the License. You may obtain a copy of the License at
+https://www.gnu.org/licenses/agpl-3.0.en.html
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an “AS IS” BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <llvm/ADT/BitVector.h>
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "PointerAnalysis/Graph/NodeID.def"
+
+namespace pta {
+
+// The order in which a WorkList hands out its pending nodes
+enum class WorkListOrder {
+  NodeID,       // ascending node id
+  FIFO,         // the order the nodes were added in
+  LRF,          // least recently fired first
+  Topological,  // ascending priority (see WorkList::setPriority), nodes without one go last
+};
+
+// Worklist of constraint graph nodes.
+// A membership bitmap answers contains() in O(1), and the pending nodes are also kept in a compact vector,
+// so draining or clearing the worklist only costs the number of pending nodes instead of the graph size.
+class WorkList {
+ public:
+  explicit WorkList(WorkListOrder order = WorkListOrder::NodeID) : order(order) {}
+
+  [[nodiscard]] WorkListOrder getOrder() const { return order; }
+
+  void setOrder(WorkListOrder newOrder) {
+    order = newOrder;
+    resizeOrderState();
+  }
+
+  // allow node ids up to nodeNum, never shrinks
+  void resize(size_t nodeNum) {
+    if (nodeNum > inList.size()) {
+      inList.resize(nodeNum, false);
+      resizeOrderState();
+    }
+  }
+
+  // number of node ids the worklist can hold
+  [[nodiscard]] size_t getNodeNum() const { return inList.size(); }
+
+  [[nodiscard]] bool contains(NodeID id) const { return id < inList.size() && inList.test(id); }
+
+  // returns false if the node is already pending
+  bool push(NodeID id) {
+    assert(id < inList.size());
+    if (inList.test(id)) {
+      return false;
+    }
+    inList.set(id);
+    pending.push_back(id);
+    return true;
+  }
+
+  // push every node in [begin, end)
+  void pushRange(NodeID begin, NodeID end) {
+    for (NodeID id = begin; id < end; id++) {
+      push(id);
+    }
+  }
+
+  [[nodiscard]] bool empty() const { return pending.empty(); }
+  [[nodiscard]] size_t size() const { return pending.size(); }
+
+  // the pending nodes in the worklist order, the worklist is not changed
+  [[nodiscard]] std::vector<NodeID> getOrdered() const {
+    std::vector<NodeID> nodes = pending;
+    switch (order) {
+      case WorkListOrder::NodeID:
+        std::sort(nodes.begin(), nodes.end());
+        break;
+      case WorkListOrder::FIFO:
+        break;
+      case WorkListOrder::LRF:
+        std::sort(nodes.begin(), nodes.end(), [&](NodeID lhs, NodeID rhs) {
+          return std::make_pair(lastFired[lhs], lhs) < std::make_pair(lastFired[rhs], rhs);
+        });
+        break;
+      case WorkListOrder::Topological:
+        std::sort(nodes.begin(), nodes.end(), [&](NodeID lhs, NodeID rhs) {
+          return std::make_pair(priority[lhs], lhs) < std::make_pair(priority[rhs], rhs);
+        });
+        break;
+    }
+    return nodes;
+  }
+
+  // remove and return the pending nodes in the worklist order
+  std::vector<NodeID> take() {
+    std::vector<NodeID> nodes = getOrdered();
+    if (order == WorkListOrder::LRF) {
+      fireCount++;
+      for (NodeID id : nodes) {
+        lastFired[id] = fireCount;
+      }
+    }
+    clear();
+    return nodes;
+  }
+
+  // remove all pending nodes
+  void clear() {
+    for (NodeID id : pending) {
+      inList.reset(id);
+    }
+    pending.clear();
+  }
+
+  // smaller priorities are handed out first in the Topological order
+  void setPriority(NodeID id, uint32_t p) {
+    assert(order == WorkListOrder::Topological && id < priority.size());
+    priority[id] = p;
+  }
+
+  // forget every node, including the firing history and the priorities
+  void reset() {
+    inList.clear();
+    pending.clear();
+    lastFired.clear();
+    priority.clear();
+    fireCount = 0;
+  }
+
+ private:
+  void resizeOrderState() {
+    if (order == WorkListOrder::LRF) {
+      lastFired.resize(inList.size(), 0);
+    } else if (order == WorkListOrder::Topological) {
+      priority.resize(inList.size(), std::numeric_limits<uint32_t>::max());
+    }
+  }
+
+  WorkListOrder order;
+  llvm::BitVector inList;
+  std::vector<NodeID> pending;
+
+  // LRF: the take() that last handed out the node, 0 if never
+  std::vector<uint32_t> lastFired;
+  uint32_t fireCount = 0;
+  // Topological: the priority of every node
+  std::vector<uint32_t> priority;
+};
+
+}  // namespace pta
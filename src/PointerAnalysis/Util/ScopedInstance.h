@@ -0,0 +1,45 @@
+/* Copyright 2021 Coderrect Inc. All Rights Reserved.
+Licensed under the GNU Affero General Public License, version 3 or later (“AGPL”), as published by the Free Software
+Foundation. You may not use this file except in compliance with the License. You may obtain a copy of the License at
+https://www.gnu.org/licenses/agpl-3.0.en.html
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an “AS IS” BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <cassert>
+
+namespace pta {
+
+// State of a single pointer analysis that is reached through static traits (PTSTrait, CtxTrait, ...).
+// The state is owned by the analysis, and a Scope makes it the instance the traits use on the calling thread,
+// so several analyses can live in, and run concurrently on, different threads of one process.
+template <typename T>
+class ScopedInstance {
+  static inline thread_local T *current = nullptr;
+
+ public:
+  [[nodiscard]] static inline T &get() {
+    assert(current != nullptr && "no pointer analysis in scope on this thread");
+    return *current;
+  }
+
+  class Scope {
+    T *prev;
+
+   public:
+    explicit Scope(T &instance) : prev(current) { current = &instance; }
+    ~Scope() { current = prev; }
+
+    Scope(const Scope &) = delete;
+    Scope(Scope &&) = delete;
+    Scope &operator=(const Scope &) = delete;
+    Scope &operator=(Scope &&) = delete;
+  };
+};
+
+}  // namespace pta
@@ -218,8 +218,14 @@ class DICompositeTypeCollector {
     if (this->M == module) {
       return;
     }
-    // update the module
+    collect(module);
+  }
+
+  void collect(const Module *module) {
+    // the metadata of the previous module may have been freed with it
     this->M = module;
+    typeDIVec.clear();
+    typeDIMap.clear();
 
     // now collect all MD Nodes in the llvm::Module
     processModule();
@@ -346,7 +352,7 @@ class DICompositeTypeCollector {
   }
 };
 
-static DICompositeTypeCollector collector;
+static thread_local DICompositeTypeCollector collector;
 
 }  // namespace
 
@@ -379,7 +385,7 @@ DIType *stripArrayAndTypeDefDI(DIType *DI) {
   return DI;
 }
 
-void TypeMDinit(const llvm::Module *M) { collector.collectMDIfNeeded(M); }
+void TypeMDinit(const llvm::Module *M) { collector.collect(M); }
 
 // FIXME: is there any way that I can quickly get the type metadata with 100%
 // accuracy???
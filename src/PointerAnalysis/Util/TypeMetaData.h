@@ -30,6 +30,8 @@ llvm::DIType *stripTypeDefDI(llvm::DIType *DI);
 llvm::DIType *stripArrayDI(llvm::DIType *DI);
 llvm::DIType *stripArrayAndTypeDefDI(llvm::DIType *DI);
 
+// (Re)collect the type metadata of M. Called once per analysis, as M may have been allocated where an already freed
+// module used to be.
 void TypeMDinit(const llvm::Module *M);
 
 // only support looking up composite type, scalar type like int, float or
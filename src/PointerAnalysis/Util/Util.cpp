@@ -228,12 +228,8 @@ std::string pta::getDemangledName(StringRef mangledName) {
 
 // i8* is the void* in LLVM
 static bool isVoidPointer(const Type *T) {
-  static Type *VoidStarTy = nullptr;
-  if (VoidStarTy == nullptr) {
-    VoidStarTy = PointerType::getUnqual(IntegerType::get(T->getContext(), 8));
-  }
-
-  return VoidStarTy == T;
+  // not cached, types are uniqued per LLVMContext
+  return PointerType::getUnqual(IntegerType::get(T->getContext(), 8)) == T;
 }
 
 static bool isCompatibleType(const Type *T1, const Type *T2) {
@@ -11,6 +11,13 @@ limitations under the License.
 
 #include "RaceDetect.h"
 
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/ADT/Hashing.h>
+
+#include <atomic>
+#include <thread>
+
 #include "Analysis/HappensBeforeGraph.h"
 #include "Analysis/LockSet.h"
 #include "Analysis/OpenMPAnalysis.h"
@@ -18,13 +25,78 @@ limitations under the License.
 #include "Analysis/SimpleAlias.h"
 #include "Analysis/ThreadLocalAnalysis.h"
 #include "LanguageModel/RaceModel.h"
+#include "Statistics/Budget.h"
 #include "Statistics/Coverage.h"
+#include "Statistics/Stats.h"
 #include "Trace/ProgramTrace.h"
 
 using namespace race;
 
+namespace {
+// Memoizes the happens-before and lockset part of checkRace.
+// Both answers depend only on the sync segments and locksets of the two accesses, and on loop-heavy traces most
+// checked pairs repeat a combination that has already been decided.
+// Not thread safe: each worker owns its own cache.
+class SyncVerdictCache {
+  const race::HappensBeforeGraph &happensbefore;
+  const race::LockSet &lockset;
+
+  // (segment pair, lockset pair) -> areParallel && !sharesLock
+  llvm::DenseMap<std::pair<uint64_t, uint64_t>, bool> verdicts;
+
+ public:
+  SyncVerdictCache(const race::HappensBeforeGraph &happensbefore, const race::LockSet &lockset)
+      : happensbefore(happensbefore), lockset(lockset) {}
+
+  // return true if lhs and rhs are not ordered by happens-before and hold no common lock
+  [[nodiscard]] bool mayRace(const race::MemAccessEvent *lhs, const race::MemAccessEvent *rhs) {
+    auto lhsKey = std::make_pair(happensbefore.getSegmentID(lhs), lockset.getLockSetID(lhs));
+    auto rhsKey = std::make_pair(happensbefore.getSegmentID(rhs), lockset.getLockSetID(rhs));
+    // Both checks are symmetric, so (a, b) and (b, a) share an entry
+    if (rhsKey < lhsKey) std::swap(lhsKey, rhsKey);
+
+    auto const key = std::make_pair(static_cast<uint64_t>(lhsKey.first) << 32 | rhsKey.first,
+                                    static_cast<uint64_t>(lhsKey.second) << 32 | rhsKey.second);
+    auto [it, inserted] = verdicts.try_emplace(key, false);
+    if (inserted) {
+      it->second = happensbefore.areParallel(lhs, rhs) && !lockset.sharesLock(lhs, rhs);
+    }
+    return it->second;
+  }
+};
+
+// Number of access pairs on one object that the race-check loop may compare
+size_t countCandidatePairs(race::ThreadedReads threadedReads, race::ThreadedWrites threadedWrites) {
+  size_t count = 0;
+  for (size_t i = 0; i < threadedWrites.size(); ++i) {
+    auto const &[wtid, writes] = threadedWrites[i];
+    for (auto const &[rtid, reads] : threadedReads) {
+      if (wtid != rtid) count += writes.size() * reads.size();
+    }
+    for (auto const &[otid, otherWrites] : threadedWrites.drop_front(i + 1)) {
+      count += writes.size() * otherWrites.size();
+    }
+  }
+  return count;
+}
+
+// Keep one in every stride access pairs. The choice only depends on the pair, not on which worker checks it.
+bool isSampled(const race::MemAccessEvent *lhs, const race::MemAccessEvent *rhs, size_t stride) {
+  if (stride <= 1) return true;
+  auto const hash = llvm::hash_combine(lhs->getThread().id, lhs->getID(), rhs->getThread().id, rhs->getID());
+  return static_cast<size_t>(hash) % stride == 0;
+}
+}  // namespace
+
 Report race::detectRaces(llvm::Module *module, DetectRaceConfig config) {
-  race::ProgramTrace program(module);
+  race::Stats stats;
+  race::Budget budget(config.budget);
+  auto const beginPhase = [&stats, &budget](llvm::StringRef name) {
+    stats.beginPhase(name);
+    budget.beginPhase();
+  };
+
+  race::ProgramTrace program(module, "main", &stats, &budget);
 
   if (config.dumpPreprocessedIR.has_value()) {
     std::error_code err;
@@ -41,14 +113,16 @@ Report race::detectRaces(llvm::Module *module, DetectRaceConfig config) {
     llvm::outs() << program << "\n";
   }
 
+  beginPhase("shared-memory");
   race::SharedMemory sharedmem(program);
+  beginPhase("happens-before");
   race::HappensBeforeGraph happensbefore(program);
+  beginPhase("lockset");
   race::LockSet lockset(program);
-  race::SimpleAlias simpleAlias;
+  beginPhase("openmp-analysis");
   race::OpenMPAnalysis ompAnalysis(program);
   race::ThreadLocalAnalysis threadlocal;
-
-  race::Reporter reporter;
+  stats.endPhase();
 
   llvm::PassBuilder PB;
   llvm::FunctionAnalysisManager FAM;
@@ -58,7 +132,10 @@ Report race::detectRaces(llvm::Module *module, DetectRaceConfig config) {
   // FAM.registerPass([&] { return PB.buildDefaultAAPipeline(); });
 
   // Adds to report if race is detected between write and other
-  auto checkRace = [&](const race::WriteEvent *write, const race::MemAccessEvent *other) {
+  // Called concurrently by every worker, so all state it touches is either read-only (threadlocal),
+  // internally synchronized (ompAnalysis), or owned by the worker (syncVerdicts, simpleAlias, reporter)
+  auto checkRace = [&](const race::WriteEvent *write, const race::MemAccessEvent *other, SyncVerdictCache &syncVerdicts,
+                       race::SimpleAlias &simpleAlias, race::Reporter &reporter) {
     if (DEBUG_PTA) {
       llvm::outs() << "Checking Race: " << write->getID() << "(TID " << write->getThread().id << ") "
                    << "(line" << write->getIRInst()->getInst()->getDebugLoc().getLine()  // DRB149 crash on this line
@@ -70,7 +147,7 @@ Report race::detectRaces(llvm::Module *module, DetectRaceConfig config) {
       llvm::outs() << " (IR: " << *write->getInst() << "\n\t" << *other->getInst() << ")\n";
     }
 
-    if (!happensbefore.areParallel(write, other) || lockset.sharesLock(write, other)) {
+    if (!syncVerdicts.mayRace(write, other)) {
       return;
     }
 
@@ -116,34 +193,134 @@ Report race::detectRaces(llvm::Module *module, DetectRaceConfig config) {
     }
   };
 
-  for (auto const sharedObj : sharedmem.getSharedObjects()) {
-    auto threadedWrites = sharedmem.getThreadedWrites(sharedObj);
-    auto threadedReads = sharedmem.getThreadedReads(sharedObj);
-
-    for (auto it = threadedWrites.begin(), end = threadedWrites.end(); it != end; ++it) {
-      auto const wtid = it->first;
-      auto const writes = it->second;
-      // check Read/Write race
-      for (auto const &[rtid, reads] : threadedReads) {
-        if (wtid == rtid) continue;
-        for (auto write : writes) {
-          for (auto read : reads) {
-            checkRace(write, read);
-          }
+  // The race-pair loop is split into work items: one per (shared object, writing thread).
+  // Splitting on the writing thread keeps objects touched by many threads from serializing on one worker.
+  // The work items view SharedMemory's index directly, so no per-object copies are made.
+  struct WorkItem {
+    const pta::ObjTy *obj;
+    race::ThreadedReads threadedReads;
+    race::ThreadedWrites threadedWrites;
+    size_t writer;  // index into threadedWrites
+  };
+
+  beginPhase("race-check");
+  auto const sharedObjects = sharedmem.getSharedObjects();
+  stats.setCounter("shared-objects", sharedObjects.size());
+  llvm::DenseSet<const pta::ObjTy *> sharedObjectSet(sharedObjects.begin(), sharedObjects.end());
+  std::vector<WorkItem> workItems;
+  size_t candidatePairs = 0;
+  for (auto const sharedObj : sharedObjects) {
+    auto const threadedReads = sharedmem.getThreadedReads(sharedObj);
+    auto const threadedWrites = sharedmem.getThreadedWrites(sharedObj);
+    for (size_t i = 0; i < threadedWrites.size(); ++i) {
+      workItems.push_back({sharedObj, threadedReads, threadedWrites, i});
+    }
+    candidatePairs += countCandidatePairs(threadedReads, threadedWrites);
+  }
+
+  // Fallback: when there are more candidate pairs than the budget allows, only a sample of them is checked
+  size_t sampleStride = 1;
+  if (auto const maxPairs = config.budget.maxPairs; maxPairs.has_value() && candidatePairs > maxPairs.value()) {
+    sampleStride = (candidatePairs + maxPairs.value() - 1) / std::max<size_t>(maxPairs.value(), 1);
+    budget.recordFallback(std::to_string(candidatePairs) + " candidate access pairs over budget, checked 1 in " +
+                          std::to_string(sampleStride));
+  }
+
+  // Returns the number of access pairs checked.
+  // Thread pairs that can never run in parallel are skipped before looking at any of their events.
+  auto checkWorkItem = [&](const WorkItem &item, SyncVerdictCache &syncVerdicts, race::SimpleAlias &simpleAlias,
+                           race::Reporter &reporter) {
+    size_t pairsChecked = 0;
+    auto const &[wtid, writes] = item.threadedWrites[item.writer];
+    // check Read/Write race
+    for (auto const &[rtid, reads] : item.threadedReads) {
+      if (wtid == rtid || !happensbefore.threadsMayRunInParallel(wtid, rtid)) continue;
+      for (auto write : writes) {
+        for (auto read : reads) {
+          if (!isPairOwner(item.obj, write, read, sharedObjectSet) || !isSampled(write, read, sampleStride)) continue;
+          ++pairsChecked;
+          checkRace(write, read, syncVerdicts, simpleAlias, reporter);
         }
       }
+    }
 
-      // Check write/write
-      for (auto wit = std::next(it, 1); wit != end; ++wit) {
-        auto otherWrites = wit->second;
-        for (auto write : writes) {
-          for (auto otherWrite : otherWrites) {
-            checkRace(write, otherWrite);
+    // Check write/write
+    for (auto const &[otid, otherWrites] : item.threadedWrites.drop_front(item.writer + 1)) {
+      if (!happensbefore.threadsMayRunInParallel(wtid, otid)) continue;
+      for (auto write : writes) {
+        for (auto otherWrite : otherWrites) {
+          if (!isPairOwner(item.obj, write, otherWrite, sharedObjectSet) ||
+              !isSampled(write, otherWrite, sampleStride)) {
+            continue;
           }
+          ++pairsChecked;
+          checkRace(write, otherWrite, syncVerdicts, simpleAlias, reporter);
+        }
+      }
+    }
+    return pairsChecked;
+  };
+
+  // Races are streamed to a file as they are found, so partial results survive if the analysis is killed
+  std::unique_ptr<race::RaceStreamWriter> stream;
+  if (config.streamReport.has_value()) {
+    stream = std::make_unique<race::RaceStreamWriter>(config.streamReport.value());
+    if (!stream->good()) {
+      llvm::errs() << "Error opening race stream file!\n";
+      stream.reset();
+    }
+  }
+
+  // Each worker collects into its own reporter shard. Shards are merged once all workers finish.
+  // Report deduplicates and sorts races, so the final report does not depend on the number of workers.
+  auto const numWorkers = std::max(1u, std::min<unsigned int>(config.jobs, workItems.size()));
+  std::vector<race::Reporter> shards(numWorkers, race::Reporter(stream.get()));
+  std::atomic<size_t> nextItem{0};
+  std::atomic<size_t> pairsChecked{0};
+  std::atomic<bool> outOfTime{false};
+  auto runWorker = [&](race::Reporter &shard) {
+    SyncVerdictCache syncVerdicts(happensbefore, lockset);
+    race::SimpleAlias simpleAlias;
+    size_t workerPairs = 0;
+    for (auto i = nextItem++; i < workItems.size(); i = nextItem++) {
+      // Fallback: when the race check runs out of time or memory, the remaining work items are skipped
+      if (outOfTime || budget.phaseExceeded()) {
+        if (!outOfTime.exchange(true)) {
+          budget.recordFallback("race check over budget, skipped " + std::to_string(workItems.size() - i) + " of " +
+                                std::to_string(workItems.size()) + " work items");
         }
+        break;
       }
+      workerPairs += checkWorkItem(workItems[i], syncVerdicts, simpleAlias, shard);
     }
+    pairsChecked += workerPairs;
+  };
+
+  if (numWorkers == 1) {
+    runWorker(shards.front());
+  } else {
+    std::vector<std::thread> workers;
+    workers.reserve(numWorkers);
+    for (auto &shard : shards) {
+      workers.emplace_back(runWorker, std::ref(shard));
+    }
+    for (auto &worker : workers) {
+      worker.join();
+    }
+  }
+
+  race::Reporter reporter;
+  for (auto const &shard : shards) {
+    reporter.merge(shard);
+  }
+  if (stream) {
+    for (auto const &fallback : budget.getFallbacks()) {
+      stream->writeFallback(fallback);
+    }
+    stream->flush();
   }
+  stats.endPhase();
+  stats.setCounter("pairs-checked", pairsChecked);
 
   if (DEBUG_PTA) {
     happensbefore.debugDump(llvm::outs());
@@ -158,5 +335,13 @@ Report race::detectRaces(llvm::Module *module, DetectRaceConfig config) {
     llvm::outs() << coverage << "\n";
   }
 
-  return reporter.getReport();
+  auto report = reporter.getReport();
+  report.fallbacks = budget.getFallbacks();
+  stats.setCounter("races", report.size());
+
+  if (config.dumpStatsJSON.has_value()) {
+    stats.dumpJSON(config.dumpStatsJSON.value());
+  }
+
+  return report;
 }
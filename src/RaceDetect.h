@@ -12,6 +12,7 @@ limitations under the License.
 #pragma once
 
 #include "Reporter/Reporter.h"
+#include "Statistics/Budget.h"
 
 namespace race {
 
@@ -24,6 +25,20 @@ struct DetectRaceConfig {
 
   // Compute and print the coverage (= analyzed source code/all source code)
   bool doCoverage = false;
+
+  // Number of worker threads used to check shared objects for races
+  unsigned int jobs = 1;
+
+  // streams races to a file specified by the string as JSON Lines while races are being checked.
+  // Fallbacks taken are appended as {"fallback": ...} lines once checking is done.
+  std::optional<std::string> streamReport;
+
+  // writes per-phase timing, memory and counters as JSON to a file specified by the string
+  std::optional<std::string> dumpStatsJSON;
+
+  // Limits on time, memory and analysis size. When a limit is hit the analysis falls back to a less precise mode
+  // instead of running unbounded. Fallbacks taken are listed in Report::fallbacks.
+  BudgetLimits budget;
 };
 
 Report detectRaces(llvm::Module *module, DetectRaceConfig config = DetectRaceConfig());
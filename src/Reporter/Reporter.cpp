@@ -102,34 +102,77 @@ llvm::raw_ostream &race::operator<<(llvm::raw_ostream &os, const RaceAccess &acc
 
 void race::to_json(json &j, const Race &race) { j = json{{"access1", race.first}, {"access2", race.second}}; }
 
-Report::Report(const std::vector<std::pair<const WriteEvent *, const MemAccessEvent *>> &racepairs) {
-  size_t skipped = 0;
-  for (auto const &racepair : racepairs) {
-    Race race(racepair.first, racepair.second);
-    if (race.missingLocation()) {
-      skipped++;
-      continue;
-    }
-
-    races.insert(race);
+void Report::dumpReport(const std::string &path) const {
+  std::ofstream output(path, std::ofstream::out);
+  output << "{\"races\":[";
+  bool first = true;
+  for (auto const &race : races) {
+    if (!first) output << ",";
+    first = false;
+    output << json(race);
   }
-  if (skipped > 0) {
-    llvm::errs() << "skipped " << skipped << " races with unknown location\n";
+  output << "],\"fallbacks\":" << json(fallbacks) << "}";
+  output.close();
+}
+
+RaceStreamWriter::RaceStreamWriter(const std::string &path, size_t flushInterval)
+    : output(path, std::ofstream::out), flushInterval(flushInterval) {}
+
+RaceStreamWriter::~RaceStreamWriter() { flush(); }
+
+void RaceStreamWriter::write(const Race &race) {
+  if (race.missingLocation()) return;
+
+  // serialize outside of the lock
+  auto line = json(race).dump();
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto const [it, inserted] = written.insert(std::move(line));
+  if (!inserted) return;
+
+  output << *it << "\n";
+  if (++unflushed >= flushInterval) {
+    output.flush();
+    unflushed = 0;
   }
 }
 
-void Report::dumpReport(const std::string &path) const {
-  std::ofstream output(path, std::ofstream::out);
-  json reportJSON(races);
-  output << reportJSON;
-  output.close();
+void RaceStreamWriter::writeFallback(const std::string &fallback) {
+  auto line = json{{"fallback", fallback}}.dump();
+
+  std::lock_guard<std::mutex> lock(mutex);
+  output << line << "\n";
+}
+
+void RaceStreamWriter::flush() {
+  std::lock_guard<std::mutex> lock(mutex);
+  output.flush();
+  unflushed = 0;
 }
 
 void Reporter::collect(const WriteEvent *e1, const MemAccessEvent *e2) {
-  racepairs.emplace_back(std::make_pair(e1, e2));
+  Race race(e1, e2);
+  if (race.missingLocation()) {
+    skipped++;
+    return;
+  }
+
+  if (races.insert(race).second && stream != nullptr) {
+    stream->write(race);
+  }
+}
+
+void Reporter::merge(const Reporter &other) {
+  races.insert(other.races.begin(), other.races.end());
+  skipped += other.skipped;
 }
 
-Report Reporter::getReport() const { return Report(racepairs); }
+Report Reporter::getReport() const {
+  if (skipped > 0) {
+    llvm::errs() << "skipped " << skipped << " races with unknown location\n";
+  }
+  return Report(races);
+}
 
 llvm::raw_ostream &race::operator<<(llvm::raw_ostream &os, const Race &race) {
   os << race.first.location << " " << race.second.location << "\n\t" << *race.first.inst << "\n\t" << *race.second.inst;
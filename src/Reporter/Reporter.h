@@ -11,9 +11,12 @@ limitations under the License.
 
 #pragma once
 
+#include <fstream>
+#include <mutex>
 #include <nlohmann/json.hpp>
 #include <optional>
 #include <string>
+#include <unordered_set>
 
 #include "Trace/ProgramTrace.h"
 
@@ -100,20 +103,64 @@ class Report {
  public:
   std::set<Race> races;
 
-  Report(const std::vector<std::pair<const WriteEvent *, const MemAccessEvent *>> &rawRaces);
+  // Fallbacks taken because the analysis went over budget. Empty if the analysis ran at full precision.
+  std::vector<std::string> fallbacks;
+
+  explicit Report(std::set<Race> races) : races(std::move(races)) {}
 
   inline bool empty() { return races.empty(); };
   inline std::size_t size() { return races.size(); };
 
+  // Write the report as a JSON object: {"races": [...], "fallbacks": [...]}. Races are serialized one at a time,
+  // without building a JSON document in memory.
   void dumpReport(const std::string &path = "races.json") const;
 };
 
+// Writes races to a file as JSON Lines (one JSON object per line) while the analysis is still running.
+// Races are deduplicated on their serialized form (source locations and access types) as they arrive, and the file is
+// flushed periodically so that the races found so far survive if the analysis is killed.
+// Safe to call from multiple threads.
+class RaceStreamWriter {
+  std::ofstream output;
+  std::unordered_set<std::string> written;
+  size_t unflushed = 0;
+  const size_t flushInterval;
+  std::mutex mutex;
+
+ public:
+  // Races are flushed to disk after every flushInterval new races
+  explicit RaceStreamWriter(const std::string &path, size_t flushInterval = 64);
+  ~RaceStreamWriter();
+  RaceStreamWriter(const RaceStreamWriter &) = delete;
+  RaceStreamWriter &operator=(const RaceStreamWriter &) = delete;
+
+  [[nodiscard]] bool good() const { return output.good(); }
+
+  // Write race unless an identical one has already been written. Races missing a location are not written.
+  void write(const Race &race);
+
+  // Write a fallback taken by the analysis as a {"fallback": ...} line, so readers can tell the races are degraded
+  void writeFallback(const std::string &fallback);
+
+  void flush();
+};
+
 class Reporter {
-  std::vector<std::pair<const WriteEvent *, const MemAccessEvent *>> racepairs;
+  // Races are deduplicated as they are collected, so memory grows with distinct races instead of raw event pairs
+  std::set<Race> races;
+  // number of race pairs dropped because either access has no source location
+  size_t skipped = 0;
+  // If set, every newly collected race is also streamed to this writer
+  RaceStreamWriter *stream;
 
  public:
+  explicit Reporter(RaceStreamWriter *stream = nullptr) : stream(stream) {}
+
   void collect(const WriteEvent *e1, const MemAccessEvent *e2);
 
+  // Add all races collected by another reporter (e.g. a per-worker shard)
+  void merge(const Reporter &other);
+
   [[nodiscard]] Report getReport() const;
 };
 
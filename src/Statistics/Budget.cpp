@@ -0,0 +1,39 @@
+/* Copyright 2021 Coderrect Inc. All Rights Reserved.
+Licensed under the GNU Affero General Public License, version 3 or later (“AGPL”), as published by the Free Software
+Foundation. You may not use this file except in compliance with the License. You may obtain a copy of the License at
+https://www.gnu.org/licenses/agpl-3.0.en.html
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an “AS IS” BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "Budget.h"
+
+#include "Statistics/Stats.h"
+
+using namespace race;
+
+bool Budget::phaseExceeded() const {
+  if (limits.maxPhaseSeconds.has_value()) {
+    auto const elapsed = std::chrono::duration<double>(Clock::now() - phaseStart);
+    if (elapsed.count() > limits.maxPhaseSeconds.value()) return true;
+  }
+
+  if (limits.maxMemoryMB.has_value()) {
+    // Peak RSS never shrinks, so once exceeded it stays exceeded
+    if (memoryExceeded) return true;
+    if (numChecks++ % 256 == 0 && Stats::getPeakRSSKB() / 1024 > limits.maxMemoryMB.value()) {
+      memoryExceeded = true;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void Budget::recordFallback(std::string fallback) {
+  std::lock_guard<std::mutex> lock(mutex);
+  fallbacks.push_back(std::move(fallback));
+}
@@ -0,0 +1,81 @@
+/* Copyright 2021 Coderrect Inc. All Rights Reserved.
+Licensed under the GNU Affero General Public License, version 3 or later (“AGPL”), as published by the Free Software
+Foundation. You may not use this file except in compliance with the License. You may obtain a copy of the License at
+https://www.gnu.org/licenses/agpl-3.0.en.html
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an “AS IS” BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <llvm/ADT/StringRef.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace race {
+
+// Resource limits for one run of the race detector. Unset limits are not enforced.
+struct BudgetLimits {
+  // wall time allowed for each phase of the analysis
+  std::optional<double> maxPhaseSeconds;
+  // peak resident set size allowed for the process
+  std::optional<long> maxMemoryMB;
+  // constraint graph nodes allowed in the context sensitive pointer analysis
+  std::optional<size_t> maxConstraintNodes;
+  // events allowed in the program trace before calls stop being traversed
+  std::optional<size_t> maxTraceEvents;
+  // access pairs checked for races before the remaining pairs are sampled
+  std::optional<size_t> maxPairs;
+};
+
+// Tracks usage against BudgetLimits and records the fallbacks taken when a limit is hit.
+// Each limit has a fallback that trades precision for a bounded run:
+//  - pointer analysis over budget: rerun it context insensitively
+//  - trace building over budget:   stop traversing into calls below the thread entry functions
+//  - race checking over budget:    sample the access pairs that are checked
+class Budget {
+  using Clock = std::chrono::steady_clock;
+
+  const BudgetLimits limits;
+  Clock::time_point phaseStart = Clock::now();
+
+  // memory is only measured every few checks, as it needs a syscall
+  mutable std::atomic<size_t> numChecks{0};
+  mutable std::atomic<bool> memoryExceeded{false};
+
+  std::mutex mutex;
+  std::vector<std::string> fallbacks;
+
+ public:
+  explicit Budget(BudgetLimits limits = BudgetLimits()) : limits(limits) {}
+
+  [[nodiscard]] const BudgetLimits &getLimits() const { return limits; }
+
+  // Restart the wall time allowance for a new phase
+  void beginPhase() { phaseStart = Clock::now(); }
+
+  // return true if the running phase is over its time limit, or the process is over its memory limit.
+  // Safe to call from multiple threads.
+  [[nodiscard]] bool phaseExceeded() const;
+
+  [[nodiscard]] bool constraintNodesExceeded(size_t numNodes) const {
+    return limits.maxConstraintNodes.has_value() && numNodes > limits.maxConstraintNodes.value();
+  }
+  [[nodiscard]] bool traceEventsExceeded(size_t numEvents) const {
+    return limits.maxTraceEvents.has_value() && numEvents > limits.maxTraceEvents.value();
+  }
+
+  // Record that a fallback was taken. Safe to call from multiple threads.
+  void recordFallback(std::string fallback);
+  [[nodiscard]] const std::vector<std::string> &getFallbacks() const { return fallbacks; }
+};
+
+}  // namespace race
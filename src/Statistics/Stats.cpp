@@ -0,0 +1,58 @@
+/* Copyright 2021 Coderrect Inc. All Rights Reserved.
+Licensed under the GNU Affero General Public License, version 3 or later (“AGPL”), as published by the Free Software
+Foundation. You may not use this file except in compliance with the License. You may obtain a copy of the License at
+https://www.gnu.org/licenses/agpl-3.0.en.html
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an “AS IS” BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "Stats.h"
+
+#include <sys/resource.h>
+
+#include <fstream>
+#include <nlohmann/json.hpp>
+
+using namespace race;
+
+long Stats::getPeakRSSKB() {
+  struct rusage usage {};
+  if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+  // ru_maxrss is reported in KB on Linux
+  return usage.ru_maxrss;
+}
+
+void Stats::beginPhase(llvm::StringRef name) {
+  endPhase();
+  current = RunningPhase{name.str(), Clock::now(), getPeakRSSKB()};
+}
+
+void Stats::endPhase() {
+  if (!current.has_value()) return;
+
+  auto const elapsed = std::chrono::duration<double>(Clock::now() - current->start);
+  phases.push_back({current->name, elapsed.count(), getPeakRSSKB() - current->startPeakRSSKB});
+  current.reset();
+}
+
+void Stats::dumpJSON(const std::string &path) const {
+  nlohmann::json phasesJSON = nlohmann::json::array();
+  double totalSeconds = 0;
+  for (auto const &phase : phases) {
+    phasesJSON.push_back(
+        {{"name", phase.name}, {"wall_seconds", phase.wallSeconds}, {"peak_rss_delta_kb", phase.peakRSSDeltaKB}});
+    totalSeconds += phase.wallSeconds;
+  }
+
+  nlohmann::json statsJSON{{"phases", phasesJSON},
+                           {"counters", counters},
+                           {"total_wall_seconds", totalSeconds},
+                           {"peak_rss_kb", getPeakRSSKB()}};
+
+  std::ofstream output(path, std::ofstream::out);
+  output << statsJSON.dump(2) << "\n";
+  output.close();
+}
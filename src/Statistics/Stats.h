@@ -0,0 +1,66 @@
+/* Copyright 2021 Coderrect Inc. All Rights Reserved.
+Licensed under the GNU Affero General Public License, version 3 or later (“AGPL”), as published by the Free Software
+Foundation. You may not use this file except in compliance with the License. You may obtain a copy of the License at
+https://www.gnu.org/licenses/agpl-3.0.en.html
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an “AS IS” BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <llvm/ADT/StringRef.h>
+
+#include <chrono>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace race {
+
+// Wall time and memory used by one stage of the analysis
+struct PhaseStats {
+  std::string name;
+  double wallSeconds = 0;
+  // growth of the process' peak resident set size while the phase ran
+  long peakRSSDeltaKB = 0;
+};
+
+// Records per-phase timing and memory, and named counters, for one run of the race detector.
+// Phases run one after another: starting a phase ends the one currently running.
+class Stats {
+  using Clock = std::chrono::steady_clock;
+
+  struct RunningPhase {
+    std::string name;
+    Clock::time_point start;
+    long startPeakRSSKB;
+  };
+  std::optional<RunningPhase> current;
+
+  std::vector<PhaseStats> phases;
+  std::map<std::string, uint64_t> counters;
+
+ public:
+  // End the running phase (if any) and start timing a new one
+  void beginPhase(llvm::StringRef name);
+  // End the running phase (if any)
+  void endPhase();
+
+  void setCounter(llvm::StringRef name, uint64_t value) { counters[name.str()] = value; }
+  void addCounter(llvm::StringRef name, uint64_t value) { counters[name.str()] += value; }
+
+  [[nodiscard]] const std::vector<PhaseStats> &getPhases() const { return phases; }
+  [[nodiscard]] const std::map<std::string, uint64_t> &getCounters() const { return counters; }
+
+  // Peak resident set size of this process so far, in KB
+  [[nodiscard]] static long getPeakRSSKB();
+
+  // Write every finished phase and counter to path as a JSON document
+  void dumpJSON(const std::string &path) const;
+};
+
+}  // namespace race
@@ -0,0 +1,221 @@
+/* Copyright 2021 Coderrect Inc. All Rights Reserved.
+Licensed under the GNU Affero General Public License, version 3 or later (“AGPL”), as published by the Free Software
+Foundation. You may not use this file except in compliance with the License. You may obtain a copy of the License at
+https://www.gnu.org/licenses/agpl-3.0.en.html
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an “AS IS” BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Compares the points-to set backends on the sets of a real run.
+//
+//   openrace -dump-pts prog.ll    # writes PTS.txt
+//   pts-bench PTS.txt
+//
+// Every backend builds all the sets, iterates them, and runs the set operations of the solvers on random pairs.
+// SharedPTS stores every distinct set once, so only its memory is reported, against the set per node of BitVectorPTS.
+
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/SparseBitVector.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/FormatVariadic.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "PointerAnalysis/Solver/PointsTo/RoaringBitmap.h"
+
+static llvm::cl::opt<std::string> InputFilename(llvm::cl::Positional, llvm::cl::desc("<points-to dump>"),
+                                                llvm::cl::init("PTS.txt"), llvm::cl::value_desc("filename"));
+
+static llvm::cl::opt<unsigned> NumPairs("pairs", llvm::cl::desc("Number of random set pairs for binary operations"),
+                                        llvm::cl::value_desc("N"), llvm::cl::init(100000));
+
+static llvm::cl::opt<unsigned> Seed("seed", llvm::cl::desc("Seed of the random pairs"), llvm::cl::init(0));
+
+namespace {
+
+using Set = std::vector<unsigned>;
+
+// The dump has a "<node> : {id ,id ,...}" line for every node. The node strings can span lines and contain braces,
+// so only take lines that end with a list of ids.
+std::vector<Set> parsePointsToDump(llvm::StringRef content) {
+  std::vector<Set> sets;
+  llvm::SmallVector<llvm::StringRef, 0> lines;
+  content.split(lines, '\n', -1, false);
+  for (auto line : lines) {
+    line = line.rtrim();
+    auto const open = line.rfind(" : {");
+    if (open == llvm::StringRef::npos || !line.endswith("}")) continue;
+    auto const list = line.slice(open + 4, line.size() - 1);
+
+    Set set;
+    llvm::SmallVector<llvm::StringRef, 16> ids;
+    list.split(ids, ',', -1, false);
+    bool valid = true;
+    for (auto id : ids) {
+      unsigned value;
+      if (id.trim().getAsInteger(10, value)) {
+        valid = false;
+        break;
+      }
+      set.push_back(value);
+    }
+    if (valid) sets.push_back(std::move(set));
+  }
+  return sets;
+}
+
+size_t memoryUsage(const llvm::SparseBitVector<> &set) {
+  // SparseBitVector<> keeps a list of 128-bit elements
+  constexpr unsigned ELEMENT_BITS = 128;
+  std::set<unsigned> elements;
+  for (auto id : set) {
+    elements.insert(id / ELEMENT_BITS);
+  }
+  return elements.size() * (sizeof(llvm::SparseBitVectorElement<ELEMENT_BITS>) + 2 * sizeof(void *));
+}
+
+size_t memoryUsage(const pta::RoaringBitmap &set) { return set.getMemoryUsage(); }
+
+size_t memoryUsage(const Set &ids) {
+  llvm::SparseBitVector<> set;
+  for (auto id : ids) {
+    set.set(id);
+  }
+  return memoryUsage(set);
+}
+
+// SharedPTS keeps every distinct set once, plus a set id and a reference count per node
+void reportSharedMemory(const std::vector<Set> &input) {
+  std::set<Set> unique;
+  size_t perNodeBytes = 0;
+  for (auto const &ids : input) {
+    perNodeBytes += memoryUsage(ids);
+    if (!ids.empty()) unique.insert(ids);
+  }
+  size_t sharedBytes = input.size() * 2 * sizeof(uint32_t);
+  for (auto const &ids : unique) {
+    sharedBytes += memoryUsage(ids);
+  }
+  constexpr double MB = 1024 * 1024;
+  llvm::outs() << llvm::formatv("SharedPTS stores {0} distinct sets: {1:f2} MB, BitVectorPTS: {2:f2} MB\n",
+                                unique.size(), sharedBytes / MB, perNodeBytes / MB);
+}
+
+class Timer {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+ public:
+  double elapsedMs() const {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  }
+};
+
+template <typename PtsTy>
+void runBenchmark(llvm::StringRef name, const std::vector<Set> &input,
+                  const std::vector<std::pair<size_t, size_t>> &pairs) {
+  std::vector<PtsTy> sets(input.size());
+  Timer buildTimer;
+  for (size_t i = 0; i < input.size(); i++) {
+    for (auto id : input[i]) {
+      sets[i].set(id);
+    }
+  }
+  double const buildMs = buildTimer.elapsedMs();
+
+  // the checksums keep the work from being optimized away, and must agree between the backends
+  size_t checksum = 0;
+  Timer iterateTimer;
+  for (auto const &set : sets) {
+    for (auto id : set) {
+      checksum += id;
+    }
+  }
+  double const iterateMs = iterateTimer.elapsedMs();
+
+  Timer unionTimer;
+  for (auto [lhs, rhs] : pairs) {
+    PtsTy result = sets[lhs];
+    checksum += result |= sets[rhs];
+  }
+  double const unionMs = unionTimer.elapsedMs();
+
+  Timer differenceTimer;
+  for (auto [lhs, rhs] : pairs) {
+    PtsTy result;
+    result.intersectWithComplement(sets[lhs], sets[rhs]);
+    checksum += result.empty();
+  }
+  double const differenceMs = differenceTimer.elapsedMs();
+
+  Timer intersectsTimer;
+  for (auto [lhs, rhs] : pairs) {
+    checksum += sets[lhs].intersects(sets[rhs]);
+  }
+  double const intersectsMs = intersectsTimer.elapsedMs();
+
+  Timer containsTimer;
+  for (auto [lhs, rhs] : pairs) {
+    checksum += sets[lhs].contains(sets[rhs]);
+  }
+  double const containsMs = containsTimer.elapsedMs();
+
+  size_t bytes = 0;
+  for (auto const &set : sets) {
+    bytes += memoryUsage(set);
+  }
+
+  llvm::outs() << llvm::formatv("{0,-22}{1,11:f2}{2,11:f2}{3,11:f2}{4,11:f2}{5,11:f2}{6,11:f2}{7,11:f2}{8,21}\n", name,
+                                buildMs, iterateMs, unionMs, differenceMs, intersectsMs, containsMs,
+                                static_cast<double>(bytes) / (1024 * 1024), checksum);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  llvm::cl::ParseCommandLineOptions(argc, argv, "Benchmark the points-to set backends\n");
+
+  auto buffer = llvm::MemoryBuffer::getFile(InputFilename);
+  if (!buffer) {
+    llvm::errs() << "can not read " << InputFilename << ": " << buffer.getError().message() << "\n";
+    return 1;
+  }
+  auto const sets = parsePointsToDump((*buffer)->getBuffer());
+
+  std::vector<size_t> nonEmpty;
+  size_t numIds = 0;
+  for (size_t i = 0; i < sets.size(); i++) {
+    numIds += sets[i].size();
+    if (!sets[i].empty()) nonEmpty.push_back(i);
+  }
+  llvm::outs() << sets.size() << " sets, " << nonEmpty.size() << " non-empty, " << numIds << " ids\n";
+  if (nonEmpty.empty()) return 0;
+
+  std::mt19937 rng(Seed);
+  std::uniform_int_distribution<size_t> pick(0, nonEmpty.size() - 1);
+  std::vector<std::pair<size_t, size_t>> pairs;
+  pairs.reserve(NumPairs);
+  for (unsigned i = 0; i < NumPairs; i++) {
+    pairs.emplace_back(nonEmpty[pick(rng)], nonEmpty[pick(rng)]);
+  }
+
+  llvm::outs() << llvm::formatv("{0,-22}{1,11}{2,11}{3,11}{4,11}{5,11}{6,11}{7,11}{8,21}\n", "backend (ms, MB)",
+                                "build", "iterate", "union", "difference", "intersects", "contains", "memory",
+                                "checksum");
+  runBenchmark<llvm::SparseBitVector<>>("BitVectorPTS", sets, pairs);
+  auto const roaring = std::string("RoaringPTS (") + pta::RoaringBitmap::getKernelName() + ")";
+  runBenchmark<pta::RoaringBitmap>(roaring, sets, pairs);
+  pta::RoaringBitmap::useScalarKernels(true);
+  runBenchmark<pta::RoaringBitmap>("RoaringPTS (scalar)", sets, pairs);
+  reportSharedMemory(sets);
+  return 0;
+}
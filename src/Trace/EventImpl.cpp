@@ -20,6 +20,7 @@ const std::multiset<const pta::ObjTy *> &WriteEventImpl::getAccessedMemory() con
 std::vector<const pta::CallGraphNodeTy *> ForkEventImpl::getThreadEntry() const {
   auto entryVal = fork->getThreadEntry();
   if (auto entryFunc = llvm::dyn_cast<llvm::Function>(entryVal)) {
+    auto const ptaScope = info->thread->program.pta.enterScope();
     auto const newContext = pta::CT::contextEvolve(info->context, fork->getInst());
     auto const entryNode = info->thread->program.pta.getDirectNodeOrNull(newContext, entryFunc);
     return {entryNode};
@@ -12,18 +12,67 @@ limitations under the License.
 #include "ProgramTrace.h"
 
 #include "PreProcessing/PreProcessing.h"
+#include "Statistics/Budget.h"
+#include "Statistics/Stats.h"
 #include "Trace/Event.h"
 
+extern llvm::cl::opt<unsigned> PTA_DEMAND_BUDGET;
+extern llvm::cl::opt<bool> PTA_SELECTIVE_CTX;
+extern llvm::cl::opt<std::string> PTA_RESULTS_CACHE;
+extern llvm::cl::opt<bool> PTA_INCREMENTAL;
+extern llvm::cl::opt<unsigned> PTA_JOBS;
+
 using namespace race;
 
-ProgramTrace::ProgramTrace(llvm::Module *module, llvm::StringRef entryName) : module(module) {
+ProgramTrace::ProgramTrace(llvm::Module *module, llvm::StringRef entryName, Stats *stats, Budget *budget)
+    : module(module) {
+  auto const beginPhase = [stats, budget](llvm::StringRef name) {
+    if (stats != nullptr) stats->beginPhase(name);
+    if (budget != nullptr) budget->beginPhase();
+  };
+
   // Run preprocessing on module
+  beginPhase("preprocessing");
   preprocess(*module);
 
-  // Run pointer analysis
-  pta.analyze(module, entryName);
+  // Run pointer analysis, the trace is built in the scope of its contexts and points-to sets
+  auto const ptaScope = pta.enterScope();
+  pta.setNumWorkers(PTA_JOBS);
+  if (PTA_SELECTIVE_CTX) {
+    // a cheap context insensitive run tells which functions are worth cloning
+    beginPhase("pta-pre-analysis");
+    pta::CT::setContextInsensitive(true);
+    pta.analyze(module, entryName);
+    auto policy = pta::buildCtxPolicy(pta);
+    pta.reset();
+    pta::CT::setPolicy(policy);
+    if (stats != nullptr) stats->setCounter("pta-uncloned-callsites", policy.size());
+  }
+  pta::CT::setContextInsensitive(false);
+  pta.setDemandDriven(PTA_DEMAND_BUDGET);
+  // the saved results are keyed by the module only, they do not tell which contexts they were computed with
+  if (!PTA_SELECTIVE_CTX) pta.setResultsCache(PTA_RESULTS_CACHE);
+  pta.setIncremental(PTA_INCREMENTAL);
+  if (budget != nullptr) {
+    pta.setBudgetCheck([budget](size_t numNodes) {
+      return budget->constraintNodesExceeded(numNodes) || budget->phaseExceeded();
+    });
+  }
+  pta.analyze(module, entryName, beginPhase);
+
+  // Fallback: a context insensitive analysis is much smaller. It runs to completion, as there is nothing cheaper left.
+  if (pta.isStoppedEarly()) {
+    budget->recordFallback("pointer analysis over budget, reran context insensitively");
+    pta.reset();
+    pta.setBudgetCheck(nullptr);
+    pta.setResultsCache("");
+    pta::CT::setContextInsensitive(true);
+    pta.analyze(module, entryName, beginPhase);
+  }
 
+  beginPhase("trace-build");
   TraceBuildState state;
+  state.budget = budget;
 
   // build all threads starting from this main func
   auto const mainEntry = pta::GT::getEntryNode(pta.getCallGraph());
@@ -45,6 +94,23 @@ ProgramTrace::ProgramTrace(llvm::Module *module, llvm::StringRef entryName) : mo
       worklist.push_back(it->get());
     }
   }
+
+  if (stats != nullptr) {
+    stats->endPhase();
+
+    size_t numEvents = 0;
+    for (auto const thread : threads) {
+      numEvents += thread->getEvents().size();
+    }
+    stats->setCounter("threads", threads.size());
+    stats->setCounter("events", numEvents);
+    stats->setCounter("constraint-nodes", pta.getConsGraph()->getNodeNum());
+    stats->setCounter("pta-iterations", pta.getNumIterations());
+    stats->setCounter("pta-substituted-nodes", pta.getNumSubstitutedNodes());
+    stats->setCounter("pta-hcd-merges", pta.getNumHCDMerges());
+    stats->setCounter("pta-results-loaded", pta.isLoadedFromCache());
+    stats->setCounter("pta-reused-nodes", pta.getNumReusedNodes());
+  }
 }
 
 llvm::raw_ostream &race::operator<<(llvm::raw_ostream &os, const ProgramTrace &trace) {
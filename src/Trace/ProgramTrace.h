@@ -22,6 +22,9 @@ limitations under the License.
 
 namespace race {
 
+class Budget;
+class Stats;
+
 struct OpenMPState {
   // Track if we are currently in parallel region created from kmpc_fork_teams
   size_t teamsDepth = 0;
@@ -78,6 +81,14 @@ struct TraceBuildState {
 
   // Track state specific to OpenMP
   OpenMPState openmp;
+
+  // Limits the size of the trace, or nullptr if unlimited
+  Budget *budget = nullptr;
+  // Number of events on threads that are finished, and the events of the threads still being built
+  size_t finishedEvents = 0;
+  std::vector<const std::vector<std::unique_ptr<const Event>> *> activeThreads;
+  // Set once the budget is used up. From then on calls are not traversed.
+  bool callsCapped = false;
 };
 
 class ProgramTrace {
@@ -97,7 +108,10 @@ class ProgramTrace {
   // Get the module after preprocessing has been run
   [[nodiscard]] const Module &getModule() const { return *module; }
 
-  explicit ProgramTrace(llvm::Module *module, llvm::StringRef entryName = "main");
+  // If stats is provided, the time and memory spent in each stage of building the trace is recorded to it.
+  // If budget is provided, the pointer analysis and trace fall back to cheaper, less precise modes when over budget.
+  explicit ProgramTrace(llvm::Module *module, llvm::StringRef entryName = "main", Stats *stats = nullptr,
+                        Budget *budget = nullptr);
   ~ProgramTrace() = default;
   ProgramTrace(const ProgramTrace &) = delete;
   ProgramTrace(ProgramTrace &&) = delete;  // Need to update threads because
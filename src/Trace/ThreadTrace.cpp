@@ -13,6 +13,7 @@ limitations under the License.
 
 #include "EventImpl.h"
 #include "IR/IRImpls.h"
+#include "Statistics/Budget.h"
 #include "Trace/CallStack.h"
 #include "Trace/ProgramTrace.h"
 
@@ -104,6 +105,23 @@ bool shouldSkipIR(const std::shared_ptr<const IR> &ir, TraceBuildState &state) {
   return false;
 }
 
+// return true if the trace is over budget, in which case calls are no longer traversed
+bool overTraceBudget(TraceBuildState &state) {
+  if (state.callsCapped) return true;
+  if (state.budget == nullptr) return false;
+
+  auto numEvents = state.finishedEvents;
+  for (auto const events : state.activeThreads) {
+    numEvents += events->size();
+  }
+  if (state.budget->traceEventsExceeded(numEvents) || state.budget->phaseExceeded()) {
+    state.callsCapped = true;
+    state.budget->recordFallback("trace over budget after " + std::to_string(numEvents) +
+                                 " events, stopped traversing calls below thread entry functions");
+  }
+  return state.callsCapped;
+}
+
 bool isOpenMPTeamSpecific(const IR *ir) {
   auto const type = ir->type;
   return type == IR::Type::OpenMPBarrier || type == IR::Type::OpenMPCriticalStart ||
@@ -253,6 +271,11 @@ void traverseCallNode(const pta::CallGraphNodeTy *node, ThreadTrace &thread, Cal
         continue;
       }
 
+      // Fallback: once over budget the trace is capped at the thread entry functions
+      if (overTraceBudget(state)) {
+        continue;
+      }
+
       events.push_back(std::make_unique<const EnterCallEventImpl>(call, einfo, events.size()));
       traverseCallNode(directNode, thread, callstack, pta, events, threads, state);
       events.push_back(std::make_unique<const LeaveCallEventImpl>(call, einfo, events.size()));
@@ -268,7 +291,10 @@ void traverseCallNode(const pta::CallGraphNodeTy *node, ThreadTrace &thread, Cal
 
 void ThreadTrace::buildEventTrace(const pta::CallGraphNodeTy *entry, const pta::PTA &pta, TraceBuildState &state) {
   CallStack callstack;
+  state.activeThreads.push_back(&events);
   traverseCallNode(entry, *this, callstack, pta, events, childThreads, state);
+  state.activeThreads.pop_back();
+  state.finishedEvents += events.size();
 }
 
 ThreadTrace::ThreadTrace(ProgramTrace &program, const pta::CallGraphNodeTy *entry, TraceBuildState &state)
@@ -27,11 +27,40 @@ static llvm::cl::opt<std::string> DumpPreproccessedIR("dump-ir", cl::desc("Dump
 static llvm::cl::opt<std::string> DumpJSON("json", cl::desc("Dump JSON race report"),
                                            cl::value_desc("destination file"));
 
+static llvm::cl::opt<std::string> StreamJSON("jsonl", cl::desc("Stream races as JSON Lines while they are detected"),
+                                             cl::value_desc("destination file"));
+
 static llvm::cl::opt<bool> PrintTrace("print-trace", cl::desc("print the program trace to stdout"), cl::init(true));
 
 static llvm::cl::opt<bool> DoCoverage(
     "do-cvg", cl::desc("Compute and print the coverage (= analyzed source code/all source code)"), cl::init(true));
 
+static llvm::cl::opt<unsigned int> Jobs("jobs", cl::desc("Number of worker threads used to check races"),
+                                        cl::value_desc("N"), cl::init(1));
+
+static llvm::cl::opt<std::string> DumpStatsJSON("stats-json",
+                                                cl::desc("Dump per-phase timing, memory and counters as JSON"),
+                                                cl::value_desc("destination file"));
+
+// Analysis budgets. 0 means unlimited.
+static llvm::cl::opt<double> MaxPhaseSeconds("max-phase-seconds", cl::desc("Wall time allowed for each analysis phase"),
+                                             cl::value_desc("seconds"), cl::init(0));
+
+static llvm::cl::opt<long> MaxMemoryMB("max-memory-mb", cl::desc("Peak memory allowed for the analysis"),
+                                       cl::value_desc("MB"), cl::init(0));
+
+static llvm::cl::opt<size_t> MaxConstraintNodes(
+    "max-constraint-nodes", cl::desc("Constraint graph nodes allowed before falling back to context insensitive PTA"),
+    cl::value_desc("N"), cl::init(0));
+
+static llvm::cl::opt<size_t> MaxTraceEvents("max-trace-events",
+                                            cl::desc("Trace events allowed before calls stop being traversed"),
+                                            cl::value_desc("N"), cl::init(0));
+
+static llvm::cl::opt<size_t> MaxPairs("max-pairs",
+                                      cl::desc("Access pairs checked for races before falling back to sampling"),
+                                      cl::value_desc("N"), cl::init(0));
+
 int main(int argc, char** argv) {
   llvm::InitLLVM X(argc, argv);
   llvm::cl::ParseCommandLineOptions(argc, argv);
@@ -56,10 +85,29 @@ int main(int argc, char** argv) {
   if (!DumpPreproccessedIR.empty()) {
     config.dumpPreprocessedIR = DumpPreproccessedIR;
   }
+  if (!StreamJSON.empty()) {
+    config.streamReport = StreamJSON;
+  }
   config.printTrace = PrintTrace;
   config.doCoverage = DoCoverage;
+  config.jobs = Jobs;
+  if (!DumpStatsJSON.empty()) {
+    config.dumpStatsJSON = DumpStatsJSON;
+  }
+  if (MaxPhaseSeconds > 0) config.budget.maxPhaseSeconds = MaxPhaseSeconds;
+  if (MaxMemoryMB > 0) config.budget.maxMemoryMB = MaxMemoryMB;
+  if (MaxConstraintNodes > 0) config.budget.maxConstraintNodes = MaxConstraintNodes;
+  if (MaxTraceEvents > 0) config.budget.maxTraceEvents = MaxTraceEvents;
+  if (MaxPairs > 0) config.budget.maxPairs = MaxPairs;
 
   auto report = race::detectRaces(module.get(), config);
+  if (!report.fallbacks.empty()) {
+    llvm::outs() << "==== Analysis over budget, results are less precise ====\n";
+    for (auto const& fallback : report.fallbacks) {
+      llvm::outs() << fallback << "\n";
+    }
+  }
+
   if (report.empty()) {
     llvm::outs() << "No races detected.\n";
     return 0;
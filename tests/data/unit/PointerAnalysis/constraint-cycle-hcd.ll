@@ -0,0 +1,32 @@
+; ModuleID = 'basic_c_tests/constraint-cycle-hcd.c'
+source_filename = "basic_c_tests/constraint-cycle-hcd.c"
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; int main() {
+;   int a;
+;   int *b = &a, *c;
+;   int **p = rand() ? &b : &c;
+;   int *q = *p;
+;   *p = q;
+; }
+; Kept in registers, so that the load and the store through p form a cycle with a single dereference:
+; every object p points to ends up in a copy cycle with q.
+; Function Attrs: noinline nounwind uwtable
+define dso_local i32 @main() #0 {
+  %a = alloca i32, align 4
+  %b = alloca i32*, align 8
+  %c = alloca i32*, align 8
+  store i32* %a, i32** %b, align 8
+  %call = call i32 @rand()
+  %tobool = icmp ne i32 %call, 0
+  %p = select i1 %tobool, i32** %b, i32** %c
+  %q = load i32*, i32** %p, align 8
+  store i32* %q, i32** %p, align 8
+  ret i32 0
+}
+
+declare dso_local i32 @rand() #1
+
+attributes #0 = { noinline nounwind uwtable }
+attributes #1 = { "correctly-rounded-divide-sqrt-fp-math"="false" }
@@ -0,0 +1,47 @@
+; ModuleID = 'basic_cpp_tests/cpp-vector.cpp'
+source_filename = "basic_cpp_tests/cpp-vector.cpp"
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+%"class.std::vector" = type { %"struct.std::_Vector_base" }
+%"struct.std::_Vector_base" = type { %"struct.std::_Vector_base<int *, std::allocator<int *> >::_Vector_impl" }
+%"struct.std::_Vector_base<int *, std::allocator<int *> >::_Vector_impl" = type { %"struct.std::_Vector_base<int *, std::allocator<int *> >::_Vector_impl_data" }
+%"struct.std::_Vector_base<int *, std::allocator<int *> >::_Vector_impl_data" = type { i32**, i32**, i32** }
+
+@a = dso_local global i32 0, align 4
+@b = dso_local global i32 0, align 4
+
+; int main() {
+;   std::vector<int *> vec;
+;   vec.push_back(&a);
+;   int *p = vec[0];
+;   int **pp = &p;
+;   *pp = &b;
+;   int *q = p;
+; }
+; Function Attrs: noinline norecurse optnone uwtable
+define dso_local i32 @main() #0 {
+  %vec = alloca %"class.std::vector", align 8
+  %ref.tmp = alloca i32*, align 8
+  %p = alloca i32*, align 8
+  %pp = alloca i32**, align 8
+  %q = alloca i32*, align 8
+  store i32* @a, i32** %ref.tmp, align 8
+  call void @_ZNSt6vectorIPiSaIS0_EE9push_backERKS0_(%"class.std::vector"* %vec, i32** dereferenceable(8) %ref.tmp)
+  %call = call dereferenceable(8) i32** @_ZNSt6vectorIPiSaIS0_EEixEm(%"class.std::vector"* %vec, i64 0)
+  %elem = load i32*, i32** %call, align 8
+  store i32* %elem, i32** %p, align 8
+  store i32** %p, i32*** %pp, align 8
+  %1 = load i32**, i32*** %pp, align 8
+  store i32* @b, i32** %1, align 8
+  %2 = load i32*, i32** %p, align 8
+  store i32* %2, i32** %q, align 8
+  ret i32 0
+}
+
+declare dso_local void @_ZNSt6vectorIPiSaIS0_EE9push_backERKS0_(%"class.std::vector"*, i32** dereferenceable(8)) #1
+
+declare dso_local dereferenceable(8) i32** @_ZNSt6vectorIPiSaIS0_EEixEm(%"class.std::vector"*, i64) #1
+
+attributes #0 = { noinline norecurse optnone uwtable }
+attributes #1 = { "correctly-rounded-divide-sqrt-fp-math"="false" }
@@ -0,0 +1,37 @@
+; ModuleID = 'basic_c_tests/substitution-phi.c'
+source_filename = "basic_c_tests/substitution-phi.c"
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; int main() {
+;   int a, b;
+;   int *p, *q;
+;   if (rand()) { p = &a; q = &a; } else { p = &b; q = &b; }
+;   int **pp = &p;
+;   *pp = q;
+; }
+; p and q are phis of the same pointers, offline substitution merges them.
+; Function Attrs: noinline nounwind uwtable
+define dso_local i32 @main() #0 {
+  %a = alloca i32, align 4
+  %b = alloca i32, align 4
+  %pp = alloca i32*, align 8
+  %call = call i32 @rand()
+  %tobool = icmp ne i32 %call, 0
+  br i1 %tobool, label %if.then, label %if.end
+
+if.then:                                          ; preds = %0
+  br label %if.end
+
+if.end:                                           ; preds = %if.then, %0
+  %p = phi i32* [ %a, %if.then ], [ %b, %0 ]
+  %q = phi i32* [ %b, %0 ], [ %a, %if.then ]
+  store i32* %p, i32** %pp, align 8
+  store i32* %q, i32** %pp, align 8
+  ret i32 0
+}
+
+declare dso_local i32 @rand() #1
+
+attributes #0 = { noinline nounwind uwtable }
+attributes #1 = { "correctly-rounded-divide-sqrt-fp-math"="false" }
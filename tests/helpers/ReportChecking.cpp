@@ -118,7 +118,8 @@ Oracle::Oracle(llvm::StringRef filename, std::vector<llvm::StringRef> races) : f
   expectedRaces = TestRace::fromStrings(std::move(races));
 }
 
-void checkTest(llvm::StringRef file, llvm::StringRef llPath, std::initializer_list<llvm::StringRef> expected) {
+void checkTest(llvm::StringRef file, llvm::StringRef llPath, std::initializer_list<llvm::StringRef> expected,
+               unsigned int jobs) {
   llvm::LLVMContext context;
   llvm::SMDiagnostic err;
 
@@ -134,6 +135,7 @@ void checkTest(llvm::StringRef file, llvm::StringRef llPath, std::initializer_li
   auto report = race::detectRaces(module.get(), race::DetectRaceConfig{
                                                     .printTrace = false,
                                                     .doCoverage = false,
+                                                    .jobs = jobs,
                                                 });
 
   // Get actual/expected test races
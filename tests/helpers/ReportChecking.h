@@ -65,7 +65,9 @@ struct Oracle {
 // llPath should point to directory containing test files
 void checkOracles(const std::vector<Oracle> &oracles, llvm::StringRef llPath);
 
-void checkTest(llvm::StringRef file, llvm::StringRef llPath, std::initializer_list<llvm::StringRef> expected);
+// jobs sets the number of worker threads used by detectRaces
+void checkTest(llvm::StringRef file, llvm::StringRef llPath, std::initializer_list<llvm::StringRef> expected,
+               unsigned int jobs = 1);
 
 // Helpers for testing
 bool reportContains(const race::Report &report, TestRace race);
@@ -408,3 +408,26 @@ TEST_LL("DRB169", "DRB169-missingsyncwrite-orig-yes.ll",
 TEST_LL("DRB170", "DRB170-nestedloops-orig-no.ll", NORACE)
 TEST_LL("DRB171", "DRB171-threadprivate3-orig-no.ll", NORACE)
 TEST_LL("DRB172", "DRB172-critical2-orig-no.ll", NORACE)
+
+// Checking races on several worker threads must give the same report as the sequential check
+#define TEST_LL_JOBS(name, file, ...)                                                         \
+  TEST_CASE(name " with 4 jobs", "[integration][dataracebench][omp][jobs]") {                \
+    checkTest(file, "integration/dataracebench/", {__VA_ARGS__}, 4);                          \
+  }
+
+TEST_LL_JOBS("DRB005", "DRB005-indirectaccess1-orig-yes.ll",
+             EXPECTED("DRB005-indirectaccess1-orig-yes.c:128:13 DRB005-indirectaccess1-orig-yes.c:129:13",
+                      "DRB005-indirectaccess1-orig-yes.c:128:13 DRB005-indirectaccess1-orig-yes.c:129:13",
+                      "DRB005-indirectaccess1-orig-yes.c:129:13 DRB005-indirectaccess1-orig-yes.c:128:13",
+                      "DRB005-indirectaccess1-orig-yes.c:129:13 DRB005-indirectaccess1-orig-yes.c:128:13"))
+TEST_LL_JOBS("DRB013", "DRB013-nowait-orig-yes.ll",
+             EXPECTED("DRB013-nowait-orig-yes.c:72:12 DRB013-nowait-orig-yes.c:75:13"))
+TEST_LL_JOBS("DRB073", "DRB073-doall2-orig-yes.ll",
+             EXPECTED("DRB073-doall2-orig-yes.c:61:5 DRB073-doall2-orig-yes.c:61:5",
+                      "DRB073-doall2-orig-yes.c:61:5 DRB073-doall2-orig-yes.c:61:5",
+                      "DRB073-doall2-orig-yes.c:61:5 DRB073-doall2-orig-yes.c:61:21",
+                      "DRB073-doall2-orig-yes.c:61:5 DRB073-doall2-orig-yes.c:61:5",
+                      "DRB073-doall2-orig-yes.c:61:5 DRB073-doall2-orig-yes.c:61:5",
+                      "DRB073-doall2-orig-yes.c:61:5 DRB073-doall2-orig-yes.c:61:21",
+                      "DRB073-doall2-orig-yes.c:62:14 DRB073-doall2-orig-yes.c:62:14",
+                      "DRB073-doall2-orig-yes.c:62:14 DRB073-doall2-orig-yes.c:62:15"))
@@ -9,8 +9,12 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <llvm/IRReader/IRReader.h>
+
 #include <catch2/catch.hpp>
+#include <fstream>
 
+#include "RaceDetect.h"
 #include "helpers/ReportChecking.h"
 
 #define TEST_LL(name, file, ...) \
@@ -29,3 +33,68 @@ TEST_LL("pthread-account-no", "pthread-account-no.ll", NORACE)
 TEST_LL("pthread-simple-yes", "pthread-simple-yes.ll", 
       EXPECTED("pthread-simple-yes.c:8:9 pthread-simple-yes.c:8:9",
                "pthread-simple-yes.c:8:9 pthread-simple-yes.c:8:9"))
+
+TEST_CASE("Stream races as JSON Lines", "[integration][pthread][report]") {
+  llvm::LLVMContext context;
+  llvm::SMDiagnostic err;
+  auto module = llvm::parseIRFile("integration/pthreadrace/pthread-simple-yes.ll", err, context);
+  REQUIRE(module.get() != nullptr);
+
+  auto const path = "pthread-simple-yes.races.jsonl";
+  auto report = race::detectRaces(module.get(), race::DetectRaceConfig{
+                                                    .printTrace = false,
+                                                    .doCoverage = false,
+                                                    .streamReport = path,
+                                                });
+
+  // Every line is a JSON object, and no race is written twice
+  std::ifstream input(path);
+  std::set<std::string> lines;
+  std::string line;
+  size_t numLines = 0;
+  while (std::getline(input, line)) {
+    CHECK_NOTHROW(race::json::parse(line));
+    lines.insert(line);
+    numLines++;
+  }
+  CHECK(numLines == lines.size());
+  // Races in the report that differ only in their instruction serialize to the same line
+  CHECK(numLines > 0);
+  CHECK(numLines <= report.size());
+}
+
+TEST_CASE("Report records budget fallbacks", "[integration][pthread][report]") {
+  llvm::LLVMContext context;
+  llvm::SMDiagnostic err;
+  auto module = llvm::parseIRFile("integration/pthreadrace/pthread-simple-yes.ll", err, context);
+  REQUIRE(module.get() != nullptr);
+
+  race::DetectRaceConfig config{
+      .printTrace = false,
+      .doCoverage = false,
+      .streamReport = "pthread-simple-yes.fallbacks.jsonl",
+  };
+  config.budget.maxPairs = 1;
+  auto report = race::detectRaces(module.get(), config);
+  REQUIRE_FALSE(report.fallbacks.empty());
+
+  // The dumped report lists the fallbacks next to the races
+  auto const path = "pthread-simple-yes.fallbacks.json";
+  report.dumpReport(path);
+  std::ifstream input(path);
+  auto const dumped = race::json::parse(input);
+  CHECK(dumped["races"].size() == report.size());
+  CHECK(dumped["fallbacks"].get<std::vector<std::string>>() == report.fallbacks);
+
+  // The stream ends with one record per fallback
+  std::ifstream stream(config.streamReport.value());
+  std::vector<std::string> streamed;
+  std::string line;
+  while (std::getline(stream, line)) {
+    auto const record = race::json::parse(line);
+    if (record.contains("fallback")) {
+      streamed.push_back(record["fallback"].get<std::string>());
+    }
+  }
+  CHECK(streamed == report.fallbacks);
+}
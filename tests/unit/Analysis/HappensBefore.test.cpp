@@ -15,6 +15,51 @@ limitations under the License.
 
 #include "Analysis/HappensBeforeGraph.h"
 
+namespace {
+using Reachability = race::HappensBeforeGraph::Reachability;
+
+// Check that both reachability engines agree on every pair of events in the program
+void checkEnginesAgree(const race::ProgramTrace &program) {
+  race::HappensBeforeGraph closure(program, Reachability::SyncClosure);
+  race::HappensBeforeGraph vectorClock(program, Reachability::VectorClock);
+
+  for (auto const &srcThread : program.getThreads()) {
+    for (auto const &src : srcThread->getEvents()) {
+      for (auto const &dstThread : program.getThreads()) {
+        for (auto const &dst : dstThread->getEvents()) {
+          INFO("src " << srcThread->id << ":" << src->getID() << " dst " << dstThread->id << ":" << dst->getID());
+          CHECK(closure.canReach(src.get(), dst.get()) == vectorClock.canReach(src.get(), dst.get()));
+        }
+      }
+    }
+  }
+}
+
+// Check that events in the same segment get the same happens-before answer against every event in the program
+void checkSegmentsAgree(const race::ProgramTrace &program) {
+  race::HappensBeforeGraph happensbefore(program);
+
+  // first event seen in each segment
+  std::map<race::HappensBeforeGraph::SegmentID, const race::Event *> representatives;
+  for (auto const &thread : program.getThreads()) {
+    for (auto const &event : thread->getEvents()) {
+      auto const segment = happensbefore.getSegmentID(event.get());
+      auto const rep = representatives.emplace(segment, event.get()).first->second;
+      REQUIRE(&rep->getThread() == thread);
+
+      for (auto const &otherThread : program.getThreads()) {
+        for (auto const &other : otherThread->getEvents()) {
+          INFO("event " << thread->id << ":" << event->getID() << " other " << otherThread->id << ":"
+                        << other->getID());
+          CHECK(happensbefore.canReach(event.get(), other.get()) == happensbefore.canReach(rep, other.get()));
+          CHECK(happensbefore.canReach(other.get(), event.get()) == happensbefore.canReach(other.get(), rep));
+        }
+      }
+    }
+  }
+}
+}  // namespace
+
 TEST_CASE("Happens Before Graph", "[unit][happensbefore]") {
   const char *ModuleString = R"(
 %union.pthread_attr_t = type { i64, [48 x i8] }
@@ -48,7 +93,8 @@ declare i32 @pthread_join(i64, i8**)
 
   race::ProgramTrace program(module.get(), "foo");
 
-  race::HappensBeforeGraph happensbefore(program);
+  auto const engine = GENERATE(Reachability::SyncClosure, Reachability::VectorClock);
+  race::HappensBeforeGraph happensbefore(program, engine);
 
   auto const &threads = program.getThreads();
   REQUIRE(threads.size() == 2);
@@ -66,6 +112,9 @@ declare i32 @pthread_join(i64, i8**)
   CHECK(!happensbefore.canReach(thread2.front().get(), thread1.front().get()));
   CHECK(!happensbefore.canReach(thread2.back().get(), thread1.front().get()));
   CHECK(!happensbefore.canReach(thread1.back().get(), thread2.front().get()));
+
+  checkEnginesAgree(program);
+  checkSegmentsAgree(program);
 }
 
 TEST_CASE("HappensBefore Barrier", "[unit][happensbefore]") {
@@ -107,7 +156,8 @@ declare void @__kmpc_fork_call(%struct.ident_t*, i32, void (i32*, i32*, ...)*, .
   }
 
   race::ProgramTrace program(module.get());
-  race::HappensBeforeGraph happensbefore(program);
+  auto const engine = GENERATE(Reachability::SyncClosure, Reachability::VectorClock);
+  race::HappensBeforeGraph happensbefore(program, engine);
 
   REQUIRE(program.getThreads().size() == 3);
 
@@ -120,4 +170,180 @@ declare void @__kmpc_fork_call(%struct.ident_t*, i32, void (i32*, i32*, ...)*, .
 
   CHECK_FALSE(happensbefore.areParallel(thread1->getEvent(2), thread2->getEvent(0)));
   CHECK_FALSE(happensbefore.areParallel(thread1->getEvent(0), thread2->getEvent(2)));
-}
\ No newline at end of file
+
+  checkEnginesAgree(program);
+  checkSegmentsAgree(program);
+}
+
+TEST_CASE("HappensBefore reachability engines agree", "[unit][happensbefore]") {
+  SECTION("nested pthread fork/join") {
+    const char *ModuleString = R"(
+%union.pthread_attr_t = type { i64, [48 x i8] }
+
+@global = global i32 0
+
+define i8* @leaf(i8* %arg) {
+  %val = load i32, i32* @global
+  store i32 %val, i32* @global
+  ret i8* null
+}
+
+define i8* @middle(i8* %arg) {
+  store i32 1, i32* @global
+  %p_thread = alloca i64
+  %1 = call i32 @pthread_create(i64* %p_thread, %union.pthread_attr_t* null, i8* (i8*)* @leaf, i8* null)
+  %val = load i32, i32* @global
+  %thread = load i64, i64* %p_thread
+  %2 = call i32 @pthread_join(i64 %thread, i8** null)
+  store i32 2, i32* @global
+  ret i8* null
+}
+
+define void @main() {
+  %t1 = alloca i64
+  %t2 = alloca i64
+  %t3 = alloca i64
+  store i32 0, i32* @global
+  %1 = call i32 @pthread_create(i64* %t1, %union.pthread_attr_t* null, i8* (i8*)* @middle, i8* null)
+  %2 = call i32 @pthread_create(i64* %t2, %union.pthread_attr_t* null, i8* (i8*)* @leaf, i8* null)
+  %h1 = load i64, i64* %t1
+  %3 = call i32 @pthread_join(i64 %h1, i8** null)
+  %4 = call i32 @pthread_create(i64* %t3, %union.pthread_attr_t* null, i8* (i8*)* @leaf, i8* null)
+  %h2 = load i64, i64* %t2
+  %5 = call i32 @pthread_join(i64 %h2, i8** null)
+  %h3 = load i64, i64* %t3
+  %6 = call i32 @pthread_join(i64 %h3, i8** null)
+  store i32 3, i32* @global
+  ret void
+}
+
+declare i32 @pthread_create(i64*, %union.pthread_attr_t*, i8* (i8*)*, i8*)
+declare i32 @pthread_join(i64, i8**)
+)";
+
+    llvm::LLVMContext Ctx;
+    llvm::SMDiagnostic Err;
+    auto module = llvm::parseAssemblyString(ModuleString, Err, Ctx);
+    if (!module) {
+      Err.print("error", llvm::errs());
+    }
+    REQUIRE(module);
+
+    race::ProgramTrace program(module.get());
+    REQUIRE(program.getThreads().size() == 5);
+    checkEnginesAgree(program);
+  }
+
+  SECTION("repeated OpenMP barriers") {
+    const char *ModuleString = R"(
+%struct.ident_t = type { i32, i32, i32, i32, i8* }
+
+@0 = private unnamed_addr constant [23 x i8] c";unknown;unknown;0;0;;\00", align 1
+@1 = private unnamed_addr constant %struct.ident_t { i32 0, i32 34, i32 0, i32 0, i8* getelementptr inbounds ([23 x i8], [23 x i8]* @0, i32 0, i32 0) }
+@2 = private unnamed_addr constant %struct.ident_t { i32 0, i32 2, i32 0, i32 0, i8* getelementptr inbounds ([23 x i8], [23 x i8]* @0, i32 0, i32 0) }
+
+@global = dso_local local_unnamed_addr global i32 0
+
+define dso_local i32 @main() {
+entry:
+  call void (%struct.ident_t*, i32, void (i32*, i32*, ...)*, ...) @__kmpc_fork_call(%struct.ident_t* nonnull @2, i32 0, void (i32*, i32*, ...)* bitcast (void (i32*, i32*)* @.omp_outlined. to void (i32*, i32*, ...)*))
+  store i32 0, i32* @global
+  call void (%struct.ident_t*, i32, void (i32*, i32*, ...)*, ...) @__kmpc_fork_call(%struct.ident_t* nonnull @2, i32 0, void (i32*, i32*, ...)* bitcast (void (i32*, i32*)* @.omp_outlined. to void (i32*, i32*, ...)*))
+  ret i32 0
+}
+
+define internal void @.omp_outlined.(i32* noalias nocapture readonly %.global_tid., i32* noalias nocapture readnone %.bound_tid.) {
+entry:
+  %0 = load i32, i32* @global
+  tail call void @__kmpc_barrier(%struct.ident_t* nonnull @1, i32 0)
+  store i32 %0, i32* @global
+  tail call void @__kmpc_barrier(%struct.ident_t* nonnull @1, i32 0)
+  %1 = load i32, i32* @global
+  tail call void @__kmpc_barrier(%struct.ident_t* nonnull @1, i32 0)
+  store i32 %1, i32* @global
+  ret void
+}
+
+declare dso_local void @__kmpc_barrier(%struct.ident_t*, i32)
+declare void @__kmpc_fork_call(%struct.ident_t*, i32, void (i32*, i32*, ...)*, ...)
+)";
+
+    llvm::LLVMContext Ctx;
+    llvm::SMDiagnostic Err;
+    auto module = llvm::parseAssemblyString(ModuleString, Err, Ctx);
+    if (!module) {
+      Err.print("error", llvm::errs());
+    }
+    REQUIRE(module);
+
+    race::ProgramTrace program(module.get());
+    REQUIRE(program.getThreads().size() == 5);
+    checkEnginesAgree(program);
+  }
+}
+
+TEST_CASE("HappensBefore thread-level parallelism", "[unit][happensbefore]") {
+  // Workers are spawned and joined in two sequential phases, so the two workers never run in parallel
+  const char *ModuleString = R"(
+%union.pthread_attr_t = type { i64, [48 x i8] }
+
+@global = global i32 0
+
+define i8* @worker(i8* %arg) {
+  %val = load i32, i32* @global
+  store i32 %val, i32* @global
+  ret i8* null
+}
+
+define void @main() {
+  %t1 = alloca i64
+  %t2 = alloca i64
+  %1 = call i32 @pthread_create(i64* %t1, %union.pthread_attr_t* null, i8* (i8*)* @worker, i8* null)
+  %h1 = load i64, i64* %t1
+  %2 = call i32 @pthread_join(i64 %h1, i8** null)
+  %3 = call i32 @pthread_create(i64* %t2, %union.pthread_attr_t* null, i8* (i8*)* @worker, i8* null)
+  %h2 = load i64, i64* %t2
+  %4 = call i32 @pthread_join(i64 %h2, i8** null)
+  ret void
+}
+
+declare i32 @pthread_create(i64*, %union.pthread_attr_t*, i8* (i8*)*, i8*)
+declare i32 @pthread_join(i64, i8**)
+)";
+
+  llvm::LLVMContext Ctx;
+  llvm::SMDiagnostic Err;
+  auto module = llvm::parseAssemblyString(ModuleString, Err, Ctx);
+  if (!module) {
+    Err.print("error", llvm::errs());
+  }
+  REQUIRE(module);
+
+  race::ProgramTrace program(module.get());
+  auto const engine = GENERATE(Reachability::SyncClosure, Reachability::VectorClock);
+  race::HappensBeforeGraph happensbefore(program, engine);
+
+  auto const &threads = program.getThreads();
+  REQUIRE(threads.size() == 3);
+  auto const main = threads.at(0)->id;
+  auto const worker1 = threads.at(1)->id;
+  auto const worker2 = threads.at(2)->id;
+
+  CHECK(happensbefore.threadsMayRunInParallel(main, worker1));
+  CHECK(happensbefore.threadsMayRunInParallel(worker2, main));
+  CHECK_FALSE(happensbefore.threadsMayRunInParallel(worker1, worker2));
+  CHECK_FALSE(happensbefore.threadsMayRunInParallel(worker2, worker1));
+  CHECK_FALSE(happensbefore.threadsMayRunInParallel(main, main));
+
+  // Thread pairs that cannot run in parallel have no parallel events
+  for (auto const &lhs : threads) {
+    for (auto const &rhs : threads) {
+      if (lhs == rhs || happensbefore.threadsMayRunInParallel(lhs->id, rhs->id)) continue;
+      for (auto const &lhsEvent : lhs->getEvents()) {
+        for (auto const &rhsEvent : rhs->getEvents()) {
+          CHECK_FALSE(happensbefore.areParallel(lhsEvent.get(), rhsEvent.get()));
+        }
+      }
+    }
+  }
+}
@@ -95,4 +95,14 @@ declare i32 @pthread_mutex_unlock(%union.pthread_mutex_t*) #1
       CHECK(!lockset.sharesLock(holdsLock, noLock));
     }
   }
+
+  // Events holding the same locks share one interned lockset
+  auto const heldID = lockset.getLockSetID(events.at(sharedIdxs.front()).get());
+  CHECK(heldID != race::LockSet::NoLocks);
+  for (auto idx : sharedIdxs) {
+    CHECK(lockset.getLockSetID(events.at(idx).get()) == heldID);
+  }
+  for (auto idx : emptyIdxs) {
+    CHECK(lockset.getLockSetID(events.at(idx).get()) == race::LockSet::NoLocks);
+  }
 }
\ No newline at end of file
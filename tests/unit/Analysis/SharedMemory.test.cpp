@@ -50,3 +50,133 @@ declare i32 @pthread_join(i64, i8**)
   race::ProgramTrace program(module.get(), "foo");
   race::SharedMemory sharedmem(program);
 }
+
+TEST_CASE("SharedMemory groups accesses by thread", "[unit][sharedmemory]") {
+  const char *ModuleString = R"(
+%union.pthread_attr_t = type { i64, [48 x i8] }
+
+@x = global i32 0
+
+define i8* @entry(i8* %arg) {
+    %1 = load i32, i32* @x
+    %2 = add nsw i32 %1, 1
+    store i32 %2, i32* @x
+    ret i8* null
+}
+
+define i32 @main() {
+  %t1 = alloca i64
+  %t2 = alloca i64
+  %1 = call i32 @pthread_create(i64* %t1, %union.pthread_attr_t* null, i8* (i8*)* @entry, i8* null)
+  %2 = call i32 @pthread_create(i64* %t2, %union.pthread_attr_t* null, i8* (i8*)* @entry, i8* null)
+  %val = load i32, i32* @x
+  ret i32 0
+}
+
+declare i32 @pthread_create(i64*, %union.pthread_attr_t*, i8* (i8*)*, i8*)
+)";
+
+  llvm::LLVMContext Ctx;
+  llvm::SMDiagnostic Err;
+  auto module = llvm::parseAssemblyString(ModuleString, Err, Ctx);
+  if (!module) {
+    Err.print("error", llvm::errs());
+  }
+
+  race::ProgramTrace program(module.get());
+  race::SharedMemory sharedmem(program);
+
+  auto const sharedObjects = sharedmem.getSharedObjects();
+  auto const global = module->getGlobalVariable("x");
+  auto const it = std::find_if(sharedObjects.begin(), sharedObjects.end(),
+                               [global](auto obj) { return obj->getValue() == global; });
+  REQUIRE(it != sharedObjects.end());
+
+  auto const writes = sharedmem.getThreadedWrites(*it);
+  REQUIRE(writes.size() == 2);
+  CHECK(writes[0].tid < writes[1].tid);
+  for (auto const &[tid, events] : writes) {
+    REQUIRE(events.size() == 1);
+    CHECK(events.front()->getThread().id == tid);
+  }
+
+  // main and both threads read x
+  auto const reads = sharedmem.getThreadedReads(*it);
+  REQUIRE(reads.size() == 3);
+  CHECK(reads[0].tid == 0);
+  CHECK(reads[0].tid < reads[1].tid);
+  CHECK(reads[1].tid < reads[2].tid);
+  for (auto const &[tid, events] : reads) {
+    REQUIRE(events.size() == 1);
+    CHECK(events.front()->getThread().id == tid);
+  }
+}
+
+TEST_CASE("Access pairs on several shared objects are owned by one object", "[unit][sharedmemory]") {
+  const char *ModuleString = R"(
+%union.pthread_attr_t = type { i64, [48 x i8] }
+
+@x = global i32 0
+@y = global i32 0
+
+define i8* @entry(i8* %arg) {
+    %r = call i32 @rand()
+    %c = icmp ne i32 %r, 0
+    %p = select i1 %c, i32* @x, i32* @y
+    store i32 1, i32* %p
+    ret i8* null
+}
+
+define i32 @main() {
+  %t1 = alloca i64
+  %t2 = alloca i64
+  %1 = call i32 @pthread_create(i64* %t1, %union.pthread_attr_t* null, i8* (i8*)* @entry, i8* null)
+  %2 = call i32 @pthread_create(i64* %t2, %union.pthread_attr_t* null, i8* (i8*)* @entry, i8* null)
+  ret i32 0
+}
+
+declare i32 @rand()
+declare i32 @pthread_create(i64*, %union.pthread_attr_t*, i8* (i8*)*, i8*)
+)";
+
+  llvm::LLVMContext Ctx;
+  llvm::SMDiagnostic Err;
+  auto module = llvm::parseAssemblyString(ModuleString, Err, Ctx);
+  if (!module) {
+    Err.print("error", llvm::errs());
+  }
+
+  race::ProgramTrace program(module.get());
+  race::SharedMemory sharedmem(program);
+
+  // both threads write x and y through the same pointer
+  auto const sharedObjects = sharedmem.getSharedObjects();
+  REQUIRE(sharedObjects.size() == 2);
+  llvm::DenseSet<const pta::ObjTy *> sharedObjectSet(sharedObjects.begin(), sharedObjects.end());
+
+  auto const writes = sharedmem.getThreadedWrites(sharedObjects[0]);
+  REQUIRE(writes.size() == 2);
+  REQUIRE(writes[0].events.size() == 1);
+  REQUIRE(writes[1].events.size() == 1);
+  auto const lhs = writes[0].events.front();
+  auto const rhs = writes[1].events.front();
+  REQUIRE(lhs->getAccessedMemory().size() == 2);
+  REQUIRE(rhs->getAccessedMemory().size() == 2);
+
+  // the pair is checked on exactly one of the two objects
+  size_t owners = 0;
+  for (auto const obj : sharedObjects) {
+    CHECK(sharedmem.getThreadedWrites(obj).size() == 2);
+    if (race::isPairOwner(obj, lhs, rhs, sharedObjectSet)) owners++;
+  }
+  CHECK(owners == 1);
+  CHECK(race::isPairOwner(*lhs->getAccessedMemory().begin(), lhs, rhs, sharedObjectSet));
+
+  // an object that appears twice in a points-to set is visited once
+  auto pts = lhs->getAccessedMemory();
+  pts.insert(*pts.begin());
+  REQUIRE(pts.size() == 3);
+  std::vector<const pta::ObjTy *> visited;
+  race::forEachObject(pts, [&](const pta::ObjTy *obj) { visited.push_back(obj); });
+  CHECK(visited == std::vector<const pta::ObjTy *>(lhs->getAccessedMemory().begin(), lhs->getAccessedMemory().end()));
+}
@@ -0,0 +1,143 @@
+/* Copyright 2021 Coderrect Inc. All Rights Reserved.
+Licensed under the GNU Affero General Public License, version 3 or later (“AGPL”), as published by the Free Software
+Foundation. You may not use this file except in compliance with the License. You may obtain a copy of the License at
+https://www.gnu.org/licenses/agpl-3.0.en.html
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an “AS IS” BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <llvm/IR/Function.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Module.h>
+
+#include <catch2/catch.hpp>
+#include <vector>
+
+#include "PointerAnalysis/Context/HybridCtx.h"
+#include "PointerAnalysis/Util/Util.h"
+
+using namespace pta;
+
+namespace {
+
+using Origin = KOrigin<3>;
+using Ctx = HybridCtx<Origin, KCallSite<1>>;
+using CT = CtxTrait<Ctx>;
+
+}  // namespace
+
+TEST_CASE("Interned contexts have dense ids", "[unit][PointerAnalysis]") {
+  llvm::LLVMContext context;
+  auto module = std::make_unique<llvm::Module>("testmodule", context);
+  auto voidTy = llvm::FunctionType::get(llvm::Type::getVoidTy(context), false);
+  auto callee = llvm::Function::Create(voidTy, llvm::Function::ExternalLinkage, "callee", module.get());
+  auto spawn = llvm::Function::Create(voidTy, llvm::Function::ExternalLinkage, "spawn", module.get());
+  auto caller = llvm::Function::Create(voidTy, llvm::Function::ExternalLinkage, "caller", module.get());
+  llvm::IRBuilder<> builder(llvm::BasicBlock::Create(context, "entry", caller));
+  const llvm::Instruction *call1 = builder.CreateCall(callee);
+  const llvm::Instruction *call2 = builder.CreateCall(callee);
+  const llvm::Instruction *spawnCall = builder.CreateCall(spawn);
+  builder.CreateRetVoid();
+
+  CT::Storage storage;
+  CT::Scope scope(storage);
+  Origin::setOriginRules([&](const Origin *, const llvm::Instruction *I) { return I == spawnCall; });
+
+  auto init = CT::getInitialCtx();
+  CHECK(CT::getID(init) == INITIAL_CTX_ID);
+  CHECK(CT::getID(CT::getGlobalCtx()) == GLOBAL_CTX_ID);
+
+  auto ctx1 = CT::contextEvolve(init, call1);
+  CHECK(CT::getID(ctx1) == FIRST_INTERNED_CTX_ID);
+  CHECK(CT::contextEvolve(init, call1) == ctx1);
+
+  // 1-callsite: the context only keeps the last call site
+  auto ctx2 = CT::contextEvolve(ctx1, call2);
+  CHECK(ctx2 != ctx1);
+  CHECK(CT::contextEvolve(init, call2) == ctx2);
+
+  // only the spawn call starts a new origin
+  auto spawned = CT::contextEvolve(ctx2, spawnCall);
+  CHECK(std::get<0>(spawned->getContext()) != std::get<0>(ctx2->getContext()));
+  CHECK(std::get<0>(ctx2->getContext()) == CtxTrait<Origin>::getInitialCtx());
+  CHECK(CtxTrait<Origin>::getNumCtx() == 1);
+
+  std::vector<CtxID> ids{CT::getID(ctx1), CT::getID(ctx2), CT::getID(spawned)};
+  CHECK(ids == std::vector<CtxID>{FIRST_INTERNED_CTX_ID, FIRST_INTERNED_CTX_ID + 1, FIRST_INTERNED_CTX_ID + 2});
+  CHECK(storage.contexts.getContext(CT::getID(spawned)) == spawned);
+
+  CT::release();
+  CHECK(CT::getID(CT::contextEvolve(init, call2)) == FIRST_INTERNED_CTX_ID);
+}
+
+TEST_CASE("Context policy limits the call-site depth", "[unit][PointerAnalysis]") {
+  llvm::LLVMContext context;
+  auto module = std::make_unique<llvm::Module>("testmodule", context);
+  auto voidTy = llvm::FunctionType::get(llvm::Type::getVoidTy(context), false);
+  auto wrapper = llvm::Function::Create(voidTy, llvm::Function::ExternalLinkage, "wrapper", module.get());
+  auto spawn = llvm::Function::Create(voidTy, llvm::Function::ExternalLinkage, "spawn", module.get());
+  auto caller = llvm::Function::Create(voidTy, llvm::Function::ExternalLinkage, "caller", module.get());
+  llvm::IRBuilder<> builder(llvm::BasicBlock::Create(context, "entry", caller));
+  const llvm::Instruction *call1 = builder.CreateCall(wrapper);
+  const llvm::Instruction *call2 = builder.CreateCall(wrapper);
+  const llvm::Instruction *spawnCall = builder.CreateCall(spawn);
+  builder.CreateRetVoid();
+
+  CT::Storage storage;
+  CT::Scope scope(storage);
+  Origin::setOriginRules([&](const Origin *, const llvm::Instruction *I) { return I == spawnCall; });
+
+  auto init = CT::getInitialCtx();
+  auto ctx1 = CT::contextEvolve(init, call1);
+  CHECK(CT::contextEvolve(init, call2) != ctx1);
+
+  CtxPolicy policy;
+  policy.setDepth(call1, 0);
+  policy.setDepth(call2, 0);
+  policy.setDepth(spawnCall, 0);
+  CT::setPolicy(policy);
+
+  // the wrapper is no longer cloned per call site
+  CHECK(CT::contextEvolve(init, call1) == init);
+  CHECK(CT::contextEvolve(init, call2) == init);
+
+  // but threads still get their own origin
+  auto spawned = CT::contextEvolve(init, spawnCall);
+  CHECK(spawned != init);
+  CHECK(std::get<0>(spawned->getContext()) != std::get<0>(init->getContext()));
+  CHECK(std::get<1>(spawned->getContext()) == CtxTrait<KCallSite<1>>::getInitialCtx());
+}
+
+TEST_CASE("Truncated call-site contexts are interned with the full ones", "[unit][PointerAnalysis]") {
+  llvm::LLVMContext context;
+  auto module = std::make_unique<llvm::Module>("testmodule", context);
+  auto voidTy = llvm::FunctionType::get(llvm::Type::getVoidTy(context), false);
+  auto callee = llvm::Function::Create(voidTy, llvm::Function::ExternalLinkage, "callee", module.get());
+  auto caller = llvm::Function::Create(voidTy, llvm::Function::ExternalLinkage, "caller", module.get());
+  llvm::IRBuilder<> builder(llvm::BasicBlock::Create(context, "entry", caller));
+  const llvm::Instruction *call1 = builder.CreateCall(callee);
+  const llvm::Instruction *call2 = builder.CreateCall(callee);
+  builder.CreateRetVoid();
+
+  using CS = CtxTrait<KCallSite<2>>;
+  CS::Storage storage;
+  CS::Scope scope(storage);
+
+  auto init = CS::getInitialCtx();
+  auto ctx1 = CS::contextEvolve(init, call1);
+  auto ctx12 = CS::contextEvolve(ctx1, call2);
+  auto ctx2 = CS::contextEvolve(init, call2);
+  CHECK(ctx12 != ctx2);
+
+  CtxPolicy policy;
+  policy.setDepth(call2, 1);
+  CS::setPolicy(policy);
+
+  // a depth of 1 at call2 drops call1, which leaves the same context as calling call2 first
+  CHECK(CS::contextEvolve(ctx1, call2) == ctx2);
+  CHECK(CS::contextEvolve(init, call1) == ctx1);
+}
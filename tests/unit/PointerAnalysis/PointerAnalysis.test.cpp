@@ -10,24 +10,37 @@ limitations under the License.
 ==============================================================================*/
 
 #include <catch2/catch.hpp>
+#include <map>
+#include <set>
+#include <thread>
+#include <vector>
 
 #include "PointerAnalysis/Context/NoCtx.h"
 #include "PointerAnalysis/Models/LanguageModel/DefaultLangModel/DefaultLangModel.h"
+#include "PointerAnalysis/Models/MemoryModel/CppMemModel/CppMemModel.h"
 #include "PointerAnalysis/Models/MemoryModel/FieldSensitive/FSMemModel.h"
 #include "PointerAnalysis/PointerAnalysisPass.h"
 #include "PointerAnalysis/Solver/PartialUpdateSolver.h"
+#include "PointerAnalysis/Solver/PointsTo/RoaringPTS.h"
+#include "PointerAnalysis/Solver/PointsTo/SharedPTS.h"
 #include "PreProcessing/Passes/CanonicalizeGEPPass.h"
 #include "PreProcessing/Passes/InsertGlobalCtorCallPass.h"
 #include "PreProcessing/Passes/LoweringMemCpyPass.h"
 #include "PreProcessing/Passes/RemoveExceptionHandlerPass.h"
+#include "llvm/IR/InstIterator.h"
 #include "llvm/IR/InstrTypes.h"
 #include "llvm/IRReader/IRReader.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
 
 using namespace pta;
 
 using Model = DefaultLangModel<NoCtx, FSMemModel<NoCtx>>;
 using Solver = PartialUpdateSolver<Model>;
+using ParallelSolver = ParallelPartialUpdateSolver<Model>;
+using SharedSolver = PartialUpdateSolver<DefaultLangModel<NoCtx, FSMemModel<NoCtx>, SharedPTS>>;
+using RoaringSolver = PartialUpdateSolver<DefaultLangModel<NoCtx, FSMemModel<NoCtx>, RoaringPTS>>;
+using CppSolver = PartialUpdateSolver<DefaultLangModel<NoCtx, cpp::CppMemModel<NoCtx>>>;
 
 namespace {
 
@@ -85,6 +98,57 @@ class PTAVerificationPass : public llvm::ModulePass {
 };
 
 char PTAVerificationPass::ID = 0;
+
+// points-to set of every pointer in the module, printed so that results can be compared across solver instances
+template <typename PTA>
+std::map<const llvm::Value *, std::multiset<std::string>> collectPointsTo(llvm::Module &module, PTA &pta) {
+  std::map<const llvm::Value *, std::multiset<std::string>> result;
+  auto const collect = [&](const llvm::Value *value) {
+    if (!value->getType()->isPointerTy()) return;
+    std::multiset<const typename PTA::ObjTy *> objects;
+    pta.getPointsTo(nullptr, value, objects);
+    auto &names = result[value];
+    for (auto obj : objects) {
+      names.insert(obj->toString());
+    }
+  };
+
+  for (auto const &func : module.getFunctionList()) {
+    for (auto const &arg : func.args()) {
+      collect(&arg);
+    }
+    for (auto const &basicblock : func.getBasicBlockList()) {
+      for (auto const &inst : basicblock.getInstList()) {
+        collect(&inst);
+      }
+    }
+  }
+  return result;
+}
+
+// inputs of the tests that compare two solver configurations on the same module
+const std::vector<std::string> comparedFiles = {
+    "constraint-cycle-copy.ll", "constraint-cycle-pwc.ll", "funptr-struct.ll", "heap-linkedlist.ll", "spec-equake.ll",
+    "spec-gap.ll",              "spec-mesa.ll",            "spec-parser.ll",   "spec-vortex.ll"};
+
+// parse a test module and run the preprocessing passes the pointer analysis expects, null if it cannot be parsed
+std::unique_ptr<llvm::Module> loadTestModule(const std::string &file, llvm::LLVMContext &context) {
+  llvm::SMDiagnostic err;
+  auto module = llvm::parseIRFile("unit/PointerAnalysis/" + file, err, context);
+  if (!module) {
+    err.print(file.c_str(), llvm::errs());
+    return module;
+  }
+
+  llvm::legacy::PassManager passes;
+  passes.add(new LegacyCanonicalizeGEPPass());
+  passes.add(new LoweringMemCpyLegacyPass());
+  passes.add(new RemoveExceptionHandlerLegacyPass());
+  passes.add(new InsertGlobalCtorCallPass());
+  passes.run(*module);
+  return module;
+}
+
 static llvm::RegisterPass<PointerAnalysisPass<Solver>> PAP("Pointer Analysis Wrapper Pass",
                                                            "Pointer Analysis Wrapper Pass", true, true);
 
@@ -128,3 +192,335 @@ TEST_CASE("PointerAnalysis", "[unit][PointerAnalysis]") {
     passes.run(*module);
   }
 }
+
+TEST_CASE("Parallel PointerAnalysis matches sequential", "[unit][PointerAnalysis]") {
+  auto file = GENERATE(from_range(comparedFiles));
+
+  SECTION(file) {
+    llvm::LLVMContext context;
+    auto module = loadTestModule(file, context);
+    REQUIRE(module != nullptr);
+
+    // both solvers stay alive, each keeps its own points-to sets and contexts
+    Solver sequential;
+    sequential.analyze(module.get(), "main");
+    ParallelSolver parallel(4);
+    parallel.analyze(module.get(), "main");
+    CHECK(collectPointsTo(*module, parallel) == collectPointsTo(*module, sequential));
+  }
+}
+
+TEST_CASE("PointerAnalysis instances run concurrently", "[unit][PointerAnalysis]") {
+  const std::vector<std::string> files = {"funptr-struct.ll", "heap-linkedlist.ll", "spec-equake.ll", "spec-gap.ll"};
+
+  // one LLVMContext per thread, LLVM types and values are not thread safe across a shared context
+  // results are keyed by function and position so that the runs on different contexts can be compared,
+  // most values in the test modules have no name
+  auto const analyze = [&](const std::string &file) {
+    llvm::LLVMContext context;
+    auto module = loadTestModule(file, context);
+    std::map<std::string, std::multiset<std::string>> result;
+    if (!module) return result;
+
+    std::map<const llvm::Value *, std::string> positions;
+    for (auto const &func : *module) {
+      size_t index = 0;
+      for (auto const &arg : func.args()) {
+        positions[&arg] = func.getName().str() + "#" + std::to_string(index++);
+      }
+      for (auto const &inst : llvm::instructions(func)) {
+        positions[&inst] = func.getName().str() + "#" + std::to_string(index++);
+      }
+    }
+
+    Solver solver;
+    solver.analyze(module.get(), "main");
+    for (auto const &[value, names] : collectPointsTo(*module, solver)) {
+      result[positions.at(value)] = names;
+    }
+    return result;
+  };
+
+  std::vector<std::map<std::string, std::multiset<std::string>>> expected;
+  for (auto const &file : files) {
+    expected.push_back(analyze(file));
+    REQUIRE_FALSE(expected.back().empty());
+  }
+
+  std::vector<std::map<std::string, std::multiset<std::string>>> results(files.size());
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < files.size(); i++) {
+    threads.emplace_back([&, i]() { results[i] = analyze(files[i]); });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  for (size_t i = 0; i < files.size(); i++) {
+    CHECK(results[i] == expected[i]);
+  }
+}
+
+TEST_CASE("Offline pointer substitution keeps points-to results", "[unit][PointerAnalysis]") {
+  auto file = GENERATE(from_range(comparedFiles));
+
+  SECTION(file) {
+    llvm::LLVMContext context;
+    auto module = loadTestModule(file, context);
+    REQUIRE(module != nullptr);
+
+    std::map<const llvm::Value *, std::multiset<std::string>> expected;
+    {
+      Solver solver;
+      solver.setPointerSubstitution(false);
+      solver.analyze(module.get(), "main");
+      expected = collectPointsTo(*module, solver);
+      CHECK(solver.getNumSubstitutedNodes() == 0);
+    }
+
+    Solver solver;
+    solver.analyze(module.get(), "main");
+    CHECK(collectPointsTo(*module, solver) == expected);
+  }
+}
+
+TEST_CASE("Offline pointer substitution merges pointers with the same copy predecessors", "[unit][PointerAnalysis]") {
+  llvm::LLVMContext context;
+  auto module = loadTestModule("substitution-phi.ll", context);
+  REQUIRE(module != nullptr);
+
+  Solver unmerged;
+  unmerged.setPointerSubstitution(false);
+  unmerged.analyze(module.get(), "main");
+
+  Solver solver;
+  solver.analyze(module.get(), "main");
+  CHECK(solver.getNumSubstitutedNodes() > 0);
+  CHECK(collectPointsTo(*module, solver) == collectPointsTo(*module, unmerged));
+}
+
+TEST_CASE("Hybrid cycle detection merges load/store cycles and keeps points-to results", "[unit][PointerAnalysis]") {
+  llvm::LLVMContext context;
+  auto module = loadTestModule("constraint-cycle-hcd.ll", context);
+  REQUIRE(module != nullptr);
+
+  Solver undetected;
+  undetected.setHybridCycleDetection(false);
+  undetected.analyze(module.get(), "main");
+  CHECK(undetected.getNumHCDMerges() == 0);
+
+  Solver solver;
+  solver.analyze(module.get(), "main");
+  CHECK(solver.getNumHCDMerges() > 0);
+  CHECK(collectPointsTo(*module, solver) == collectPointsTo(*module, undetected));
+}
+
+TEST_CASE("Flattening super nodes points every node at its root", "[unit][PointerAnalysis]") {
+  llvm::LLVMContext context;
+  auto module = loadTestModule("constraint-cycle-copy.ll", context);
+  REQUIRE(module != nullptr);
+
+  Solver solver;
+  solver.analyze(module.get(), "main");
+  auto &graph = *solver.getConsGraph();
+
+  std::vector<CGNodeBase<NoCtx> *> chain;
+  for (NodeID id = 0; id < graph.getNodeNum() && chain.size() < 4; id++) {
+    auto node = graph.getNode(id);
+    if (!node->hasSuperNode() && !node->isSpecialNode()) chain.push_back(node);
+  }
+  REQUIRE(chain.size() == 4);
+
+  // collapse each scc into a new node, so the first node ends up three parents away from the root
+  for (size_t i = 1; i < chain.size(); i++) {
+    graph.collapseSCCTo({chain[i - 1], chain[i]}, chain[i]);
+  }
+  auto const root = chain.back()->getNodeID();
+  CHECK(graph.getSuperParentID(chain.front()->getNodeID()) != root);
+  CHECK(graph.peekSuperNodeID(chain.front()->getNodeID()) == root);
+
+  graph.flattenSuperNodes();
+  for (NodeID id = 0; id < graph.getNodeNum(); id++) {
+    auto const superID = graph.peekSuperNodeID(id);
+    CHECK(graph.getSuperParentID(id) == superID);
+    CHECK(graph.findSuperNodeID(id) == superID);
+  }
+  for (auto node : chain) {
+    CHECK(graph.getSuperParentID(node->getNodeID()) == root);
+  }
+}
+
+TEST_CASE("Points-to set backends match BitVectorPTS", "[unit][PointerAnalysis]") {
+  auto file = GENERATE(from_range(comparedFiles));
+
+  SECTION(file) {
+    llvm::LLVMContext context;
+    auto module = loadTestModule(file, context);
+    REQUIRE(module != nullptr);
+
+    Solver solver;
+    solver.analyze(module.get(), "main");
+    auto const expected = collectPointsTo(*module, solver);
+    SharedSolver shared;
+    shared.analyze(module.get(), "main");
+    CHECK(collectPointsTo(*module, shared) == expected);
+    {
+      // the sets no node holds anymore are released after the solve
+      auto scope = shared.enterScope();
+      std::set<const llvm::SparseBitVector<> *> held;
+      for (NodeID id = 0; id < shared.getConsGraph()->getNodeNum(); id++) {
+        if (!PTSTrait<SharedPTS>::isEmpty(id)) held.insert(&PTSTrait<SharedPTS>::getPointsTo(id));
+      }
+      CHECK(SharedPTS::getNumSets() == held.size());
+    }
+    RoaringSolver roaring;
+    roaring.analyze(module.get(), "main");
+    CHECK(collectPointsTo(*module, roaring) == expected);
+  }
+}
+
+TEST_CASE("Worklist orders keep points-to results", "[unit][PointerAnalysis]") {
+  auto file = GENERATE(from_range(comparedFiles));
+
+  SECTION(file) {
+    llvm::LLVMContext context;
+    auto module = loadTestModule(file, context);
+    REQUIRE(module != nullptr);
+
+    Solver solver;
+    solver.analyze(module.get(), "main");
+    auto const expected = collectPointsTo(*module, solver);
+    for (auto order : {WorkListOrder::FIFO, WorkListOrder::LRF, WorkListOrder::Topological}) {
+      Solver ordered;
+      ordered.setWorkListOrder(order);
+      ordered.analyze(module.get(), "main");
+      CHECK(collectPointsTo(*module, ordered) == expected);
+    }
+  }
+}
+
+TEST_CASE("Demand-driven queries match the whole-program solve", "[unit][PointerAnalysis]") {
+  auto file = GENERATE(from_range(comparedFiles));
+
+  SECTION(file) {
+    llvm::LLVMContext context;
+    auto module = loadTestModule(file, context);
+    REQUIRE(module != nullptr);
+
+    Solver solver;
+    solver.analyze(module.get(), "main");
+    auto const expected = collectPointsTo(*module, solver);
+
+    Solver demand;
+    demand.setDemandDriven(1 << 20);
+    demand.analyze(module.get(), "main");
+    CHECK(collectPointsTo(*module, demand) == expected);
+    CHECK(demand.isDemandDriven());
+
+    // the first query that needs another node is over budget and solves the whole program
+    Solver overBudget;
+    overBudget.setDemandDriven(1);
+    overBudget.analyze(module.get(), "main");
+    CHECK(collectPointsTo(*module, overBudget) == expected);
+    CHECK_FALSE(overBudget.isDemandDriven());
+  }
+}
+
+TEST_CASE("Demand-driven queries resolve the special constraints of the C++ model", "[unit][PointerAnalysis]") {
+  llvm::LLVMContext context;
+  auto module = loadTestModule("cpp-vector.ll", context);
+  REQUIRE(module != nullptr);
+
+  CppSolver solver;
+  solver.analyze(module.get(), "main");
+  auto const expected = collectPointsTo(*module, solver);
+
+  CppSolver demand;
+  demand.setDemandDriven(1 << 20);
+  demand.analyze(module.get(), "main");
+  CHECK(collectPointsTo(*module, demand) == expected);
+  CHECK(demand.isDemandDriven());
+
+  // the pointer read back from the vector is only known through its special constraints
+  for (auto const &inst : llvm::instructions(module->getFunction("main"))) {
+    if (inst.getName() == "elem") {
+      CHECK(expected.at(&inst).size() == 1);
+    }
+  }
+}
+
+TEST_CASE("Persisted results match the solve", "[unit][PointerAnalysis]") {
+  auto file = GENERATE(from_range(comparedFiles));
+
+  SECTION(file) {
+    llvm::LLVMContext context;
+    auto module = loadTestModule(file, context);
+    REQUIRE(module != nullptr);
+
+    llvm::SmallString<128> dir;
+    REQUIRE_FALSE(llvm::sys::fs::createUniqueDirectory("openrace-pta", dir));
+
+    Solver solver;
+    solver.setResultsCache(std::string(dir.str()));
+    solver.analyze(module.get(), "main");
+    CHECK_FALSE(solver.isLoadedFromCache());
+    auto const expected = collectPointsTo(*module, solver);
+
+    Solver loaded;
+    loaded.setResultsCache(std::string(dir.str()));
+    loaded.analyze(module.get(), "main");
+    CHECK(loaded.isLoadedFromCache());
+    CHECK(collectPointsTo(*module, loaded) == expected);
+    CHECK(loaded.getCallGraph()->getNodeNum() == solver.getCallGraph()->getNodeNum());
+
+    llvm::sys::fs::remove_directories(dir);
+  }
+}
+
+TEST_CASE("Incremental solve matches a fresh solve", "[unit][PointerAnalysis]") {
+  auto file = GENERATE(from_range(comparedFiles));
+
+  SECTION(file) {
+    // a context per revision, as in separate runs, so that the types keep their names
+    llvm::LLVMContext baseContext, context;
+
+    llvm::SmallString<128> dir;
+    REQUIRE_FALSE(llvm::sys::fs::createUniqueDirectory("openrace-pta", dir));
+
+    auto base = loadTestModule(file, baseContext);
+    REQUIRE(base != nullptr);
+    Solver baseSolver;
+    baseSolver.setResultsCache(std::string(dir.str()));
+    baseSolver.analyze(base.get(), "main");
+
+    // the next revision drops the last store of a pointer in one function
+    auto revision = loadTestModule(file, context);
+    REQUIRE(revision != nullptr);
+    llvm::StoreInst *removed = nullptr;
+    for (auto &func : *revision) {
+      for (auto &inst : llvm::instructions(func)) {
+        auto store = llvm::dyn_cast<llvm::StoreInst>(&inst);
+        if (store != nullptr && store->getValueOperand()->getType()->isPointerTy()) {
+          removed = store;
+        }
+      }
+      if (removed != nullptr) break;
+    }
+    REQUIRE(removed != nullptr);
+    removed->eraseFromParent();
+
+    Solver fresh;
+    fresh.analyze(revision.get(), "main");
+
+    Solver incremental;
+    incremental.setResultsCache(std::string(dir.str()));
+    incremental.setIncremental(true);
+    incremental.analyze(revision.get(), "main");
+    CHECK_FALSE(incremental.isLoadedFromCache());
+    CHECK(incremental.getNumReusedNodes() > 0);
+    CHECK(collectPointsTo(*revision, incremental) == collectPointsTo(*revision, fresh));
+    CHECK(incremental.getCallGraph()->getNodeNum() == fresh.getCallGraph()->getNodeNum());
+
+    llvm::sys::fs::remove_directories(dir);
+  }
+}
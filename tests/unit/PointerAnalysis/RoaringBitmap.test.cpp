@@ -0,0 +1,142 @@
+/* Copyright 2021 Coderrect Inc. All Rights Reserved.
+Licensed under the GNU Affero General Public License, version 3 or later (“AGPL”), as published by the Free Software
+Foundation. You may not use this file except in compliance with the License. You may obtain a copy of the License at
+https://www.gnu.org/licenses/agpl-3.0.en.html
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an “AS IS” BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "PointerAnalysis/Solver/PointsTo/RoaringBitmap.h"
+
+#include <llvm/ADT/SparseBitVector.h>
+
+#include <catch2/catch.hpp>
+#include <random>
+#include <vector>
+
+using namespace pta;
+
+namespace {
+
+using Reference = llvm::SparseBitVector<>;
+
+template <typename Set>
+std::vector<unsigned> elements(const Set &set) {
+  std::vector<unsigned> result;
+  for (auto id : set) {
+    result.push_back(id);
+  }
+  return result;
+}
+
+}  // namespace
+
+TEST_CASE("RoaringBitmap containers", "[unit][PointerAnalysis]") {
+  RoaringBitmap set;
+  CHECK(set.empty());
+  CHECK(set.set(70000));
+  CHECK_FALSE(set.set(70000));
+  CHECK(set.test(70000));
+  CHECK_FALSE(set.test(4464));
+
+  // a dense range turns into a run container, and setting a few ids in it keeps it correct
+  for (unsigned id = 100; id < 20100; id++) {
+    set.set(id);
+  }
+  RoaringBitmap copy;
+  copy |= set;
+  CHECK(copy == set);
+  CHECK(copy.set(30000));
+  CHECK(copy.count() == 20002);
+  copy.reset(150);
+  CHECK_FALSE(copy.test(150));
+  CHECK(copy.count() == 20001);
+  CHECK(copy.contains(RoaringBitmap()));
+  CHECK_FALSE(copy.contains(set));
+
+  RoaringBitmap diff;
+  diff.intersectWithComplement(set, copy);
+  CHECK(elements(diff) == std::vector<unsigned>{150});
+  CHECK((set & copy).count() == 20000);
+}
+
+TEST_CASE("RoaringBitmap matches SparseBitVector", "[unit][PointerAnalysis]") {
+  auto const scalar = GENERATE(false, true);
+  RoaringBitmap::useScalarKernels(scalar);
+
+  std::mt19937 rng(42);
+  constexpr size_t NUM_SETS = 16;
+  std::vector<RoaringBitmap> sets(NUM_SETS);
+  std::vector<Reference> expected(NUM_SETS);
+
+  // mix sparse ids, dense ranges and ids spread over several chunks, so that every kind of container shows up
+  auto const randomID = [&]() -> unsigned {
+    switch (rng() % 3) {
+      case 0:
+        return rng() % 200000;
+      case 1:
+        return 3 * 65536 + rng() % 6000;
+      default:
+        return rng() % (1u << 24);
+    }
+  };
+
+  for (int step = 0; step < 1500; step++) {
+    auto const lhs = rng() % NUM_SETS, rhs = rng() % NUM_SETS;
+    switch (rng() % 7) {
+      case 0:
+        for (unsigned i = 0, n = rng() % 16; i < n; i++) {
+          auto const id = randomID();
+          CHECK(sets[lhs].set(id) == !expected[lhs].test(id));
+          expected[lhs].set(id);
+        }
+        break;
+      case 1: {
+        auto const start = randomID();
+        for (unsigned id = start, last = start + rng() % 6000; id < last; id++) {
+          sets[lhs].set(id);
+          expected[lhs].set(id);
+        }
+        break;
+      }
+      case 2:
+        CHECK((sets[lhs] |= sets[rhs]) == (expected[lhs] |= expected[rhs]));
+        break;
+      case 3: {
+        RoaringBitmap diff;
+        diff.intersectWithComplement(sets[lhs], sets[rhs]);
+        Reference expectedDiff;
+        expectedDiff.intersectWithComplement(expected[lhs], expected[rhs]);
+        sets[lhs] = diff;
+        expected[lhs] = expectedDiff;
+        break;
+      }
+      case 4:
+        CHECK(elements(sets[lhs] & sets[rhs]) == elements(expected[lhs] & expected[rhs]));
+        break;
+      case 5: {
+        auto const id = expected[lhs].empty() || rng() % 2 ? randomID() : expected[lhs].find_first();
+        sets[lhs].reset(id);
+        expected[lhs].reset(id);
+        break;
+      }
+      default:
+        if (rng() % 20 == 0) {
+          sets[lhs].clear();
+          expected[lhs].clear();
+        }
+        break;
+    }
+
+    CHECK(sets[lhs].intersects(sets[rhs]) == expected[lhs].intersects(expected[rhs]));
+    CHECK(sets[lhs].contains(sets[rhs]) == expected[lhs].contains(expected[rhs]));
+    CHECK((sets[lhs] == sets[rhs]) == (expected[lhs] == expected[rhs]));
+    CHECK(sets[lhs].count() == expected[lhs].count());
+    REQUIRE(elements(sets[lhs]) == elements(expected[lhs]));
+  }
+
+  RoaringBitmap::useScalarKernels(false);
+}
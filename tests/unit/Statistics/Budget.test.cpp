@@ -0,0 +1,44 @@
+/* Copyright 2021 Coderrect Inc. All Rights Reserved.
+Licensed under the GNU Affero General Public License, version 3 or later (“AGPL”), as published by the Free Software
+Foundation. You may not use this file except in compliance with the License. You may obtain a copy of the License at
+https://www.gnu.org/licenses/agpl-3.0.en.html
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an “AS IS” BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+
+#include "Statistics/Budget.h"
+
+#include <catch2/catch.hpp>
+
+TEST_CASE("Budget with no limits is never exceeded", "[unit][budget]") {
+  race::Budget budget;
+  budget.beginPhase();
+  CHECK_FALSE(budget.phaseExceeded());
+  CHECK_FALSE(budget.constraintNodesExceeded(1 << 30));
+  CHECK_FALSE(budget.traceEventsExceeded(1 << 30));
+  CHECK(budget.getFallbacks().empty());
+}
+
+TEST_CASE("Budget limits", "[unit][budget]") {
+  race::BudgetLimits limits;
+  limits.maxPhaseSeconds = 0;
+  limits.maxConstraintNodes = 10;
+  limits.maxTraceEvents = 100;
+  race::Budget budget(limits);
+
+  budget.beginPhase();
+  CHECK(budget.phaseExceeded());
+  CHECK_FALSE(budget.constraintNodesExceeded(10));
+  CHECK(budget.constraintNodesExceeded(11));
+  CHECK_FALSE(budget.traceEventsExceeded(100));
+  CHECK(budget.traceEventsExceeded(101));
+
+  budget.recordFallback("pta");
+  budget.recordFallback("sampling");
+  REQUIRE(budget.getFallbacks().size() == 2);
+  CHECK(budget.getFallbacks().front() == "pta");
+}
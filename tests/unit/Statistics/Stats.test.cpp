@@ -0,0 +1,44 @@
+/* Copyright 2021 Coderrect Inc. All Rights Reserved.
+Licensed under the GNU Affero General Public License, version 3 or later (“AGPL”), as published by the Free Software
+Foundation. You may not use this file except in compliance with the License. You may obtain a copy of the License at
+https://www.gnu.org/licenses/agpl-3.0.en.html
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an “AS IS” BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+
+#include "Statistics/Stats.h"
+
+#include <catch2/catch.hpp>
+
+TEST_CASE("Stats records phases in order", "[unit][stats]") {
+  race::Stats stats;
+  stats.beginPhase("first");
+  stats.beginPhase("second");
+  stats.endPhase();
+  // ending with no running phase does nothing
+  stats.endPhase();
+
+  auto const &phases = stats.getPhases();
+  REQUIRE(phases.size() == 2);
+  CHECK(phases[0].name == "first");
+  CHECK(phases[1].name == "second");
+  for (auto const &phase : phases) {
+    CHECK(phase.wallSeconds >= 0);
+    CHECK(phase.peakRSSDeltaKB >= 0);
+  }
+}
+
+TEST_CASE("Stats counters", "[unit][stats]") {
+  race::Stats stats;
+  stats.setCounter("events", 3);
+  stats.addCounter("events", 2);
+  stats.addCounter("pairs", 1);
+
+  auto const &counters = stats.getCounters();
+  CHECK(counters.at("events") == 5);
+  CHECK(counters.at("pairs") == 1);
+}